@@ -0,0 +1,716 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Bench.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Times the core operations behind the plugin's slow paths on a generated
+    workload, and writes the results as JSON, in the shape of the plugin's
+    stats.json, for regression tracking:
+
+    - catalog.read.*: app_readSessionDirectory, listing and sorting the
+      session directory.
+    - dialog.filter: one pass of the Sessions dialog's filter over the list,
+      SessionCatalog::filter, with the favorite lookups of getSessionMark,
+      which are cfg::isFavorite's ItemList::find on the Favorites list.
+    - prp.update*: the prp functions with the same loads, merges and saves,
+      for ordinary and large sessions. updateDocumentFromGlobal is timed up
+      to the lookup; the bookmarks it then sets are Scintilla's work. These
+      also report the median number of heap allocations per call, counted
+      by replacing operator new, which is what tinyxml2 allocates with.
+    - cfg.flush: SettingsStore::save after a setting changed and
+      ItemList::moveToTop moved a favorite, as cfg::saveSettings after a
+      session is loaded, without the plugin's file lock.
+    - xml.parse: tinyxml2 parsing global.xml from memory, which is mostly
+      XMLUtil::ScanFor and SkipWhiteSpace.
+    - xml.serialize: tinyxml2 saving global.xml, which is XMLPrinter.
+    - str.decodeUtf8, str.encodeUtf8: converting every pathname in global.xml
+      to UTF-16 and back, which str::utf8ToUtf16 and utf16ToUtf8 do for valid
+      text.
+
+    Usage: smbench [--dir DIR] [--iterations N] [--out FILE] [workload options]
+
+    Without --dir a workload is generated in a temporary directory and removed
+    afterwards. With --dir the workload there is used, or generated if the
+    directory has no global.xml. Scratch files are written to the workload
+    directory, so the workload itself is not changed.
+*/
+
+#include "Workload.h"
+#include "../src/core/Catalog.h"
+#include "../src/core/GlobalProps.h"
+#include "../src/core/Text.h"
+#include "../src/posix/PosixPlatform.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <ftw.h>
+#include <new>
+#include <time.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+#define BENCH_ITERATIONS 10
+#define BENCH_SCRATCH_GLOBAL   "bench-global.xml"
+#define BENCH_SCRATCH_SESSION  "bench-session.xml"
+#define BENCH_SCRATCH_SETTINGS "bench-settings.xml"
+/// Units in a pathname buffer, as MAX_PATH in the plugin
+#define MAX_PATH_LEN 260
+
+/// Timings of one benchmark, in microseconds
+typedef struct Result_tag {
+    const char *name;
+    vector<unsigned int> samples;
+    vector<unsigned int> allocs; ///< heap allocations of each sample, if counted
+} Result;
+
+/// What the benchmarks run on
+typedef struct Workload_tag {
+    string dir;
+    string globalFile;
+    vector<string> largeSessions;   ///< session file pathnames
+    vector<string> typicalSessions;
+    vector<string> pathnames;       ///< UTF-8 pathnames in global.xml
+    vector<std::wstring> filters;
+    vector<string> favorites;
+} Workload;
+
+vector<Result> _results;
+bool _failed = false;
+unsigned int _allocCount = 0; ///< calls to operator new, the benchmarks are single-threaded
+
+unsigned long long nowUs();
+Result& addResult(const char *name);
+void fail(const char *what, const string &file);
+bool loadWorkload(Workload &wl, PosixCatalogPlatform &platform);
+void benchCatalog(PosixCatalogPlatform &platform, int iterations);
+void benchFilter(const Workload &wl, PosixCatalogPlatform &platform, int iterations);
+void benchGlobalFromSession(const Workload &wl, const vector<string> &sessions, const char *name, int iterations);
+void benchSessionFromGlobal(const Workload &wl, const vector<string> &sessions, const char *name, int iterations);
+void benchDocumentFromGlobal(const Workload &wl, int iterations);
+void benchSettingsFlush(const Workload &wl, int iterations);
+void benchParse(const Workload &wl, int iterations);
+void benchSerialize(const Workload &wl, int iterations);
+void benchUtf(const Workload &wl, int iterations);
+void printResults(const Workload &wl, FILE *fp);
+unsigned int percentile(const vector<unsigned int> &sorted, int pct);
+int removeEntry(const char *path, const struct stat *, int, struct FTW *);
+
+} // end namespace
+
+} // end namespace NppPlugin
+
+//------------------------------------------------------------------------------
+// Counts heap allocations for the allocs results.
+
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+    void *p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    ++NppPlugin::_allocCount;
+    return p;
+}
+
+void* operator new[](std::size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) throw()
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) throw()
+{
+    std::free(p);
+}
+
+//------------------------------------------------------------------------------
+
+using namespace NppPlugin;
+
+int main(int argc, char *argv[])
+{
+    int i, iterations = BENCH_ITERATIONS;
+    const char *outFile = NULL;
+    char tmpDir[] = "/tmp/smbench-XXXXXX";
+    bool isTemp = false;
+    string dir, check;
+    WorkloadSpec spec;
+    Workload wl;
+    FILE *fp;
+
+    gen::setDefaults(&spec);
+    for (i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--small") == 0) {
+            gen::setSmall(&spec);
+        }
+        else if (std::strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc) {
+            std::fprintf(stderr, "Usage: smbench [--dir DIR] [--iterations N] [--out FILE] [options]\n%s", gen::getUsage());
+            return 2;
+        }
+        else if (std::strcmp(argv[i], "--dir") == 0) {
+            dir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--iterations") == 0) {
+            iterations = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--out") == 0) {
+            outFile = argv[++i];
+        }
+        else if (!gen::parseOption(&spec, argv[i] + 2, argv[i + 1])) {
+            std::fprintf(stderr, "Invalid option %s %s\n", argv[i], argv[i + 1]);
+            return 2;
+        }
+        else {
+            ++i;
+        }
+    }
+    if (iterations < 1) {
+        iterations = 1;
+    }
+    if (dir.empty()) {
+        if (!::mkdtemp(tmpDir)) {
+            std::perror("mkdtemp");
+            return 1;
+        }
+        dir = tmpDir;
+        isTemp = true;
+    }
+    check = dir + "/" GEN_GLOBAL_FILE;
+    if (::access(check.c_str(), F_OK) != 0) {
+        std::fprintf(stderr, "Generating workload in %s\n", dir.c_str());
+        if (!gen::generate(spec, dir.c_str())) {
+            std::fprintf(stderr, "Error generating the workload\n");
+            return 1;
+        }
+    }
+
+    wl.dir = dir;
+    PosixCatalogPlatform platform((dir + "/" GEN_SES_DIR).c_str(), GEN_SES_EXT);
+    if (loadWorkload(wl, platform)) {
+        std::fprintf(stderr, "Running benchmarks\n");
+        benchCatalog(platform, iterations);
+        benchFilter(wl, platform, iterations);
+        benchGlobalFromSession(wl, wl.typicalSessions, "prp.updateGlobalFromSession", iterations);
+        benchGlobalFromSession(wl, wl.largeSessions, "prp.updateGlobalFromSession.large", iterations);
+        benchSessionFromGlobal(wl, wl.typicalSessions, "prp.updateSessionFromGlobal", iterations);
+        benchSessionFromGlobal(wl, wl.largeSessions, "prp.updateSessionFromGlobal.large", iterations);
+        benchDocumentFromGlobal(wl, iterations);
+        benchSettingsFlush(wl, iterations);
+        benchParse(wl, iterations);
+        benchSerialize(wl, iterations);
+        benchUtf(wl, iterations);
+    }
+
+    if (!_failed) {
+        fp = outFile ? std::fopen(outFile, "w") : stdout;
+        if (fp) {
+            printResults(wl, fp);
+            if (outFile) {
+                std::fclose(fp);
+            }
+        }
+        else {
+            std::perror(outFile);
+            _failed = true;
+        }
+    }
+
+    std::remove((dir + "/" BENCH_SCRATCH_GLOBAL).c_str());
+    std::remove((dir + "/" BENCH_SCRATCH_SESSION).c_str());
+    std::remove((dir + "/" BENCH_SCRATCH_SETTINGS).c_str());
+    if (isTemp) {
+        ::nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    return _failed ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+namespace {
+
+unsigned long long nowUs()
+{
+    struct timespec ts;
+
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+Result& addResult(const char *name)
+{
+    Result result;
+
+    std::fprintf(stderr, "  %s\n", name);
+    result.name = name;
+    _results.push_back(result);
+    return _results.back();
+}
+
+void fail(const char *what, const string &file)
+{
+    std::fprintf(stderr, "Error %s \"%s\"\n", what, file.c_str());
+    _failed = true;
+}
+
+/** Reads the session list, global pathnames, favorites and filters. Sessions
+    named "large-" by the generator are benchmarked separately. */
+bool loadWorkload(Workload &wl, PosixCatalogPlatform &platform)
+{
+    wchar_t wName[SES_NAME_BUF_LEN];
+    const char *value;
+    string sesDir = wl.dir + "/" GEN_SES_DIR, settingsFile = wl.dir + "/" GEN_SETTINGS_FILE;
+    SessionCatalog catalog;
+    tXmlDoc doc;
+    tXmlEleP ele;
+
+    if (!catalog.read(platform, true) || catalog.empty()) {
+        fail("reading sessions in", sesDir);
+        return false;
+    }
+    for (SessionCatalog::const_iterator it = catalog.begin(); it != catalog.end(); ++it) {
+        string sesFile(sesDir);
+        wideToUtf8(it->name, sesFile);
+        sesFile += GEN_SES_EXT;
+        if (std::wcsncmp(it->name, L"large-", 6) == 0) {
+            wl.largeSessions.push_back(sesFile);
+        }
+        else {
+            wl.typicalSessions.push_back(sesFile);
+        }
+    }
+
+    wl.globalFile = wl.dir + "/" GEN_GLOBAL_FILE;
+    if (doc.LoadFile(wl.globalFile.c_str()) != kXmlSuccess) {
+        fail("loading", wl.globalFile);
+        return false;
+    }
+    ele = tXmlHnd(&doc).FirstChildElement("NotepadPlus").FirstChildElement("FileProperties").FirstChildElement("File").ToElement();
+    for (; ele; ele = ele->NextSiblingElement("File")) {
+        value = ele->Attribute("filename");
+        if (value) {
+            wl.pathnames.push_back(value);
+        }
+    }
+
+    if (doc.LoadFile(settingsFile.c_str()) != kXmlSuccess) {
+        fail("loading", settingsFile);
+        return false;
+    }
+    ele = tXmlHnd(&doc).FirstChildElement("SessionMgr").FirstChildElement("Favorites").FirstChildElement("item").ToElement();
+    for (; ele; ele = ele->NextSiblingElement("item")) {
+        value = ele->Attribute("value");
+        if (value && utf8ToWide(value, wName, SES_NAME_BUF_LEN)) {
+            wl.favorites.push_back(value);
+            platform.addFavorite(wName);
+        }
+    }
+    ele = tXmlHnd(&doc).FirstChildElement("SessionMgr").FirstChildElement("Filters").FirstChildElement("item").ToElement();
+    for (; ele; ele = ele->NextSiblingElement("item")) {
+        value = ele->Attribute("value");
+        if (value && utf8ToWide(value, wName, SES_NAME_BUF_LEN)) {
+            wl.filters.push_back(wName);
+        }
+    }
+    if (wl.filters.empty()) {
+        wl.filters.push_back(L"*");
+    }
+    return true;
+}
+
+/** Times reading the session directory sorted by name and by date. */
+void benchCatalog(PosixCatalogPlatform &platform, int iterations)
+{
+    int i;
+    unsigned long long start;
+    SessionCatalog catalog;
+    Result &alpha = addResult("catalog.read.alpha");
+
+    for (i = 0; i < iterations; ++i) {
+        start = nowUs();
+        catalog.read(platform, true);
+        alpha.samples.push_back((unsigned int)(nowUs() - start));
+    }
+    Result &date = addResult("catalog.read.date");
+    for (i = 0; i < iterations; ++i) {
+        start = nowUs();
+        catalog.read(platform, false);
+        date.samples.push_back((unsigned int)(nowUs() - start));
+    }
+}
+
+/** Times passes of the Sessions dialog filter over the session list, with
+    wildcards, one filter from settings.xml per pass. The first two sessions
+    stand in for the current and previous sessions. */
+void benchFilter(const Workload &wl, PosixCatalogPlatform &platform, int iterations)
+{
+    int i;
+    unsigned long long start;
+    const wchar_t *filter;
+    char mbName[UTF8_LEN_FOR_UTF16(SES_NAME_BUF_LEN)];
+    string settingsFile = wl.dir + "/" GEN_SETTINGS_FILE;
+    PosixSettingsPlatform settingsPlatform(settingsFile.c_str());
+    SettingsStore store;
+    ItemList favorites;
+    SessionCatalog catalog;
+
+    if (!store.load(settingsPlatform, "SessionMgr")) {
+        fail("loading", settingsFile);
+        return;
+    }
+    favorites.attach(store.container("Favorites"));
+    catalog.read(platform, false);
+    Result &result = addResult("dialog.filter");
+    for (i = 0; i < iterations; ++i) {
+        filter = wl.filters[i % wl.filters.size()].c_str();
+        start = nowUs();
+        catalog.filter(platform, filter, true, 0, 1);
+        for (SessionCatalog::iterator it = catalog.begin(); it != catalog.end(); ++it) {
+            if (it->isVisible) {
+                it->isFavorite = str::encodeUtf8(it->name, mbName, sizeof mbName) && favorites.find(mbName);
+            }
+        }
+        result.samples.push_back((unsigned int)(nowUs() - start));
+    }
+}
+
+/** Times prp::updateGlobalFromSession: load global.xml and the session,
+    merge, and save global.xml. */
+void benchGlobalFromSession(const Workload &wl, const vector<string> &sessions, const char *name, int iterations)
+{
+    int i;
+    unsigned int allocs;
+    unsigned long long start;
+    string scratch = wl.dir + "/" BENCH_SCRATCH_GLOBAL;
+    vector<unsigned int> fileHashes;
+    tXmlDoc globalDoc, localDoc; // reused, like the plugin's
+    Random rnd(2);
+
+    if (sessions.empty()) {
+        return;
+    }
+    Result &result = addResult(name);
+    for (i = 0; i < iterations; ++i) {
+        const string &sesFile = sessions[rnd.below((int)sessions.size())];
+        fileHashes.clear();
+        allocs = _allocCount;
+        start = nowUs();
+        if (globalDoc.LoadFile(wl.globalFile.c_str()) != kXmlSuccess) {
+            fail("loading", wl.globalFile);
+            return;
+        }
+        if (localDoc.LoadFile(sesFile.c_str()) != kXmlSuccess) {
+            fail("loading", sesFile);
+            return;
+        }
+        if (!prp::mergeIntoGlobal(globalDoc, localDoc, fileHashes)) {
+            fail("merging", sesFile);
+            return;
+        }
+        if (globalDoc.SaveFile(scratch.c_str()) != kXmlSuccess) {
+            fail("saving", scratch);
+            return;
+        }
+        result.samples.push_back((unsigned int)(nowUs() - start));
+        result.allocs.push_back(_allocCount - allocs);
+    }
+}
+
+/** Times prp::updateSessionFromGlobal when the session is not already
+    merged: load global.xml and the session, merge, and save the session. */
+void benchSessionFromGlobal(const Workload &wl, const vector<string> &sessions, const char *name, int iterations)
+{
+    int i;
+    bool changed;
+    unsigned int allocs;
+    unsigned long long start;
+    string scratch = wl.dir + "/" BENCH_SCRATCH_SESSION;
+    vector<unsigned int> fileHashes;
+    tXmlDoc globalDoc, localDoc;
+    Random rnd(3);
+
+    if (sessions.empty()) {
+        return;
+    }
+    Result &result = addResult(name);
+    for (i = 0; i < iterations; ++i) {
+        const string &sesFile = sessions[rnd.below((int)sessions.size())];
+        fileHashes.clear();
+        allocs = _allocCount;
+        start = nowUs();
+        if (globalDoc.LoadFile(wl.globalFile.c_str()) != kXmlSuccess) {
+            fail("loading", wl.globalFile);
+            return;
+        }
+        if (localDoc.LoadFile(sesFile.c_str()) != kXmlSuccess) {
+            fail("loading", sesFile);
+            return;
+        }
+        if (!prp::mergeIntoSession(globalDoc, localDoc, fileHashes, &changed)) {
+            fail("merging", sesFile);
+            return;
+        }
+        if (changed && localDoc.SaveFile(scratch.c_str()) != kXmlSuccess) {
+            fail("saving", scratch);
+            return;
+        }
+        result.samples.push_back((unsigned int)(nowUs() - start));
+        result.allocs.push_back(_allocCount - allocs);
+    }
+}
+
+/** Times prp::updateDocumentFromGlobal up to finding the document's File
+    element: load global.xml and look up a pathname. Every fourth pathname
+    is not in global.xml, which is the longest search. */
+void benchDocumentFromGlobal(const Workload &wl, int iterations)
+{
+    int i;
+    unsigned int allocs;
+    unsigned long long start;
+    string pathname;
+    tXmlDoc globalDoc;
+    Random rnd(4);
+    Result &result = addResult("prp.updateDocumentFromGlobal");
+
+    for (i = 0; i < iterations; ++i) {
+        if (i % 4 == 3 || wl.pathnames.empty()) {
+            pathname = "C:\\not\\in\\global.txt";
+        }
+        else {
+            pathname = wl.pathnames[rnd.below((int)wl.pathnames.size())];
+        }
+        allocs = _allocCount;
+        start = nowUs();
+        if (globalDoc.LoadFile(wl.globalFile.c_str()) != kXmlSuccess) {
+            fail("loading", wl.globalFile);
+            return;
+        }
+        if (!prp::findGlobalFile(globalDoc, pathname.c_str()) && i % 4 != 3) {
+            fail("finding a pathname in", wl.globalFile);
+            return;
+        }
+        result.samples.push_back((unsigned int)(nowUs() - start));
+        result.allocs.push_back(_allocCount - allocs);
+    }
+}
+
+/** Times saving the settings after the current session changed and a
+    favorite was moved to the top, as happens when a session is loaded. The
+    settings are saved to a scratch file. */
+void benchSettingsFlush(const Workload &wl, int iterations)
+{
+    int i;
+    unsigned long long start;
+    string settingsFile = wl.dir + "/" GEN_SETTINGS_FILE, scratch = wl.dir + "/" BENCH_SCRATCH_SETTINGS;
+    PosixSettingsPlatform settingsPlatform(settingsFile.c_str()), scratchPlatform(scratch.c_str());
+    SettingsStore store;
+    ItemList favorites;
+    tXmlEleP currentEle;
+    Random rnd(5);
+
+    if (!store.load(settingsPlatform, "SessionMgr")) {
+        fail("loading", settingsFile);
+        return;
+    }
+    currentEle = store.container("Settings")->FirstChildElement("currentSession");
+    if (!currentEle) {
+        fail("finding settings in", settingsFile);
+        return;
+    }
+    favorites.attach(store.container("Favorites"));
+    Result &result = addResult("cfg.flush");
+    for (i = 0; i < iterations; ++i) {
+        start = nowUs();
+        if (!wl.favorites.empty()) {
+            const string &fav = wl.favorites[rnd.below((int)wl.favorites.size())];
+            currentEle->SetAttribute("value", fav.c_str());
+            favorites.moveToTop(fav.c_str());
+        }
+        if (!store.save(scratchPlatform)) {
+            fail("saving", scratch);
+            return;
+        }
+        result.samples.push_back((unsigned int)(nowUs() - start));
+    }
+}
+
+/** Times parsing global.xml from memory, so that reading the file is not
+    included. */
+void benchParse(const Workload &wl, int iterations)
+{
+    int i;
+    size_t n;
+    char buf[65536];
+    unsigned long long start;
+    string xml;
+    tXmlDoc doc;
+    FILE *fp = std::fopen(wl.globalFile.c_str(), "rb");
+
+    if (!fp) {
+        fail("opening", wl.globalFile);
+        return;
+    }
+    while ((n = std::fread(buf, 1, sizeof buf, fp)) > 0) {
+        xml.append(buf, n);
+    }
+    std::fclose(fp);
+    Result &result = addResult("xml.parse");
+    for (i = 0; i < iterations; ++i) {
+        start = nowUs();
+        if (doc.Parse(xml.c_str(), xml.size()) != kXmlSuccess) {
+            fail("parsing", wl.globalFile);
+            return;
+        }
+        result.samples.push_back((unsigned int)(nowUs() - start));
+    }
+}
+
+/** Times saving global.xml to a scratch file. */
+void benchSerialize(const Workload &wl, int iterations)
+{
+    int i;
+    unsigned long long start;
+    string scratch = wl.dir + "/" BENCH_SCRATCH_GLOBAL;
+    tXmlDoc doc;
+
+    if (doc.LoadFile(wl.globalFile.c_str()) != kXmlSuccess) {
+        fail("loading", wl.globalFile);
+        return;
+    }
+    Result &result = addResult("xml.serialize");
+    for (i = 0; i < iterations; ++i) {
+        start = nowUs();
+        if (doc.SaveFile(scratch.c_str()) != kXmlSuccess) {
+            fail("saving", scratch);
+            return;
+        }
+        result.samples.push_back((unsigned int)(nowUs() - start));
+    }
+}
+
+/** Times str::decodeUtf8 and str::encodeUtf8 over every pathname in
+    global.xml, into buffers of the worst-case length, as the plugin does. */
+void benchUtf(const Workload &wl, int iterations)
+{
+    int i;
+    size_t j;
+    unsigned long long start;
+    vector<std::wstring> wide(wl.pathnames.size());
+    vector<wchar_t> wBuf;
+    vector<char> cBuf;
+
+    for (j = 0; j < wl.pathnames.size(); ++j) {
+        wBuf.resize(UTF16_LEN_FOR_UTF8(wl.pathnames[j].size()));
+        if (!str::decodeUtf8(wl.pathnames[j].c_str(), &wBuf[0], wBuf.size())) {
+            fail("decoding a pathname in", wl.globalFile);
+            return;
+        }
+        wide[j] = &wBuf[0];
+    }
+    wBuf.resize(MAX_PATH_LEN);
+    cBuf.resize(UTF8_LEN_FOR_UTF16(MAX_PATH_LEN));
+    Result &decode = addResult("str.decodeUtf8");
+    for (i = 0; i < iterations; ++i) {
+        start = nowUs();
+        for (j = 0; j < wl.pathnames.size(); ++j) {
+            str::decodeUtf8(wl.pathnames[j].c_str(), &wBuf[0], wBuf.size());
+        }
+        decode.samples.push_back((unsigned int)(nowUs() - start));
+    }
+    Result &encode = addResult("str.encodeUtf8");
+    for (i = 0; i < iterations; ++i) {
+        start = nowUs();
+        for (j = 0; j < wide.size(); ++j) {
+            str::encodeUtf8(wide[j].c_str(), &cBuf[0], cBuf.size());
+        }
+        encode.samples.push_back((unsigned int)(nowUs() - start));
+    }
+}
+
+/** Writes the workload and the results, with count, p50, p95 and max in
+    microseconds for each benchmark, and the median allocations if they were
+    counted. The workload is copied from the workload.json the generator
+    wrote, if it is there. */
+void printResults(const Workload &wl, FILE *fp)
+{
+    size_t i, n;
+    char buf[4096];
+    string specFile = wl.dir + "/" GEN_SPEC_FILE;
+    FILE *specFp = std::fopen(specFile.c_str(), "r");
+    vector<unsigned int> sorted;
+
+    std::fprintf(fp, "{\"workload\":");
+    n = specFp ? std::fread(buf, 1, sizeof buf - 1, specFp) : 0;
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r')) {
+        --n;
+    }
+    buf[n] = 0;
+    std::fprintf(fp, "%s,\n", n > 0 ? buf : "null");
+    if (specFp) {
+        std::fclose(specFp);
+    }
+    std::fprintf(fp, "\"counts\":{\"sessions\":%u,\"largeSessions\":%u,\"globalFiles\":%u,\"favorites\":%u,\"filters\":%u},\n",
+        (unsigned)(wl.typicalSessions.size() + wl.largeSessions.size()), (unsigned)wl.largeSessions.size(),
+        (unsigned)wl.pathnames.size(), (unsigned)wl.favorites.size(), (unsigned)wl.filters.size());
+    std::fprintf(fp, "\"results\":[\n");
+    for (i = 0; i < _results.size(); ++i) {
+        sorted = _results[i].samples;
+        std::sort(sorted.begin(), sorted.end());
+        std::fprintf(fp, "{\"name\":\"%s\",\"count\":%u,\"p50\":%u,\"p95\":%u,\"max\":%u",
+            _results[i].name, (unsigned)sorted.size(), percentile(sorted, 50), percentile(sorted, 95),
+            sorted.empty() ? 0 : sorted.back());
+        if (!_results[i].allocs.empty()) {
+            sorted = _results[i].allocs;
+            std::sort(sorted.begin(), sorted.end());
+            std::fprintf(fp, ",\"allocs\":%u", percentile(sorted, 50));
+        }
+        std::fprintf(fp, "}%s\n", i + 1 < _results.size() ? "," : "");
+    }
+    std::fprintf(fp, "]}\n");
+}
+
+/** @return the nearest-rank percentile of sorted, or 0 if it is empty */
+unsigned int percentile(const vector<unsigned int> &sorted, int pct)
+{
+    size_t rank;
+
+    if (sorted.empty()) {
+        return 0;
+    }
+    rank = (sorted.size() * pct + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+int removeEntry(const char *path, const struct stat *, int, struct FTW *)
+{
+    return std::remove(path);
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
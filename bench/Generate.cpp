@@ -0,0 +1,54 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Generate.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Writes a workload to a directory, to benchmark with smbench --dir or to
+    point a Notepad++ test installation at.
+
+    Usage: smgen DIR [workload options]
+*/
+
+#include "Workload.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace NppPlugin;
+
+int main(int argc, char *argv[])
+{
+    int i;
+    WorkloadSpec spec;
+
+    gen::setDefaults(&spec);
+    for (i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--small") == 0) {
+            gen::setSmall(&spec);
+        }
+        else if (std::strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc || !gen::parseOption(&spec, argv[i] + 2, argv[i + 1])) {
+            break;
+        }
+        else {
+            ++i;
+        }
+    }
+    if (argc < 2 || argv[1][0] == '-' || i < argc) {
+        std::fprintf(stderr, "Usage: smgen DIR [options]\n%s", gen::getUsage());
+        return 2;
+    }
+    if (!gen::generate(spec, argv[1])) {
+        std::fprintf(stderr, "Error generating the workload in %s\n", argv[1]);
+        return 1;
+    }
+    gen::printJson(spec, stdout);
+    std::printf("\n");
+    return 0;
+}
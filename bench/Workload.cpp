@@ -0,0 +1,554 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Workload.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Session files are written the way Notepad++ writes them, with pathnames
+    entity-encoded and the attributes it saves for each file. global.xml and
+    settings.xml are written with tinyxml2, the way the plugin writes them.
+*/
+
+#include "Workload.h"
+#include "../src/core/Text.h"
+#include "../src/xml/tinyxml.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/stat.h>
+#include <utime.h>
+
+using std::string;
+using std::vector;
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// Number of projects the pathnames are spread over
+#define GEN_PROJECTS 97
+
+/// Lines in a generated file, for bookmarks and folds
+#define GEN_MAX_LINE 8000
+
+/// Seconds in a year, over which session modified times are spread
+#define GEN_YEAR_SECS (365 * 24 * 3600)
+
+const char* const _words[] = {
+    "alpha", "build", "client", "debug", "docs", "feature", "fix", "infra",
+    "legacy", "notes", "proto", "release", "review", "server", "spike",
+    "tools", "web", "\xC3\x9C" "bersicht", "\xE6\x96\x87\xE6\x9B\xB8"
+};
+const int _wordCount = sizeof _words / sizeof _words[0];
+
+const char* const _dirs[] = {
+    "src", "include", "test", "doc", "scripts", "build", "res", "lib",
+    "tools", "config", "data", "\xC3\x9C" "bersetzung", "examples"
+};
+const int _dirCount = sizeof _dirs / sizeof _dirs[0];
+
+/// File extension and its Notepad++ language name
+const char* const _exts[][2] = {
+    {"cpp", "C++"}, {"h", "C++"}, {"py", "Python"}, {"js", "JavaScript"},
+    {"xml", "XML"}, {"txt", "Normal Text"}, {"html", "HTML"}, {"bat", "Batch"}
+};
+const int _extCount = sizeof _exts / sizeof _exts[0];
+
+/// Name and value of each element of the Settings container
+const char* const _settings[][2] = {
+    {"automaticSave", "1"}, {"automaticLoad", "0"}, {"loadIntoCurrent", "0"},
+    {"loadWithoutClosing", "0"}, {"showInTitlebar", "0"}, {"showInStatusbar", "0"},
+    {"useGlobalProperties", "1"}, {"cleanGlobalProperties", "0"}, {"useContextMenu", "1"},
+    {"backupOnStartup", "1"}, {"sessionSaveDelay", "3"}, {"settingsSavePoll", "2"},
+    {"sessionDirectory", ""}, {"sessionExtension", GEN_SES_EXT}, {"currentMark", "9674"},
+    {"currentFavMark", "9830"}, {"previousMark", "9702"}, {"previousFavMark", "8226"},
+    {"defaultMark", "9653"}, {"defaultFavMark", "9652"}, {"favoriteMark", "183"},
+    {"useFilterWildcards", "1"}, {"sessionSortOrder", "2"}, {"currentSession", ""},
+    {"previousSession", ""}, {"defaultSession", "Default"},
+    {"menuLabelMain", "&Session Manager"}, {"menuLabelSub1", "&Sessions..."},
+    {"menuLabelSub2", "Se&ttings..."}, {"menuLabelSub3", "Sa&ve current"},
+    {"menuLabelSub4", "Load &previous"}, {"menuLabelSub5", "&Help"},
+    {"menuLabelSub6", "&About..."}, {"sessionsDialogWidth", "0"},
+    {"sessionsDialogHeight", "0"}, {"settingsDialogWidth", "0"},
+    {"settingsDialogHeight", "0"}, {"debugLogLevel", "0"}, {"debugLogFile", ""},
+    {"progressiveLoad", "0"}, {"progressiveLoadBatch", "20"}
+};
+const int _settingCount = sizeof _settings / sizeof _settings[0];
+
+bool writeSession(const WorkloadSpec &spec, int sesIdx, const ZipfSampler &zipf, Random &rnd, const char *dir, time_t now);
+void writeFileElement(FILE *fp, int fileIdx, int marks, int folds, Random &rnd, char **buf, size_t *bufLen);
+bool writeGlobal(const WorkloadSpec &spec, Random &rnd, const char *dir);
+bool writeSettings(const WorkloadSpec &spec, Random &rnd, const char *dir);
+void addLines(tXmlDoc &doc, tXmlEleP fileEle, const char *eleName, int count, Random &rnd);
+void getLines(int count, Random &rnd, vector<int> &lines);
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+namespace gen {
+
+/** Sets the workload of a heavy user: 10000 sessions, 80000 distinct files,
+    and ten sessions of 500 tabs with dense bookmarks. */
+void setDefaults(WorkloadSpec *spec)
+{
+    spec->sessions = 10000;
+    spec->files = 80000;
+    spec->meanTabs = 12;
+    spec->largeSessions = 10;
+    spec->maxTabs = 500;
+    spec->meanMarks = 2;
+    spec->denseMarks = 40;
+    spec->favorites = 100;
+    spec->filters = 20;
+    spec->skew = 1.0;
+    spec->seed = 1;
+}
+
+/** Sets a workload small enough for a smoke test. */
+void setSmall(WorkloadSpec *spec)
+{
+    setDefaults(spec);
+    spec->sessions = 200;
+    spec->files = 1000;
+    spec->largeSessions = 2;
+    spec->maxTabs = 50;
+    spec->favorites = 10;
+    spec->filters = 5;
+}
+
+/** Sets the spec field for the command line option name, without its
+    leading dashes.
+    @return false if name is unknown or value is invalid */
+bool parseOption(WorkloadSpec *spec, const char *name, const char *value)
+{
+    char *end;
+    long n = std::strtol(value, &end, 10);
+    bool isInt = *value && *end == 0 && n >= 0 && n <= 10000000;
+
+    if (std::strcmp(name, "skew") == 0) {
+        spec->skew = std::strtod(value, &end);
+        return *value && *end == 0 && spec->skew >= 0;
+    }
+    if (!isInt) {
+        return false;
+    }
+    if (std::strcmp(name, "sessions") == 0) {
+        spec->sessions = (int)n;
+    }
+    else if (std::strcmp(name, "files") == 0) {
+        spec->files = (int)n;
+    }
+    else if (std::strcmp(name, "mean-tabs") == 0) {
+        spec->meanTabs = (int)n;
+    }
+    else if (std::strcmp(name, "large-sessions") == 0) {
+        spec->largeSessions = (int)n;
+    }
+    else if (std::strcmp(name, "max-tabs") == 0) {
+        spec->maxTabs = (int)n;
+    }
+    else if (std::strcmp(name, "mean-marks") == 0) {
+        spec->meanMarks = (int)n;
+    }
+    else if (std::strcmp(name, "dense-marks") == 0) {
+        spec->denseMarks = (int)n;
+    }
+    else if (std::strcmp(name, "favorites") == 0) {
+        spec->favorites = (int)n;
+    }
+    else if (std::strcmp(name, "filters") == 0) {
+        spec->filters = (int)n;
+    }
+    else if (std::strcmp(name, "seed") == 0) {
+        spec->seed = (unsigned int)n;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+const char* getUsage()
+{
+    return
+        "  --small               a workload small enough for a smoke test\n"
+        "  --sessions N          session files (10000)\n"
+        "  --files N             distinct pathnames in global.xml (80000)\n"
+        "  --mean-tabs N         mean files per ordinary session (12)\n"
+        "  --large-sessions N    sessions with max-tabs files (10)\n"
+        "  --max-tabs N          files per large session (500)\n"
+        "  --mean-marks N        mean bookmarks per file (2)\n"
+        "  --dense-marks N       bookmarks per file in large sessions (40)\n"
+        "  --favorites N         favorite sessions in settings.xml (100)\n"
+        "  --filters N           filters in settings.xml (20)\n"
+        "  --skew X              Zipf exponent of file popularity (1.0)\n"
+        "  --seed N              random seed (1)\n";
+}
+
+/** Writes the workload described by spec into dir, which is created if
+    needed. Existing session files are overwritten, not removed.
+    @return false if a file could not be written */
+bool generate(const WorkloadSpec &spec, const char *dir)
+{
+    int sesIdx;
+    string path(dir);
+    Random rnd(spec.seed);
+    ZipfSampler zipf(spec.files, spec.skew);
+    time_t now = std::time(NULL);
+    FILE *fp;
+
+    if (spec.files < 1 || spec.sessions < spec.largeSessions || spec.maxTabs < 1) {
+        return false;
+    }
+    ::mkdir(path.c_str(), 0755);
+    path += "/" GEN_SES_DIR;
+    ::mkdir(path.c_str(), 0755);
+    for (sesIdx = 0; sesIdx < spec.sessions; ++sesIdx) {
+        if (!writeSession(spec, sesIdx, zipf, rnd, dir, now)) {
+            return false;
+        }
+    }
+    if (!writeGlobal(spec, rnd, dir) || !writeSettings(spec, rnd, dir)) {
+        return false;
+    }
+    path = string(dir) + "/" GEN_SPEC_FILE;
+    fp = std::fopen(path.c_str(), "w");
+    if (!fp) {
+        return false;
+    }
+    printJson(spec, fp);
+    std::fprintf(fp, "\n");
+    return std::fclose(fp) == 0;
+}
+
+/** Sets pathname to the UTF-8 pathname of the given file. Some have non-ASCII
+    directory names. */
+void getPathname(int fileIdx, string &pathname)
+{
+    char buf[256];
+
+    ::snprintf(buf, sizeof buf, "C:\\Users\\dev\\Projects\\proj-%02d\\%s\\file%05d.%s",
+        fileIdx % GEN_PROJECTS, _dirs[(fileIdx / GEN_PROJECTS) % _dirCount], fileIdx, _exts[fileIdx % _extCount][0]);
+    pathname = buf;
+}
+
+/** Sets name to the UTF-8 name of the given session. The large sessions come
+    first. */
+void getSessionName(const WorkloadSpec &spec, int sesIdx, string &name)
+{
+    char buf[64];
+
+    if (isLarge(spec, sesIdx)) {
+        ::snprintf(buf, sizeof buf, "large-%03d", sesIdx);
+    }
+    else {
+        ::snprintf(buf, sizeof buf, "%s-%05d", _words[sesIdx % _wordCount], sesIdx);
+    }
+    name = buf;
+}
+
+bool isLarge(const WorkloadSpec &spec, int sesIdx)
+{
+    return sesIdx < spec.largeSessions;
+}
+
+/** Writes spec as a JSON object, without a trailing newline. */
+void printJson(const WorkloadSpec &spec, FILE *fp)
+{
+    std::fprintf(fp, "{\"sessions\":%i,\"files\":%i,\"meanTabs\":%i,\"largeSessions\":%i,"
+        "\"maxTabs\":%i,\"meanMarks\":%i,\"denseMarks\":%i,\"favorites\":%i,\"filters\":%i,"
+        "\"skew\":%.2f,\"seed\":%u}",
+        spec.sessions, spec.files, spec.meanTabs, spec.largeSessions, spec.maxTabs,
+        spec.meanMarks, spec.denseMarks, spec.favorites, spec.filters, spec.skew, spec.seed);
+}
+
+} // end namespace NppPlugin::gen
+
+//------------------------------------------------------------------------------
+
+Random::Random(unsigned int seed)
+    : _state(0x9E3779B97F4A7C15ULL ^ seed)
+{
+}
+
+unsigned long long Random::next()
+{
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    return _state * 2685821657736338717ULL;
+}
+
+/** @return a number in [0, 1) */
+double Random::uniform()
+{
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** @return a number in [0, n) */
+int Random::below(int n)
+{
+    return n > 0 ? (int)(next() % (unsigned long long)n) : 0;
+}
+
+/** @return a number >= 0 from a geometric distribution with the given mean */
+int Random::geometric(double mean)
+{
+    if (mean <= 0) {
+        return 0;
+    }
+    return (int)(std::log(1.0 - uniform()) / std::log(mean / (mean + 1.0)));
+}
+
+//------------------------------------------------------------------------------
+
+ZipfSampler::ZipfSampler(int n, double skew)
+{
+    int i;
+    double total = 0;
+
+    _cdf.resize(n > 0 ? n : 1);
+    for (i = 0; i < (int)_cdf.size(); ++i) {
+        total += 1.0 / std::pow(i + 1.0, skew);
+        _cdf[i] = total;
+    }
+    for (i = 0; i < (int)_cdf.size(); ++i) {
+        _cdf[i] /= total;
+    }
+}
+
+int ZipfSampler::draw(Random &rnd) const
+{
+    size_t i = std::upper_bound(_cdf.begin(), _cdf.end(), rnd.uniform()) - _cdf.begin();
+    return (int)(i < _cdf.size() ? i : _cdf.size() - 1);
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/** Writes one session file. Ordinary sessions have a geometric number of
+    files and some have a subView. Files are drawn by popularity, without
+    repeats within a session. The modified time is spread over the last year. */
+bool writeSession(const WorkloadSpec &spec, int sesIdx, const ZipfSampler &zipf, Random &rnd, const char *dir, time_t now)
+{
+    int i, tabs, mainTabs, marks, fileIdx, tries;
+    bool large = gen::isLarge(spec, sesIdx);
+    char *buf = NULL;
+    size_t bufLen = 0;
+    string name, path;
+    vector<int> files;
+    struct utimbuf times;
+    FILE *fp;
+
+    tabs = large ? spec.maxTabs : std::min(spec.maxTabs, 1 + rnd.geometric(spec.meanTabs - 1));
+    tabs = std::min(tabs, spec.files);
+    for (i = 0; i < tabs; ++i) {
+        tries = 0;
+        do {
+            fileIdx = tries < 8 ? zipf.draw(rnd) : rnd.below(spec.files);
+            ++tries;
+        } while (std::find(files.begin(), files.end(), fileIdx) != files.end());
+        files.push_back(fileIdx);
+    }
+    mainTabs = tabs > 1 && rnd.below(10) < 3 ? tabs - tabs / 4 : tabs;
+
+    gen::getSessionName(spec, sesIdx, name);
+    path = string(dir) + "/" GEN_SES_DIR + name + GEN_SES_EXT;
+    fp = std::fopen(path.c_str(), "w");
+    if (!fp) {
+        return false;
+    }
+    std::fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n<NotepadPlus>\n");
+    std::fprintf(fp, "    <Session activeView=\"0\">\n        <mainView activeIndex=\"%i\">\n", rnd.below(mainTabs));
+    for (i = 0; i < tabs; ++i) {
+        if (i == mainTabs) {
+            std::fprintf(fp, "        </mainView>\n        <subView activeIndex=\"0\">\n");
+        }
+        marks = large ? spec.denseMarks : rnd.geometric(spec.meanMarks);
+        writeFileElement(fp, files[i], marks, rnd.geometric(spec.meanMarks / 2.0), rnd, &buf, &bufLen);
+    }
+    if (mainTabs == tabs) {
+        std::fprintf(fp, "        </mainView>\n        <subView activeIndex=\"0\" />\n");
+    }
+    else {
+        std::fprintf(fp, "        </subView>\n");
+    }
+    std::fprintf(fp, "    </Session>\n</NotepadPlus>\n");
+    std::free(buf);
+    if (std::fclose(fp) != 0) {
+        return false;
+    }
+    times.actime = times.modtime = now - rnd.below(GEN_YEAR_SECS);
+    ::utime(path.c_str(), &times);
+    return true;
+}
+
+/** Writes a File element of a session file, with the given number of Mark
+    and Fold elements. */
+void writeFileElement(FILE *fp, int fileIdx, int marks, int folds, Random &rnd, char **buf, size_t *bufLen)
+{
+    int i, pos;
+    string pathname;
+    vector<int> lines;
+
+    gen::getPathname(fileIdx, pathname);
+    str::utf8ToAscii(pathname.c_str(), buf, bufLen);
+    pos = rnd.below(200000);
+    std::fprintf(fp, "            <File firstVisibleLine=\"%i\" xOffset=\"0\" scrollWidth=\"1200\" startPos=\"%i\" "
+        "endPos=\"%i\" selMode=\"0\" offset=\"0\" wrapCount=\"1\" lang=\"%s\" encoding=\"-1\" userReadOnly=\"no\" "
+        "filename=\"%s\" backupFilePath=\"\" originalFileLastModifTimestamp=\"0\" "
+        "originalFileLastModifTimestampHigh=\"0\" mapFirstVisibleDisplayLine=\"-1\" mapFirstVisibleDocLine=\"-1\" "
+        "mapLastVisibleDocLine=\"-1\" mapNbLine=\"-1\" mapHigherPos=\"-1\" mapWidth=\"-1\" mapHeight=\"-1\" "
+        "mapKByteInDoc=\"512\" mapWrapIndentMode=\"-1\" mapIsWrap=\"no\"",
+        rnd.below(GEN_MAX_LINE), pos, pos, _exts[fileIdx % _extCount][1], *buf);
+    if (marks + folds == 0) {
+        std::fprintf(fp, " />\n");
+        return;
+    }
+    std::fprintf(fp, ">\n");
+    getLines(marks, rnd, lines);
+    for (i = 0; i < (int)lines.size(); ++i) {
+        std::fprintf(fp, "                <Mark line=\"%i\" />\n", lines[i]);
+    }
+    getLines(folds, rnd, lines);
+    for (i = 0; i < (int)lines.size(); ++i) {
+        std::fprintf(fp, "                <Fold line=\"%i\" />\n", lines[i]);
+    }
+    std::fprintf(fp, "            </File>\n");
+}
+
+/** Writes global.xml with a File element for every pathname, in random order,
+    since the plugin keeps them in most recently saved order. */
+bool writeGlobal(const WorkloadSpec &spec, Random &rnd, const char *dir)
+{
+    int i, j, tmp;
+    string pathname, path;
+    vector<int> order(spec.files);
+    tXmlDoc doc;
+    tXmlEleP rootEle, propsEle, fileEle;
+
+    for (i = 0; i < spec.files; ++i) {
+        order[i] = i;
+    }
+    for (i = spec.files - 1; i > 0; --i) {
+        j = rnd.below(i + 1);
+        tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    doc.InsertEndChild(doc.NewDeclaration());
+    rootEle = doc.NewElement("NotepadPlus");
+    doc.InsertEndChild(rootEle);
+    propsEle = doc.NewElement("FileProperties");
+    rootEle->InsertEndChild(propsEle);
+    for (i = 0; i < spec.files; ++i) {
+        gen::getPathname(order[i], pathname);
+        fileEle = doc.NewElement("File");
+        fileEle->SetAttribute("filename", pathname.c_str());
+        fileEle->SetAttribute("lang", _exts[order[i] % _extCount][1]);
+        fileEle->SetAttribute("firstVisibleLine", rnd.below(GEN_MAX_LINE));
+        propsEle->InsertEndChild(fileEle);
+        addLines(doc, fileEle, "Mark", rnd.geometric(spec.meanMarks), rnd);
+        addLines(doc, fileEle, "Fold", rnd.geometric(spec.meanMarks / 2.0), rnd);
+    }
+    path = string(dir) + "/" GEN_GLOBAL_FILE;
+    return doc.SaveFile(path.c_str()) == kXmlSuccess;
+}
+
+/** Writes settings.xml with every setting, favorites drawn from the sessions
+    and wildcard filters made from the session name words. */
+bool writeSettings(const WorkloadSpec &spec, Random &rnd, const char *dir)
+{
+    int i;
+    char buf[64];
+    string name, path;
+    tXmlDoc doc;
+    tXmlEleP rootEle, conEle, ele;
+
+    doc.InsertEndChild(doc.NewDeclaration());
+    rootEle = doc.NewElement("SessionMgr");
+    doc.InsertEndChild(rootEle);
+    conEle = doc.NewElement("Settings");
+    rootEle->InsertEndChild(conEle);
+    for (i = 0; i < _settingCount; ++i) {
+        ele = doc.NewElement(_settings[i][0]);
+        ele->SetAttribute("value", _settings[i][1]);
+        conEle->InsertEndChild(ele);
+    }
+    gen::getSessionName(spec, spec.sessions > 0 ? rnd.below(spec.sessions) : 0, name);
+    conEle->FirstChildElement("currentSession")->SetAttribute("value", name.c_str());
+    gen::getSessionName(spec, spec.sessions > 0 ? rnd.below(spec.sessions) : 0, name);
+    conEle->FirstChildElement("previousSession")->SetAttribute("value", name.c_str());
+
+    conEle = doc.NewElement("Favorites");
+    rootEle->InsertEndChild(conEle);
+    for (i = 0; i < spec.favorites && spec.sessions > 0; ++i) {
+        gen::getSessionName(spec, rnd.below(spec.sessions), name);
+        ele = doc.NewElement("item");
+        ele->SetAttribute("value", name.c_str());
+        conEle->InsertEndChild(ele);
+    }
+
+    conEle = doc.NewElement("Filters");
+    rootEle->InsertEndChild(conEle);
+    for (i = 0; i < spec.filters; ++i) {
+        switch (i % 4) {
+            case 0: ::snprintf(buf, sizeof buf, "*"); break;
+            case 1: ::snprintf(buf, sizeof buf, "%s-*", _words[rnd.below(_wordCount)]); break;
+            case 2: ::snprintf(buf, sizeof buf, "*-%i*", rnd.below(100)); break;
+            default: ::snprintf(buf, sizeof buf, "*%s*", _words[rnd.below(_wordCount)]); break;
+        }
+        ele = doc.NewElement("item");
+        ele->SetAttribute("value", buf);
+        conEle->InsertEndChild(ele);
+    }
+    path = string(dir) + "/" GEN_SETTINGS_FILE;
+    return doc.SaveFile(path.c_str()) == kXmlSuccess;
+}
+
+/** Adds count child elements named eleName, each with a line attribute. */
+void addLines(tXmlDoc &doc, tXmlEleP fileEle, const char *eleName, int count, Random &rnd)
+{
+    int i;
+    vector<int> lines;
+    tXmlEleP ele;
+
+    getLines(count, rnd, lines);
+    for (i = 0; i < (int)lines.size(); ++i) {
+        ele = doc.NewElement(eleName);
+        ele->SetAttribute("line", lines[i]);
+        fileEle->InsertEndChild(ele);
+    }
+}
+
+/** Sets lines to count sorted, distinct line numbers. */
+void getLines(int count, Random &rnd, vector<int> &lines)
+{
+    int i;
+
+    lines.clear();
+    for (i = 0; i < count; ++i) {
+        lines.push_back(rnd.below(GEN_MAX_LINE));
+    }
+    std::sort(lines.begin(), lines.end());
+    lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
@@ -0,0 +1,107 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Workload.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Generates a configuration directory like a heavy user's: a session
+    directory, global.xml and settings.xml. Sessions have a geometric number
+    of tabs, a few are large with dense bookmarks, and files are shared
+    between sessions with Zipf-distributed popularity. Everything is derived
+    from the seed, so a workload can be regenerated exactly.
+
+    Layout of the directory:
+    - sessions/NAME.npp-session
+    - global.xml
+    - settings.xml
+    - workload.json, the spec it was generated from
+*/
+
+#ifndef NPP_PLUGIN_BENCH_WORKLOAD_H
+#define NPP_PLUGIN_BENCH_WORKLOAD_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+#define GEN_SES_DIR "sessions/"
+#define GEN_SES_EXT ".npp-session"
+#define GEN_GLOBAL_FILE "global.xml"
+#define GEN_SETTINGS_FILE "settings.xml"
+#define GEN_SPEC_FILE "workload.json"
+
+/// Shape of a generated workload
+typedef struct WorkloadSpec_tag {
+    int sessions;      ///< session files, including the large ones
+    int files;         ///< distinct pathnames, all of which are in global.xml
+    int meanTabs;      ///< mean files per ordinary session
+    int largeSessions; ///< sessions with maxTabs files and denseMarks bookmarks per file
+    int maxTabs;
+    int meanMarks;     ///< mean bookmarks per file elsewhere
+    int denseMarks;
+    int favorites;
+    int filters;
+    double skew;       ///< Zipf exponent of file popularity; 0 is uniform
+    unsigned int seed;
+} WorkloadSpec;
+
+//------------------------------------------------------------------------------
+/// @namespace NppPlugin::gen Contains the workload generator.
+
+namespace gen {
+
+void setDefaults(WorkloadSpec *spec);
+void setSmall(WorkloadSpec *spec);
+bool parseOption(WorkloadSpec *spec, const char *name, const char *value);
+const char* getUsage();
+bool generate(const WorkloadSpec &spec, const char *dir);
+void getPathname(int fileIdx, std::string &pathname);
+void getSessionName(const WorkloadSpec &spec, int sesIdx, std::string &name);
+bool isLarge(const WorkloadSpec &spec, int sesIdx);
+void printJson(const WorkloadSpec &spec, FILE *fp);
+
+} // end namespace NppPlugin::gen
+
+//------------------------------------------------------------------------------
+
+/// @class Random A small deterministic generator (xorshift64*), so workloads
+/// are the same on every platform.
+class Random
+{
+  public:
+    explicit Random(unsigned int seed);
+    unsigned long long next();
+    double uniform();
+    int below(int n);
+    int geometric(double mean);
+
+  private:
+    unsigned long long _state;
+};
+
+/// @class ZipfSampler Draws ranks 0..n-1 with probability proportional to
+/// 1 / (rank + 1) ^ skew.
+class ZipfSampler
+{
+  public:
+    ZipfSampler(int n, double skew);
+    int draw(Random &rnd) const;
+
+  private:
+    std::vector<double> _cdf;
+};
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_BENCH_WORKLOAD_H
@@ -18,12 +18,25 @@
     the changes to appear in the menus. The menu labels used in the context
     submenu are the same as those used in the Plugins menu and favorite sessions
     are listed after the About item.
+
+    The user owns the rest of contextMenu.xml, so when only the favorites
+    changed, the file is not reserialized from the DOM. Instead the bytes
+    from the end of our separator Item to the end of the last favorite Item
+    are replaced with the favorites printed from the DOM, and everything
+    else in the file, including whitespace and comments, is copied as is.
+    The result is parsed and its Item count compared with the DOM before it
+    is written. If our items cannot be found in the file as expected, the
+    whole DOM is saved as before.
 */
 
 #include "System.h"
 #include "ContextMenu.h"
 #include "Menu.h"
 #include "Util.h"
+#include "Perf.h"
+#include <vector>
+
+using std::vector;
 
 //------------------------------------------------------------------------------
 
@@ -34,16 +47,16 @@ namespace NppPlugin {
 namespace {
 
 /// XML nodes
-#define XN_NOTEPADPLUS          "NotepadPlus" ///< root node
-#define XN_SCINTILLACONTEXTMENU "ScintillaContextMenu"
-#define XN_ITEM                 "Item"
+LPCSTR const XN_NOTEPADPLUS          = xmlIntern("NotepadPlus"); ///< root node
+LPCSTR const XN_SCINTILLACONTEXTMENU = xmlIntern("ScintillaContextMenu");
+LPCSTR const XN_ITEM                 = xmlIntern("Item");
 
 /// XML attributes
-#define XA_FOLDERNAME            "FolderName"
-#define XA_PLUGINENTRYNAME       "PluginEntryName"
-#define XA_PLUGINCOMMANDITEMNAME "PluginCommandItemName"
-#define XA_ITEMNAMEAS            "ItemNameAs"
-#define XA_ID                    "id"
+LPCSTR const XA_FOLDERNAME            = xmlIntern("FolderName");
+LPCSTR const XA_PLUGINENTRYNAME       = xmlIntern("PluginEntryName");
+LPCSTR const XA_PLUGINCOMMANDITEMNAME = xmlIntern("PluginCommandItemName");
+LPCSTR const XA_ITEMNAMEAS            = xmlIntern("ItemNameAs");
+LPCSTR const XA_ID                    = xmlIntern("id");
 
 tXmlDocP _pCtxXmlDoc = NULL;
 tXmlEleP _pCtxLastFav = NULL;
@@ -51,6 +64,11 @@ tXmlEleP _pCtxLastFav = NULL;
 tXmlEleP getFavSeparator();
 tXmlEleP createContextMenu(tXmlEleP sciCtxMnuEle);
 tXmlEleP newItemElement(LPCWSTR itemName = NULL);
+bool spliceFavorites();
+bool readFile(LPCWSTR pathname, vector<CHAR> &buf);
+bool nextItemTag(LPCSTR *tag, LPCSTR *tagEnd, LPCSTR end);
+bool isOurItem(tXmlDocP tagDoc, LPCSTR tag, LPCSTR tagEnd, LPCSTR mbMain, LPCSTR attr, LPCSTR value);
+INT countItems(tXmlDocP doc);
 
 } // end namespace
 
@@ -75,8 +93,9 @@ void deleteFavorites()
 {
     tXmlEleP ele, sepEle, favEle, sciCtxMnuEle;
 
-    if (cfg::getBool(kUseContextMenu)) {
-        LPSTR mbMain = str::utf16ToUtf8(mnu_getMenuLabel());
+    if (cfg::get<kUseContextMenu>()) {
+        Scratch scratch;
+        LPSTR mbMain = scratch.toUtf8(mnu_getMenuLabel());
         if (mbMain) {
             sepEle = getFavSeparator();
             if (sepEle) {
@@ -88,7 +107,6 @@ void deleteFavorites()
                     sciCtxMnuEle->DeleteChild(ele);
                 }
             }
-            sys_free(mbMain);
         }
         _pCtxLastFav = NULL;
     }
@@ -99,7 +117,7 @@ void addFavorite(LPCWSTR favName)
 {
     tXmlEleP sepEle, favEle, sciCtxMnuEle;
 
-    if (cfg::getBool(kUseContextMenu)) {
+    if (cfg::get<kUseContextMenu>()) {
         if (!_pCtxLastFav) {
             sepEle = getFavSeparator();
             if (sepEle) {
@@ -123,9 +141,16 @@ void saveContextMenu()
     DWORD lastErr;
     tXmlError xmlErr;
 
-    if (cfg::getBool(kUseContextMenu)) {
+    if (cfg::get<kUseContextMenu>()) {
         if (_pCtxXmlDoc) {
-            xmlErr = _pCtxXmlDoc->SaveFile(sys_getNppCtxMnuFile());
+            sys_lockFiles();
+            if (spliceFavorites()) {
+                xmlErr = (tXmlError)kXmlSuccess;
+            }
+            else {
+                PRF_TRACE("xml write contextMenu.xml", xmlErr = _pCtxXmlDoc->SaveFile(sys_getNppCtxMnuFile()));
+            }
+            sys_unlockFiles();
             if (xmlErr != kXmlSuccess) {
                 lastErr = ::GetLastError();
                 msg::error(lastErr, L"%s: Error %u saving the context menu file.", _W(__FUNCTION__), xmlErr);
@@ -158,11 +183,12 @@ tXmlEleP getFavSeparator()
     bool changed = false;
     tXmlEleP sepEle = NULL;
     LPSTR mbMain, mbAbout;
+    Scratch scratch;
 
     // Load the contextMenu file if not already loaded
     if (!_pCtxXmlDoc) {
         _pCtxXmlDoc = new tinyxml2::XMLDocument();
-        xmlErr = _pCtxXmlDoc->LoadFile(sys_getNppCtxMnuFile());
+        PRF_TRACE("xml parse contextMenu.xml", xmlErr = _pCtxXmlDoc->LoadFile(sys_getNppCtxMnuFile()));
         if (xmlErr != kXmlSuccess) {
             lastErr = ::GetLastError();
             msg::error(lastErr, L"%s: Error %u loading the context menu file.", _W(__FUNCTION__), xmlErr);
@@ -174,9 +200,9 @@ tXmlEleP getFavSeparator()
     sciCtxMnuEle = ctxDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SCINTILLACONTEXTMENU).ToElement();
 
     // the main menu item label
-    mbMain = str::utf16ToUtf8(mnu_getMenuLabel());
+    mbMain = scratch.toUtf8(mnu_getMenuLabel());
     // the About item label
-    mbAbout = str::utf16ToUtf8(mnu_getMenuLabel(MNU_BASE_MAX_ITEMS - 1));
+    mbAbout = scratch.toUtf8(mnu_getMenuLabel(MNU_BASE_MAX_ITEMS - 1));
     if (mbMain && mbAbout) {
         // Iterate over the Item elements looking for our About item
         itemEle = sciCtxMnuEle->FirstChildElement(XN_ITEM);
@@ -201,8 +227,6 @@ tXmlEleP getFavSeparator()
         if (changed) {
             ctx::saveContextMenu();
         }
-        sys_free(mbMain);
-        sys_free(mbAbout);
     }
 
     return sepEle;
@@ -229,8 +253,9 @@ tXmlEleP createContextMenu(tXmlEleP sciCtxMnuEle)
 tXmlEleP newItemElement(LPCWSTR itemName)
 {
     tXmlEleP ele = NULL;
+    Scratch scratch;
 
-    LPSTR mbMain = str::utf16ToUtf8(mnu_getMenuLabel());
+    LPSTR mbMain = scratch.toUtf8(mnu_getMenuLabel());
     if (mbMain) {
         ele = _pCtxXmlDoc->NewElement(XN_ITEM);
         ele->SetAttribute(XA_FOLDERNAME, mbMain);
@@ -239,22 +264,229 @@ tXmlEleP newItemElement(LPCWSTR itemName)
         }
         else {
             CHAR mbMainNoAmp[MNU_MAX_NAME_LEN], mbBufNoAmp[MNU_MAX_NAME_LEN];
-            LPSTR mbBuf = str::utf16ToUtf8(itemName);
+            LPSTR mbBuf = scratch.toUtf8(itemName);
             if (mbBuf) {
                 str::removeAmp(mbMain, mbMainNoAmp);
                 str::removeAmp(mbBuf, mbBufNoAmp);
                 ele->SetAttribute(XA_PLUGINENTRYNAME, mbMainNoAmp);
                 ele->SetAttribute(XA_ITEMNAMEAS, mbBuf);
                 ele->SetAttribute(XA_PLUGINCOMMANDITEMNAME, mbBufNoAmp);
-                sys_free(mbBuf);
             }
         }
-        sys_free(mbMain);
     }
 
     return ele;
 }
 
+/** Writes the favorites in the DOM into contextMenu.xml, replacing only the
+    favorite Item elements in the file. Called with the files locked.
+    @return false if nothing was written because our separator was not found
+    in the file or the DOM, or the result did not verify, or if writing failed */
+bool spliceFavorites()
+{
+    INT state = 0;
+    bool written;
+    LPCSTR data, end, tag, tagEnd, sepTag = NULL, sepEnd = NULL, favEnd = NULL, lineStart;
+    LPCSTR eol = "\n";
+    vector<CHAR> inBuf, outBuf;
+    tXmlEleP sciCtxMnuEle, itemEle, favEle = NULL;
+    tXmlDoc tagDoc, outDoc;
+    tinyxml2::XMLPrinter printer(NULL, true);
+    Scratch scratch;
+    FILE *fp;
+    TraceScope trc("ctx::spliceFavorites");
+
+    LPSTR mbMain = scratch.toUtf8(mnu_getMenuLabel());
+    LPSTR mbAbout = scratch.toUtf8(mnu_getMenuLabel(MNU_BASE_MAX_ITEMS - 1));
+    if (!mbMain || !mbAbout) {
+        return false;
+    }
+    // Find the first favorite in the DOM, or the end of the menu if there are none
+    tXmlHnd ctxDocHnd(_pCtxXmlDoc);
+    sciCtxMnuEle = ctxDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SCINTILLACONTEXTMENU).ToElement();
+    if (!sciCtxMnuEle) {
+        return false;
+    }
+    for (itemEle = sciCtxMnuEle->FirstChildElement(XN_ITEM); itemEle; itemEle = itemEle->NextSiblingElement(XN_ITEM)) {
+        if (itemEle->Attribute(XA_FOLDERNAME, mbMain) && itemEle->Attribute(XA_ITEMNAMEAS, mbAbout)) {
+            itemEle = itemEle->NextSiblingElement(XN_ITEM);
+            if (!itemEle || !itemEle->Attribute(XA_FOLDERNAME, mbMain) || !itemEle->Attribute(XA_ID, "0")) {
+                return false;
+            }
+            favEle = itemEle->NextSiblingElement(XN_ITEM);
+            break;
+        }
+    }
+    if (!itemEle) {
+        return false;
+    }
+
+    // Find the same items in the file: the About item, the separator that
+    // must follow it, and the favorites that follow without anything between.
+    if (!readFile(sys_getNppCtxMnuFile(), inBuf)) {
+        return false;
+    }
+    data = &inBuf[0];
+    end = data + inBuf.size() - 1;
+    tag = data;
+    while (state < 3 && nextItemTag(&tag, &tagEnd, end)) {
+        switch (state) {
+            case 0: // looking for About
+                if (tagEnd && isOurItem(&tagDoc, tag, tagEnd, mbMain, XA_ITEMNAMEAS, mbAbout)) {
+                    state = 1;
+                }
+                break;
+            case 1: // the separator
+                if (!tagEnd || !isOurItem(&tagDoc, tag, tagEnd, mbMain, XA_ID, "0")) {
+                    return false;
+                }
+                sepTag = tag;
+                sepEnd = favEnd = tagEnd;
+                state = 2;
+                break;
+            case 2: // favorites
+                if (tagEnd && isOurItem(&tagDoc, tag, tagEnd, mbMain, NULL, NULL)) {
+                    favEnd = tagEnd;
+                }
+                else {
+                    state = 3;
+                }
+                break;
+        }
+        tag = tagEnd ? tagEnd : tag + 1;
+    }
+    if (!sepEnd) {
+        return false;
+    }
+
+    // Each favorite goes on its own line, indented like the separator
+    for (lineStart = sepTag; lineStart > data && (lineStart[-1] == ' ' || lineStart[-1] == '\t'); --lineStart);
+    if (lineStart > data + 1 && lineStart[-1] == '\n' && lineStart[-2] == '\r') {
+        eol = "\r\n";
+    }
+    outBuf.insert(outBuf.end(), data, sepEnd);
+    for (; favEle && favEle->Attribute(XA_FOLDERNAME, mbMain); favEle = favEle->NextSiblingElement(XN_ITEM)) {
+        printer.ClearBuffer();
+        favEle->Accept(&printer);
+        outBuf.insert(outBuf.end(), eol, eol + strlen(eol));
+        outBuf.insert(outBuf.end(), lineStart, sepTag);
+        outBuf.insert(outBuf.end(), printer.CStr(), printer.CStr() + printer.CStrSize() - 1);
+    }
+    outBuf.insert(outBuf.end(), favEnd, end);
+
+    // Verify the result has the same items as the DOM
+    if (outDoc.Parse(&outBuf[0], outBuf.size()) != kXmlSuccess || countItems(&outDoc) != countItems(_pCtxXmlDoc)) {
+        LOG("The spliced context menu did not verify.");
+        return false;
+    }
+    ::_wfopen_s(&fp, sys_getNppCtxMnuFile(), L"wb");
+    if (!fp) {
+        return false;
+    }
+    written = ::fwrite(&outBuf[0], 1, outBuf.size(), fp) == outBuf.size();
+    if (::fclose(fp) != 0 || !written) {
+        // The file may be truncated, so the caller rewrites all of it.
+        LOG("Error %i writing the spliced context menu.", errno);
+        return false;
+    }
+    LOGG(10, "Replaced %i bytes of favorites with %i", (INT)(favEnd - sepEnd), (INT)(outBuf.size() - inBuf.size() + 1 + (favEnd - sepEnd)));
+    return true;
+}
+
+/** Reads the file at pathname into buf, followed by a null. */
+bool readFile(LPCWSTR pathname, vector<CHAR> &buf)
+{
+    FILE *fp;
+    long len;
+    bool ok = false;
+
+    ::_wfopen_s(&fp, pathname, L"rb");
+    if (!fp) {
+        return false;
+    }
+    if (::fseek(fp, 0, SEEK_END) == 0 && (len = ::ftell(fp)) > 0 && ::fseek(fp, 0, SEEK_SET) == 0) {
+        buf.resize(len + 1);
+        ok = ::fread(&buf[0], 1, len, fp) == (size_t)len;
+        buf[len] = 0;
+    }
+    ::fclose(fp);
+    return ok;
+}
+
+/** Finds the next tag at or after *tag, skipping comments, CDATA sections and
+    processing instructions. On return *tag points to the tag and *tagEnd to
+    the character following it, or is NULL if the tag is not an Item.
+    @return false if there are no more tags or the markup is not closed */
+bool nextItemTag(LPCSTR *tag, LPCSTR *tagEnd, LPCSTR end)
+{
+    CHAR quote = 0;
+    LPCSTR p, q;
+
+    p = (LPCSTR)memchr(*tag, '<', end - *tag);
+    if (!p) {
+        return false;
+    }
+    *tag = p;
+    *tagEnd = NULL;
+    if (strncmp(p, "<!--", 4) == 0 || strncmp(p, "<![CDATA[", 9) == 0 || strncmp(p, "<?", 2) == 0) {
+        // Not an Item, but the caller needs to know something is here.
+        q = strstr(p, p[1] == '?' ? "?>" : p[2] == '-' ? "-->" : "]]>");
+        if (!q) {
+            return false;
+        }
+        *tag = q; // the caller continues after this
+        return true;
+    }
+    for (q = p + 1; *q && (quote || *q != '>'); ++q) {
+        if (quote) {
+            if (*q == quote) {
+                quote = 0;
+            }
+        }
+        else if (*q == '"' || *q == '\'') {
+            quote = *q;
+        }
+    }
+    if (!*q) {
+        return false;
+    }
+    if (strncmp(p, "<Item", 5) == 0 && (p[5] == ' ' || p[5] == '\t' || p[5] == '\r' || p[5] == '\n' || p[5] == '/')) {
+        *tagEnd = q + 1;
+    }
+    else {
+        *tag = q; // the caller continues after this
+    }
+    return true;
+}
+
+/** Parses the Item tag from tag to tagEnd into tagDoc.
+    @return true if it is a complete Item element whose FolderName is mbMain,
+    and, if attr is not NULL, whose attr attribute is value */
+bool isOurItem(tXmlDocP tagDoc, LPCSTR tag, LPCSTR tagEnd, LPCSTR mbMain, LPCSTR attr, LPCSTR value)
+{
+    tXmlEleP ele;
+
+    if (tagDoc->Parse(tag, tagEnd - tag) != kXmlSuccess) {
+        return false; // not self-closing
+    }
+    ele = tagDoc->FirstChildElement(XN_ITEM);
+    return ele && ele->Attribute(XA_FOLDERNAME, mbMain) && (!attr || ele->Attribute(attr, value));
+}
+
+/** @return the number of Item elements in doc's ScintillaContextMenu */
+INT countItems(tXmlDocP doc)
+{
+    INT count = 0;
+    tXmlEleP itemEle;
+    tXmlHnd docHnd(doc);
+
+    itemEle = docHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SCINTILLACONTEXTMENU).FirstChildElement(XN_ITEM).ToElement();
+    for (; itemEle; itemEle = itemEle->NextSiblingElement(XN_ITEM)) {
+        ++count;
+    }
+    return count;
+}
+
 } // end namespace
 
 } // end namespace NppPlugin
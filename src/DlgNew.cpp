@@ -111,9 +111,9 @@ bool onOk(HWND hDlg)
         msg::show(L"Missing file name.", M_WARN);
         return false;
     }
-    ::StringCchCopyW(dstPathname, MAX_PATH, cfg::getStr(kSessionDirectory));
+    ::StringCchCopyW(dstPathname, MAX_PATH, cfg::get<kSessionDirectory>());
     ::StringCchCatW(dstPathname, MAX_PATH, newName);
-    ::StringCchCatW(dstPathname, MAX_PATH, cfg::getStr(kSessionExtension));
+    ::StringCchCatW(dstPathname, MAX_PATH, cfg::get<kSessionExtension>());
 
     if (dlg::getCheck(hDlg, IDC_NEW_RAD_EMPTY)) {
         succ = newAsEmpty(dstPathname);
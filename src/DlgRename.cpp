@@ -94,9 +94,9 @@ bool onOk(HWND hDlg)
         msg::show(L"Missing file name.", M_WARN);
         return false;
     }
-    ::StringCchCopyW(dstPathname, MAX_PATH, cfg::getStr(kSessionDirectory));
+    ::StringCchCopyW(dstPathname, MAX_PATH, cfg::get<kSessionDirectory>());
     ::StringCchCatW(dstPathname, MAX_PATH, newName);
-    ::StringCchCatW(dstPathname, MAX_PATH, cfg::getStr(kSessionExtension));
+    ::StringCchCatW(dstPathname, MAX_PATH, cfg::get<kSessionExtension>());
 
     // Set the source file that will be renamed.
     app_getSessionFile(_dialogData->selectedSessionIndex, srcPathname);
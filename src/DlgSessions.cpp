@@ -22,6 +22,7 @@
 #include "DlgRename.h"
 #include "DlgDelete.h"
 #include "Util.h"
+#include "Perf.h"
 #include "res\resource.h"
 #include <strsafe.h>
 
@@ -49,7 +50,6 @@ bool onPrevious(HWND hDlg);
 INT onVirtualKey(HWND hDlg, WCHAR vKey);
 INT getSelSesIdx(HWND hDlg);
 void populateFiltersList(HWND hDlg);
-bool isFiltered(LPCWSTR sesName);
 void getSessionMark(Session *ses, LPWSTR buf);
 bool populateSessionsList(HWND hDlg, INT sesSelIdx = SI_CURRENT);
 void onResize(HWND hDlg, INT dlgW = 0, INT dlgH = 0);
@@ -198,15 +198,15 @@ void onInit(HWND hDlg)
         _minWidth = r.right - r.left;
         _minHeight = r.bottom - r.top;
     }
-    dlg::setCheck(hDlg, IDC_SES_CHK_WILD, cfg::getBool(kUseFilterWildcards));
-    dlg::setCheck(hDlg, IDC_SES_CHK_LIC, cfg::getBool(kLoadIntoCurrent));
-    dlg::setCheck(hDlg, IDC_SES_CHK_LWC, cfg::getBool(kLoadWithoutClosing));
+    dlg::setCheck(hDlg, IDC_SES_CHK_WILD, cfg::get<kUseFilterWildcards>());
+    dlg::setCheck(hDlg, IDC_SES_CHK_LIC, cfg::get<kLoadIntoCurrent>());
+    dlg::setCheck(hDlg, IDC_SES_CHK_LWC, cfg::get<kLoadWithoutClosing>());
     alpha = cfg::isSortAlpha();
     dlg::setCheck(hDlg, IDC_SES_RAD_ALPHA, alpha);
     dlg::setCheck(hDlg, IDC_SES_RAD_DATE, !alpha);
     populateFiltersList(hDlg);
     populateSessionsList(hDlg);
-    INT w = cfg::getInt(kSessionsDialogWidth), h = cfg::getInt(kSessionsDialogHeight);
+    INT w = cfg::get<kSessionsDialogWidth>(), h = cfg::get<kSessionsDialogHeight>();
     if (w <= 0 || h <= 0) {
         w = 0;
         h = 0;
@@ -222,6 +222,7 @@ void onInit(HWND hDlg)
 void closeDialog(HWND hDlg, INT_PTR nResult)
 {
     LOG("Closing sessions dialog with %u.", nResult);
+    cfg::saveIfDirty(); // the dialog size may have changed
     ::EndDialog(hDlg, nResult);
 }
 
@@ -434,33 +435,6 @@ void populateFiltersList(HWND hDlg)
     }
 }
 
-/** Filters the current and previous sessions and any session that matches the
-    filter. No filter or '*' filters everything.
-    @return true if sesName should be displayed in the sessions list, else false */
-bool isFiltered(LPCWSTR sesName)
-{
-    INT sesIdx = app_getSessionIndex(sesName);
-
-    if (_currentFilter[0] == 0 ||
-        (_currentFilter[0] == L'*' && _currentFilter[1] == 0) ||
-        app_getCurrentIndex() == sesIdx ||
-        app_getPreviousIndex() == sesIdx
-    ) {
-        return true;
-    }
-    if (cfg::getBool(kUseFilterWildcards)) {
-        if (str::wildcardMatchI(_currentFilter, sesName)) {
-            return true;
-        }
-    }
-    else {
-        if (::_wcsnicmp(_currentFilter, sesName, wcslen(_currentFilter)) == 0) {
-            return true;
-        }
-    }
-    return false;
-}
-
 /** Determines the mark to be used for ses, if any, and writes it to buf. */
 void getSessionMark(Session *ses, LPWSTR buf)
 {
@@ -490,6 +464,7 @@ bool populateSessionsList(HWND hDlg, INT sesSelIdx)
     WCHAR buf[SES_NAME_BUF_LEN + 3];
     INT lbIdx, lbSelIdx = -1, sesIdx, sesCount;
     INT tabStops[1] = {8};
+    TraceScope trc("dlgSes::populateSessionsList");
 
     LOGF("%i", sesSelIdx);
     hLst = ::GetDlgItem(hDlg, IDC_SES_LST_SES);
@@ -501,21 +476,16 @@ bool populateSessionsList(HWND hDlg, INT sesSelIdx)
         if (sesSelIdx == SI_CURRENT) {
             sesSelIdx = app_getCurrentIndex();
         }
+        app_filterSessions(_currentFilter);
         for (sesIdx = 0; sesIdx < sesCount; ++sesIdx) {
             ses = app_getSessionObject(sesIdx);
-            if (ses) {
-                if (isFiltered(ses->name)) {
-                    ses->isVisible = true;
-                    getSessionMark(ses, buf);
-                    ::StringCchCatW(buf, SES_NAME_BUF_LEN + 3, ses->name);
-                    lbIdx = (INT)::SendMessage(hLst, LB_INSERTSTRING, -1, (LPARAM)buf);
-                    ::SendMessage(hLst, LB_SETITEMDATA, lbIdx, (LPARAM)ses);
-                    if (sesIdx == sesSelIdx) {
-                        lbSelIdx = lbIdx;
-                    }
-                }
-                else {
-                    ses->isVisible = false;
+            if (ses && ses->isVisible) {
+                getSessionMark(ses, buf);
+                ::StringCchCatW(buf, SES_NAME_BUF_LEN + 3, ses->name);
+                lbIdx = (INT)::SendMessage(hLst, LB_INSERTSTRING, -1, (LPARAM)buf);
+                ::SendMessage(hLst, LB_SETITEMDATA, lbIdx, (LPARAM)ses);
+                if (sesIdx == sesSelIdx) {
+                    lbSelIdx = lbIdx;
                 }
             }
         }
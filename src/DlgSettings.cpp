@@ -20,6 +20,7 @@
 #include "DlgSettings.h"
 #include "Util.h"
 #include "ContextMenu.h"
+#include "Perf.h"
 #include "res\resource.h"
 #include <commdlg.h>
 #include <shlobj.h>
@@ -41,6 +42,7 @@ INT onOk(HWND hDlg);
 void onResize(HWND hDlg, INT w = 0, INT h = 0);
 void onGetMinSize(HWND hDlg, LPMINMAXINFO p);
 bool getFolderName(HWND parent, LPWSTR buf);
+void showStats();
 
 } // end namespace
 
@@ -82,7 +84,7 @@ INT_PTR CALLBACK dlgCfg_msgProc(HWND hDlg, UINT uMessage, WPARAM wParam, LPARAM
             case IDC_CFG_CHK_CTXM:
                 if (!_inInit && ntfy == BN_CLICKED) {
                     _opChanged = true;
-                    if (cfg::getBool(kUseContextMenu) && !dlg::getCheck(hDlg, IDC_CFG_CHK_CTXM)) {
+                    if (cfg::get<kUseContextMenu>() && !dlg::getCheck(hDlg, IDC_CFG_CHK_CTXM)) {
                         ctx::unload();
                     }
                 }
@@ -95,6 +97,12 @@ INT_PTR CALLBACK dlgCfg_msgProc(HWND hDlg, UINT uMessage, WPARAM wParam, LPARAM
                 }
                 status = TRUE;
                 break;
+            case IDC_CFG_BTN_STA:
+                if (!_inInit && ntfy == BN_CLICKED) {
+                    showStats();
+                }
+                status = TRUE;
+                break;
             case IDC_CFG_BTN_BRW:
                 if (!_inInit && ntfy == BN_CLICKED) {
                     WCHAR pthBuf[MAX_PATH];
@@ -143,20 +151,20 @@ void onInit(HWND hDlg)
         _minHeight = r.bottom - r.top;
     }
     // init control values
-    dlg::setCheck(hDlg, IDC_CFG_CHK_ASV,  cfg::getBool(kAutomaticSave));
-    dlg::setCheck(hDlg, IDC_CFG_CHK_ALD,  cfg::getBool(kAutomaticLoad));
-    dlg::setCheck(hDlg, IDC_CFG_CHK_LIC,  cfg::getBool(kLoadIntoCurrent));
-    dlg::setCheck(hDlg, IDC_CFG_CHK_LWC,  cfg::getBool(kLoadWithoutClosing));
-    dlg::setCheck(hDlg, IDC_CFG_CHK_SITB, cfg::getBool(kShowInTitlebar));
-    dlg::setCheck(hDlg, IDC_CFG_CHK_SISB, cfg::getBool(kShowInStatusbar));
-    dlg::setCheck(hDlg, IDC_CFG_CHK_GBKM, cfg::getBool(kUseGlobalProperties));
-    dlg::setCheck(hDlg, IDC_CFG_CHK_CTXM, cfg::getBool(kUseContextMenu));
-    dlg::setText(hDlg, IDC_CFG_ETX_DIR, cfg::getStr(kSessionDirectory));
-    dlg::setText(hDlg, IDC_CFG_ETX_EXT, cfg::getStr(kSessionExtension));
+    dlg::setCheck(hDlg, IDC_CFG_CHK_ASV,  cfg::get<kAutomaticSave>());
+    dlg::setCheck(hDlg, IDC_CFG_CHK_ALD,  cfg::get<kAutomaticLoad>());
+    dlg::setCheck(hDlg, IDC_CFG_CHK_LIC,  cfg::get<kLoadIntoCurrent>());
+    dlg::setCheck(hDlg, IDC_CFG_CHK_LWC,  cfg::get<kLoadWithoutClosing>());
+    dlg::setCheck(hDlg, IDC_CFG_CHK_SITB, cfg::get<kShowInTitlebar>());
+    dlg::setCheck(hDlg, IDC_CFG_CHK_SISB, cfg::get<kShowInStatusbar>());
+    dlg::setCheck(hDlg, IDC_CFG_CHK_GBKM, cfg::get<kUseGlobalProperties>());
+    dlg::setCheck(hDlg, IDC_CFG_CHK_CTXM, cfg::get<kUseContextMenu>());
+    dlg::setText(hDlg, IDC_CFG_ETX_DIR, cfg::get<kSessionDirectory>());
+    dlg::setText(hDlg, IDC_CFG_ETX_EXT, cfg::get<kSessionExtension>());
     // focus the first edit control
     dlg::focus(hDlg, IDC_CFG_ETX_DIR);
     // resize, center and show the window
-    INT w = cfg::getInt(kSettingsDialogWidth), h = cfg::getInt(kSettingsDialogHeight);
+    INT w = cfg::get<kSettingsDialogWidth>(), h = cfg::get<kSettingsDialogHeight>();
     if (w <= 0 || h <= 0) {
         w = 0;
         h = 0;
@@ -170,6 +178,7 @@ void onInit(HWND hDlg)
 void closeDialog(HWND hDlg, INT_PTR nResult)
 {
     LOG("Closing settings dialog with %u.", nResult);
+    cfg::saveIfDirty(); // the dialog size may have changed
     ::EndDialog(hDlg, nResult);
 }
 
@@ -228,7 +237,8 @@ void onResize(HWND hDlg, INT dlgW, INT dlgH)
     // Resize the Directory and Extension edit boxes
     dlg::adjToEdge(hDlg, IDC_CFG_ETX_DIR, dlgW, dlgH, 4, IDC_CFG_ETX_WRO, 0);
     dlg::adjToEdge(hDlg, IDC_CFG_ETX_EXT, dlgW, dlgH, 4, IDC_CFG_ETX_WRO, 0);
-    // Move the OK and Cancel buttons
+    // Move the Stats, OK and Cancel buttons
+    dlg::adjToEdge(hDlg, IDC_CFG_BTN_STA, dlgW, dlgH, 2, 0, IDC_CFG_BTN_YBO);
     dlg::adjToEdge(hDlg, IDOK, dlgW, dlgH, 1|2, IDC_CFG_BTN_OK_XRO, IDC_CFG_BTN_YBO);
     dlg::adjToEdge(hDlg, IDCANCEL, dlgW, dlgH, 1|2, IDC_CFG_BTN_CAN_XRO, IDC_CFG_BTN_YBO, true);
     // Save new dialog size
@@ -272,6 +282,15 @@ bool getFolderName(HWND parent, LPWSTR buf)
     return ok;
 }
 
+/** Displays the session load and save timing statistics. */
+void showStats()
+{
+    WCHAR buf[1024];
+
+    prf::formatStats(buf, 1024);
+    msg::show(buf, L"Session Manager Statistics", MB_ICONINFORMATION);
+}
+
 } // end namespace
 
 } // end namespace NppPlugin
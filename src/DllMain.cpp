@@ -21,6 +21,9 @@
 #include "Settings.h"
 #include "Properties.h"
 #include "ContextMenu.h"
+#include "Tasks.h"
+#include "Perf.h"
+#include "Log.h"
 
 using namespace NppPlugin::api;
 
@@ -40,16 +43,22 @@ BOOL APIENTRY DllMain(HINSTANCE hInstance, DWORD dwReason, LPVOID lpReserved)
         case DLL_PROCESS_ATTACH:
             if (++_dllCount == 1) {
                 sys_onLoad(hInstance);
+                lgr_onLoad();
+                tsk_onLoad();
+                prf_onLoad();
                 app_onLoad();
                 mnu_onLoad();
             }
             break;
         case DLL_PROCESS_DETACH:
             if (--_dllCount == 0) {
+                tsk_onUnload();
                 ctx_onUnload();
                 mnu_onUnload();
                 app_onUnload();
                 cfg_onUnload();
+                prf_onUnload();
+                lgr_onUnload();
                 sys_onUnload();
             }
             break;
@@ -0,0 +1,391 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Loader.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Notepad++ does not return from NPPM_LOADSESSION until every file in the
+    session is open. For large sessions the session file is instead split into
+    a sequence of small session files, each loaded without closing the files
+    already open. The first contains only the active file of each view, so the
+    user can start working right away. The rest are loaded from a timer, which
+    Windows only fires when the message queue is otherwise empty. Since each
+    batch is copied from the session file after it was updated from the global
+    properties, every batch gets the global properties too.
+
+    Notepad++ adds new tabs at the end of a view. The files before the active
+    file are loaded first, in session order, and after each batch the active
+    tab is moved forward past the ones just added. The files after it are then
+    loaded in session order, so the tabs end up in the order they were saved
+    in. Notepad++ before version 7 cannot move tabs, so there the first batch
+    contains the files of each view up to and including its active file.
+*/
+
+#include "System.h"
+#include "SessionMgr.h"
+#include "Loader.h"
+#include "Timers.h"
+#include "Util.h"
+#include "Perf.h"
+#include <strsafe.h>
+#include <cstdlib>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// XML nodes
+LPCSTR const XN_NOTEPADPLUS = xmlIntern("NotepadPlus"); ///< root node
+LPCSTR const XN_SESSION     = xmlIntern("Session");
+LPCSTR const XN_MAINVIEW    = xmlIntern("mainView");
+LPCSTR const XN_SUBVIEW     = xmlIntern("subView");
+LPCSTR const XN_FILE        = xmlIntern("File");
+
+/// XML attributes
+LPCSTR const XA_ACTIVEVIEW  = xmlIntern("activeView");
+LPCSTR const XA_ACTIVEINDEX = xmlIntern("activeIndex");
+LPCSTR const XA_FILENAME    = xmlIntern("filename");
+
+/// Milliseconds between batches. Timers only fire when NPP is idle.
+#define BATCH_DELAY_MS 10
+
+/// First NPP major version with IDM_VIEW_TAB_MOVEFORWARD
+#define NPP_VER_MOVE_TABS 7
+
+#define BATCH_FILE_NAME L"loading.tmp"
+
+const INT kViews = 2;
+LPCSTR _viewNames[kViews] = { XN_MAINVIEW, XN_SUBVIEW };
+
+tXmlDocP _sesDoc = NULL;        ///< the session being loaded
+tXmlEleP _activeFile[kViews];   ///< the active File element in each view
+tXmlEleP _prevFile[kViews];     ///< the next File element before the active one to load in each view
+tXmlEleP _nextFile[kViews];     ///< the next File element after the active one to load in each view
+INT _prevCount[kViews];         ///< how many files before the active one the last batch loaded
+INT _activeIdx[kViews];         ///< tab index of each view's active file, or -1
+INT _activeView;
+INT _batchSize;
+bool _inBatch = false;          ///< true while NPP loads a batch and its tabs are arranged
+WCHAR _batchFile[MAX_PATH];
+tXmlDoc _batchDoc;              ///< reused for each batch so its memory pools stay allocated
+
+void stop();
+void onBatchTimer();
+bool loadNextBatch();
+bool loadBatch(bool first);
+void moveActiveTab(INT view, INT count);
+tXmlEleP cloneElement(tXmlDocP doc, const tinyxml2::XMLElement *src);
+tXmlEleP findFile(tXmlEleP viewEle, INT index);
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+namespace ldr {
+
+/** Loads the active file of each view in sesFile, then starts the timer that
+    loads the rest in batches of batchSize files. When all are loaded
+    app_onBatchesLoaded is called.
+    @return false if nothing was loaded because sesFile could not be read or it
+    does not have more than threshold files, in which case the caller should
+    load it the usual way */
+bool loadFirstBatch(LPCWSTR sesFile, INT threshold, INT batchSize)
+{
+    INT v, fileCount = 0;
+    bool canMoveTabs;
+    tXmlError xmlErr;
+    tXmlEleP sesEle, viewEle, fileEle;
+
+    LOGF("%S, %i, %i", sesFile, threshold, batchSize);
+
+    stop();
+    ::StringCchCopyW(_batchFile, MAX_PATH, sys_getCfgDir());
+    ::StringCchCatW(_batchFile, MAX_PATH, BATCH_FILE_NAME);
+    _sesDoc = new tXmlDoc();
+    PRF_TRACE("xml parse session", xmlErr = _sesDoc->LoadFile(sesFile));
+    if (xmlErr != kXmlSuccess) {
+        stop();
+        return false;
+    }
+    tXmlHnd sesDocHnd(_sesDoc);
+    sesEle = sesDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SESSION).ToElement();
+    if (!sesEle) {
+        stop();
+        return false;
+    }
+    canMoveTabs = HIWORD(sys_getNppVer()) >= NPP_VER_MOVE_TABS;
+    for (v = 0; v < kViews; ++v) {
+        _activeFile[v] = NULL;
+        _prevFile[v] = NULL;
+        _nextFile[v] = NULL;
+        _prevCount[v] = 0;
+        _activeIdx[v] = -1;
+        viewEle = sesEle->FirstChildElement(_viewNames[v]);
+        if (viewEle) {
+            _nextFile[v] = viewEle->FirstChildElement(XN_FILE);
+            _activeFile[v] = findFile(viewEle, viewEle->IntAttribute(XA_ACTIVEINDEX));
+            if (!_activeFile[v]) {
+                _activeFile[v] = _nextFile[v];
+            }
+            for (fileEle = _nextFile[v]; fileEle; fileEle = fileEle->NextSiblingElement(XN_FILE)) {
+                ++fileCount;
+            }
+            if (canMoveTabs && _activeFile[v]) {
+                // The first batch loads only the active file. Later batches
+                // load the files before it, then the files after it.
+                if (_nextFile[v] != _activeFile[v]) {
+                    _prevFile[v] = _nextFile[v];
+                }
+                _nextFile[v] = _activeFile[v];
+            }
+        }
+    }
+    if (fileCount <= threshold) {
+        stop();
+        return false;
+    }
+    _batchSize = batchSize > 0 ? batchSize : 1;
+    _activeView = sesEle->IntAttribute(XA_ACTIVEVIEW);
+
+    _inBatch = true;
+    if (!loadBatch(true)) {
+        _inBatch = false;
+        stop();
+        return false;
+    }
+    // New tabs are added after the existing ones, so these indexes stay valid
+    // until moveActiveTab changes them.
+    for (v = 0; v < kViews; ++v) {
+        if (_activeFile[v]) {
+            _activeIdx[v] = (INT)::SendMessageW(sys_getNppHandle(), NPPM_GETCURRENTDOCINDEX, 0, v);
+        }
+    }
+    _inBatch = false;
+    LOG("Loaded the first of %i files", fileCount);
+
+    tmr::set(kTimerLoadBatch, BATCH_DELAY_MS, onBatchTimer);
+    return true;
+}
+
+/** @return true if batches remain to be loaded */
+bool isLoading()
+{
+    return _sesDoc != NULL;
+}
+
+/** @return true while NPP is loading a batch, so the notifications it sends
+    are caused by the loader and not by the user */
+bool isLoadingBatch()
+{
+    return _inBatch;
+}
+
+/** Stops loading batches. Files already loaded stay open. If batches
+    remained app_onBatchesCancelled is called. */
+void cancel()
+{
+    if (_sesDoc) {
+        stop();
+        app_onBatchesCancelled();
+    }
+}
+
+} // end namespace NppPlugin::ldr
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/** Stops loading batches without notifying the app. */
+void stop()
+{
+    tmr::cancel(kTimerLoadBatch);
+    if (_sesDoc) {
+        delete _sesDoc;
+        _sesDoc = NULL;
+        ::DeleteFileW(_batchFile);
+    }
+}
+
+void onBatchTimer()
+{
+    bool more;
+
+    _inBatch = true;
+    more = loadNextBatch();
+    _inBatch = false;
+    if (more) {
+        tmr::set(kTimerLoadBatch, BATCH_DELAY_MS, onBatchTimer);
+    }
+    else {
+        stop();
+        app_onBatchesLoaded();
+    }
+}
+
+/** Loads the next batch and re-activates the files that were active.
+    @return true if more batches remain */
+bool loadNextBatch()
+{
+    INT v;
+    HWND hNpp = sys_getNppHandle();
+
+    if (!loadBatch(false)) {
+        return false;
+    }
+    // Move each active tab after the files loaded before it.
+    for (v = 0; v < kViews; ++v) {
+        if (_prevCount[v] > 0 && _activeIdx[v] >= 0) {
+            moveActiveTab(v, _prevCount[v]);
+        }
+    }
+    // Activate the inactive view first so the active view keeps the focus.
+    for (v = 0; v < kViews; ++v) {
+        if (v != _activeView && _activeIdx[v] >= 0) {
+            ::SendMessageW(hNpp, NPPM_ACTIVATEDOC, v, _activeIdx[v]);
+        }
+    }
+    if (_activeView >= 0 && _activeView < kViews && _activeIdx[_activeView] >= 0) {
+        ::SendMessageW(hNpp, NPPM_ACTIVATEDOC, _activeView, _activeIdx[_activeView]);
+    }
+    return _prevFile[0] != NULL || _prevFile[1] != NULL || _nextFile[0] != NULL || _nextFile[1] != NULL;
+}
+
+/** Writes the first batch (if first is true) or the next batch of files to
+    the batch file then has NPP load it. The first batch has the active file of
+    each view, preceded by the files before it if they are not loaded later.
+    Later batches have the remaining files before the active files, then the
+    files after them.
+    @return false if there was nothing to load or the batch file could not be
+    written */
+bool loadBatch(bool first)
+{
+    INT v, viewCount, count = 0;
+    bool done;
+    LPSTR buf = NULL;
+    size_t bufLen = 0;
+    LPCSTR filename;
+    tXmlError xmlErr;
+    tXmlEleP viewEle, fileEle;
+    tXmlDoc &batchDoc = _batchDoc;
+
+    batchDoc.Clear();
+    batchDoc.InsertEndChild(batchDoc.NewDeclaration());
+    tXmlEleP nppEle = batchDoc.NewElement(XN_NOTEPADPLUS);
+    batchDoc.InsertEndChild(nppEle);
+    tXmlEleP sesEle = batchDoc.NewElement(XN_SESSION);
+    nppEle->InsertEndChild(sesEle);
+    sesEle->SetAttribute(XA_ACTIVEVIEW, _activeView);
+    for (v = 0; v < kViews; ++v) {
+        viewEle = batchDoc.NewElement(_viewNames[v]);
+        sesEle->InsertEndChild(viewEle);
+        if (first) {
+            // The active file is the last one in this batch.
+            viewCount = 0;
+            while (_nextFile[v]) {
+                viewEle->InsertEndChild(cloneElement(&batchDoc, _nextFile[v]));
+                ++viewCount;
+                done = _nextFile[v] == _activeFile[v];
+                _nextFile[v] = _nextFile[v]->NextSiblingElement(XN_FILE);
+                if (done) {
+                    break;
+                }
+            }
+            viewEle->SetAttribute(XA_ACTIVEINDEX, viewCount > 0 ? viewCount - 1 : 0);
+            count += viewCount;
+            continue;
+        }
+        viewEle->SetAttribute(XA_ACTIVEINDEX, 0);
+        _prevCount[v] = 0;
+        while (_prevFile[v] && count < _batchSize) {
+            viewEle->InsertEndChild(cloneElement(&batchDoc, _prevFile[v]));
+            ++count;
+            ++_prevCount[v];
+            _prevFile[v] = _prevFile[v]->NextSiblingElement(XN_FILE);
+            if (_prevFile[v] == _activeFile[v]) {
+                _prevFile[v] = NULL;
+            }
+        }
+        while (!_prevFile[v] && _nextFile[v] && count < _batchSize) {
+            viewEle->InsertEndChild(cloneElement(&batchDoc, _nextFile[v]));
+            ++count;
+            _nextFile[v] = _nextFile[v]->NextSiblingElement(XN_FILE);
+        }
+    }
+    if (count == 0) {
+        return false;
+    }
+    // Re-encode pathnames the way NPP expects them. See prp::updateSessionFromGlobal.
+    for (viewEle = sesEle->FirstChildElement(); viewEle; viewEle = viewEle->NextSiblingElement()) {
+        for (fileEle = viewEle->FirstChildElement(XN_FILE); fileEle; fileEle = fileEle->NextSiblingElement(XN_FILE)) {
+            filename = fileEle->Attribute(XA_FILENAME);
+            if (filename) {
+                if (!str::utf8ToAscii(filename, &buf, &bufLen)) {
+                    return false;
+                }
+                fileEle->SetAttribute(XA_FILENAME, buf);
+            }
+        }
+    }
+    if (buf) {
+        std::free(buf);
+    }
+    // Only NPP reads the batch file, so it is written without indentation.
+    PRF_TRACE("xml write batch", xmlErr = batchDoc.SaveFile(_batchFile, true));
+    if (xmlErr != kXmlSuccess) {
+        LOG("Error %u saving the batch file.", xmlErr);
+        return false;
+    }
+    LOGG(10, "Loading a batch of %i files", count);
+    ::SendMessageW(sys_getNppHandle(), NPPM_LOADSESSION, 0, (LPARAM)_batchFile);
+    return true;
+}
+
+/** Moves the active file's tab in view forward count places, past the tabs
+    that were just added after it. */
+void moveActiveTab(INT view, INT count)
+{
+    HWND hNpp = sys_getNppHandle();
+
+    ::SendMessageW(hNpp, NPPM_ACTIVATEDOC, view, _activeIdx[view]);
+    while (count-- > 0) {
+        ::SendMessageW(hNpp, NPPM_MENUCOMMAND, 0, IDM_VIEW_TAB_MOVEFORWARD);
+        ++_activeIdx[view];
+    }
+}
+
+/** @return a deep copy of src, owned by doc */
+tXmlEleP cloneElement(tXmlDocP doc, const tinyxml2::XMLElement *src)
+{
+    tXmlEleP dst = src->ShallowClone(doc)->ToElement();
+    for (const tinyxml2::XMLElement *child = src->FirstChildElement(); child; child = child->NextSiblingElement()) {
+        dst->InsertEndChild(cloneElement(doc, child));
+    }
+    return dst;
+}
+
+/** @return the File element at index in viewEle, or NULL */
+tXmlEleP findFile(tXmlEleP viewEle, INT index)
+{
+    tXmlEleP fileEle = viewEle->FirstChildElement(XN_FILE);
+    while (fileEle && index-- > 0) {
+        fileEle = fileEle->NextSiblingElement(XN_FILE);
+    }
+    return fileEle;
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
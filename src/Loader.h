@@ -0,0 +1,39 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Loader.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#ifndef NPP_PLUGIN_LOADER_H
+#define NPP_PLUGIN_LOADER_H
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+/** @namespace NppPlugin::ldr Implements progressive session loading. The
+    active file of each view is opened first, then the remaining files are
+    opened in batches when Notepad++ is idle. */
+
+namespace ldr {
+
+bool loadFirstBatch(LPCWSTR sesFile, INT threshold, INT batchSize);
+bool isLoading();
+bool isLoadingBatch();
+void cancel();
+
+} // end namespace NppPlugin::ldr
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_LOADER_H
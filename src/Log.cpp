@@ -0,0 +1,343 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Log.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Messages are formatted by the calling thread into a slot of a fixed ring
+    buffer, then the writer thread, which keeps the log file open, writes
+    them in batches. The ring is a bounded queue in which each slot has a
+    sequence number: a slot is free for position p when its number is p, and
+    holds a message for position p when its number is p + 1. Threads claim a
+    position with a compare-exchange, so logging never blocks. If the ring
+    is full the message is dropped and counted, and the writer notes the
+    number dropped in the log. Level filtering is done by the LOGG macros
+    before any formatting.
+
+    Before start and after stop, messages are written immediately, opening
+    and closing the file each time.
+*/
+
+#include "System.h"
+#include "SessionMgr.h"
+#include "Util.h"
+#include "Perf.h"
+#include "Log.h"
+#include <process.h>
+#include <strsafe.h>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+#define LOG_SLOTS     256  ///< must be a power of 2
+#define LOG_LINE_LEN  512  ///< longer messages are truncated
+#define LOG_BATCH_LEN 16384
+#define LOG_FLUSH_MS  200  ///< the writer wakes at least this often
+
+typedef struct Slot_tag {
+    volatile LONG seq;
+    INT           len;
+    CHAR          text[LOG_LINE_LEN];
+} Slot;
+
+Slot _ring[LOG_SLOTS];
+volatile LONG _head = 0;     ///< next position to claim
+volatile LONG _tail = 0;     ///< next position to write, changed only by the writer
+volatile LONG _dropped = 0;  ///< messages dropped since the last report
+volatile LONG _running = 0;
+volatile LONG _stopping = 0;
+volatile LONG _writers = 0;  ///< write calls that may be queuing a message
+HANDLE _hThread = NULL;
+HANDLE volatile _hWakeEvent = NULL; ///< cleared before it is closed
+HANDLE _hFile = INVALID_HANDLE_VALUE; ///< owned by the writer thread
+CHAR _batch[LOG_BATCH_LEN];           ///< owned by the writer thread
+INT _batchLen = 0;
+WCHAR _logFile[MAX_PATH];             ///< guarded by _fileLock
+volatile LONG _fileChanged = 0;
+CRITICAL_SECTION _fileLock;
+
+unsigned __stdcall writerProc(LPVOID arg);
+INT format(LPSTR buf, INT bufLen, LPCSTR fmt, va_list argptr);
+void drain();
+void appendToBatch(LPCSTR text, INT len);
+void flushBatch();
+void openFile();
+void closeFile();
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+namespace api {
+
+void lgr_onLoad()
+{
+    INT i;
+
+    ::InitializeCriticalSection(&_fileLock);
+    _logFile[0] = 0;
+    for (i = 0; i < LOG_SLOTS; ++i) {
+        _ring[i].seq = i;
+    }
+}
+
+/** Called from DllMain so it must not wait for the writer thread. Normally
+    lgr::stop has already been called on NPPN_SHUTDOWN. */
+void lgr_onUnload()
+{
+    HANDLE hWake;
+
+    if (_hThread) {
+        ::InterlockedExchange(&_stopping, 1);
+        ::CloseHandle(_hThread);
+        _hThread = NULL;
+    }
+    hWake = (HANDLE)::InterlockedExchangePointer(&_hWakeEvent, NULL);
+    if (hWake) {
+        ::CloseHandle(hWake);
+    }
+    ::DeleteCriticalSection(&_fileLock);
+}
+
+} // end namespace NppPlugin::api
+
+//------------------------------------------------------------------------------
+
+namespace lgr {
+
+/** Starts the writer thread if logging is enabled and it is not already
+    running. */
+void start()
+{
+    unsigned threadId;
+
+    if (_hThread || !gDbgLvl) {
+        return;
+    }
+    ::InterlockedExchange(&_stopping, 0);
+    _hWakeEvent = ::CreateEventW(NULL, FALSE, FALSE, NULL); // auto-reset
+    if (!_hWakeEvent) {
+        return;
+    }
+    _hThread = (HANDLE)::_beginthreadex(NULL, 0, writerProc, NULL, 0, &threadId);
+    if (!_hThread) {
+        ::CloseHandle(_hWakeEvent);
+        _hWakeEvent = NULL;
+        return;
+    }
+    ::InterlockedExchange(&_running, 1);
+    LOGG(10, "Log writer thread %u started", threadId);
+}
+
+/** Writes all queued messages and stops the writer thread. Later messages
+    are written immediately. */
+void stop()
+{
+    HANDLE hWake;
+
+    if (!_hThread) {
+        return;
+    }
+    ::InterlockedExchange(&_running, 0);
+    // A write that saw _running set may still be queuing its message.
+    while (_writers) {
+        ::Sleep(0);
+    }
+    ::InterlockedExchange(&_stopping, 1);
+    ::SetEvent(_hWakeEvent);
+    ::WaitForSingleObject(_hThread, INFINITE);
+    ::CloseHandle(_hThread);
+    _hThread = NULL;
+    hWake = (HANDLE)::InterlockedExchangePointer(&_hWakeEvent, NULL);
+    ::CloseHandle(hWake);
+    // Messages queued while the writer was exiting
+    drain();
+    flushBatch();
+    closeFile();
+}
+
+/** Sets the log file. The writer thread reopens it before its next write. */
+void setFile(LPCWSTR logFile)
+{
+    ::EnterCriticalSection(&_fileLock);
+    ::StringCchCopyW(_logFile, MAX_PATH, logFile ? logFile : L"");
+    ::LeaveCriticalSection(&_fileLock);
+    ::InterlockedExchange(&_fileChanged, 1);
+}
+
+/** Formats a message with a timestamp and thread id, and queues it, or
+    writes it if the writer thread is not running. */
+void write(LPCSTR fmt, va_list argptr)
+{
+    LONG pos, dif;
+    Slot *slot;
+    FILE *fp;
+    HANDLE hWake;
+    CHAR line[LOG_LINE_LEN];
+
+    ::InterlockedIncrement(&_writers);
+    if (!_running) {
+        ::InterlockedDecrement(&_writers);
+        ::EnterCriticalSection(&_fileLock);
+        if (_logFile[0]) {
+            ::_wfopen_s(&fp, _logFile, L"ab");
+            if (fp) {
+                ::fwrite(line, 1, format(line, LOG_LINE_LEN, fmt, argptr), fp);
+                ::fclose(fp);
+            }
+        }
+        ::LeaveCriticalSection(&_fileLock);
+        return;
+    }
+    for (;;) {
+        pos = _head;
+        slot = &_ring[pos & (LOG_SLOTS - 1)];
+        dif = slot->seq - pos;
+        if (dif == 0) {
+            if (::InterlockedCompareExchange(&_head, pos + 1, pos) == pos) {
+                break;
+            }
+        }
+        else if (dif < 0) { // full
+            ::InterlockedIncrement(&_dropped);
+            prf::increment(kCountLogDropped);
+            ::InterlockedDecrement(&_writers);
+            return;
+        }
+    }
+    slot->len = format(slot->text, LOG_LINE_LEN, fmt, argptr);
+    ::InterlockedExchange(&slot->seq, pos + 1);
+    // Wake the writer early if the ring is half full.
+    if (pos - _tail >= LOG_SLOTS / 2) {
+        hWake = _hWakeEvent;
+        if (hWake) {
+            ::SetEvent(hWake);
+        }
+    }
+    ::InterlockedDecrement(&_writers);
+}
+
+} // end namespace NppPlugin::lgr
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+unsigned __stdcall writerProc(LPVOID arg)
+{
+    while (!_stopping) {
+        ::WaitForSingleObject(_hWakeEvent, LOG_FLUSH_MS);
+        drain();
+        flushBatch();
+    }
+    return 0;
+}
+
+/** Formats a log line ending with CRLF into buf.
+    @return the number of bytes written, not including the terminator */
+INT format(LPSTR buf, INT bufLen, LPCSTR fmt, va_list argptr)
+{
+    INT len;
+    SYSTEMTIME st;
+
+    ::GetLocalTime(&st);
+    len = ::_snprintf_s(buf, bufLen, _TRUNCATE, "%02u:%02u:%02u.%03u %5lu ",
+        st.wHour, st.wMinute, st.wSecond, st.wMilliseconds, ::GetCurrentThreadId());
+    if (len < 0) {
+        len = 0;
+    }
+    // Leave room for CRLF
+    ::_vsnprintf_s(buf + len, bufLen - len - 2, _TRUNCATE, fmt, argptr);
+    len += (INT)::strlen(buf + len);
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+    buf[len] = 0;
+    return len;
+}
+
+/** Moves all published messages from the ring to the batch buffer. */
+void drain()
+{
+    LONG pos, dropped;
+    Slot *slot;
+    CHAR note[64];
+
+    dropped = ::InterlockedExchange(&_dropped, 0);
+    if (dropped) {
+        ::StringCchPrintfA(note, 64, "%li log messages dropped\r\n", dropped);
+        appendToBatch(note, (INT)::strlen(note));
+    }
+    for (;;) {
+        pos = _tail;
+        slot = &_ring[pos & (LOG_SLOTS - 1)];
+        if (slot->seq != pos + 1) {
+            break;
+        }
+        appendToBatch(slot->text, slot->len);
+        ::InterlockedExchange(&slot->seq, pos + LOG_SLOTS);
+        ::InterlockedExchange(&_tail, pos + 1);
+    }
+}
+
+void appendToBatch(LPCSTR text, INT len)
+{
+    if (_batchLen + len > LOG_BATCH_LEN) {
+        flushBatch();
+    }
+    memcpy(_batch + _batchLen, text, len);
+    _batchLen += len;
+}
+
+/** Writes the batch buffer to the log file, opening it if needed. */
+void flushBatch()
+{
+    DWORD written;
+
+    if (_batchLen == 0) {
+        return;
+    }
+    if (_fileChanged || _hFile == INVALID_HANDLE_VALUE) {
+        openFile();
+    }
+    if (_hFile != INVALID_HANDLE_VALUE) {
+        ::WriteFile(_hFile, _batch, _batchLen, &written, NULL);
+    }
+    _batchLen = 0;
+}
+
+void openFile()
+{
+    closeFile();
+    ::InterlockedExchange(&_fileChanged, 0);
+    ::EnterCriticalSection(&_fileLock);
+    if (_logFile[0]) {
+        _hFile = ::CreateFileW(_logFile, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
+    ::LeaveCriticalSection(&_fileLock);
+}
+
+void closeFile()
+{
+    if (_hFile != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(_hFile);
+        _hFile = INVALID_HANDLE_VALUE;
+    }
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
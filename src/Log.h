@@ -0,0 +1,49 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Log.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#ifndef NPP_PLUGIN_LOG_H
+#define NPP_PLUGIN_LOG_H
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+/// @namespace NppPlugin::api Contains functions called only from DllMain.
+
+namespace api {
+
+void lgr_onLoad();
+void lgr_onUnload();
+
+} // end namespace NppPlugin::api
+
+//------------------------------------------------------------------------------
+/** @namespace NppPlugin::lgr Writes the debug log. While the writer thread is
+    running, messages are queued and written in batches; otherwise they are
+    written immediately. write may be called from any thread. */
+
+namespace lgr {
+
+void start();
+void stop();
+void setFile(LPCWSTR logFile);
+void write(LPCSTR format, va_list argptr);
+
+} // end namespace NppPlugin::lgr
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_LOG_H
@@ -15,6 +15,13 @@
     Session Manager creates a submenu in the Notepad++ Plugins menu. Those items
     can be customized via settings. Favorite sessions are listed after the About
     item.
+
+    NPP calls a menu item's function without arguments, so each favorite slot
+    needs its own function. These are instantiated from the cbFav template,
+    and FavCallbacks fills the menu items with them, splitting the range in
+    half at each level so the template nesting stays shallow. Each slot also
+    caches the index of its session, refreshed when the session list is read,
+    so a click does not search the list by name.
 */
 
 #include "System.h"
@@ -45,32 +52,12 @@ extern "C" {
     void cbLoadPrevious();
     void cbHelp();
     void cbAbout();
-    void cbFav1();
-    void cbFav2();
-    void cbFav3();
-    void cbFav4();
-    void cbFav5();
-    void cbFav6();
-    void cbFav7();
-    void cbFav8();
-    void cbFav9();
-    void cbFav10();
-    void cbFav11();
-    void cbFav12();
-    void cbFav13();
-    void cbFav14();
-    void cbFav15();
-    void cbFav16();
-    void cbFav17();
-    void cbFav18();
-    void cbFav19();
-    void cbFav20();
 };
 
 /// Menu config
 INT _menuItemsCount = MNU_BASE_MAX_ITEMS;
 WCHAR _menuMainLabel[MNU_MAX_NAME_LEN + 1];
-FuncItem _menuItems[] = {
+FuncItem _menuItems[MNU_LAST_FAV_IDX + 1] = {
     { EMPTY_STR, cbSessions,     0, false, NULL },
     { EMPTY_STR, cbSettings,     0, false, NULL },
     { EMPTY_STR, cbSaveCurrent,  0, false, NULL },
@@ -78,27 +65,25 @@ FuncItem _menuItems[] = {
     { EMPTY_STR, NULL,           0, false, NULL },
     { EMPTY_STR, cbHelp,         0, false, NULL },
     { EMPTY_STR, cbAbout,        0, false, NULL },
-    { EMPTY_STR, NULL,           0, false, NULL },
-    { EMPTY_STR, cbFav1,         0, false, NULL },
-    { EMPTY_STR, cbFav2,         0, false, NULL },
-    { EMPTY_STR, cbFav3,         0, false, NULL },
-    { EMPTY_STR, cbFav4,         0, false, NULL },
-    { EMPTY_STR, cbFav5,         0, false, NULL },
-    { EMPTY_STR, cbFav6,         0, false, NULL },
-    { EMPTY_STR, cbFav7,         0, false, NULL },
-    { EMPTY_STR, cbFav8,         0, false, NULL },
-    { EMPTY_STR, cbFav9,         0, false, NULL },
-    { EMPTY_STR, cbFav10,        0, false, NULL },
-    { EMPTY_STR, cbFav11,        0, false, NULL },
-    { EMPTY_STR, cbFav12,        0, false, NULL },
-    { EMPTY_STR, cbFav13,        0, false, NULL },
-    { EMPTY_STR, cbFav14,        0, false, NULL },
-    { EMPTY_STR, cbFav15,        0, false, NULL },
-    { EMPTY_STR, cbFav16,        0, false, NULL },
-    { EMPTY_STR, cbFav17,        0, false, NULL },
-    { EMPTY_STR, cbFav18,        0, false, NULL },
-    { EMPTY_STR, cbFav19,        0, false, NULL },
-    { EMPTY_STR, cbFav20,        0, false, NULL }
+    { EMPTY_STR, NULL,           0, false, NULL }
+    // favorites are filled by mnu_init
+};
+INT _favSesIdx[MNU_MAX_FAVS]; ///< session index of each favorite, may be stale
+
+void loadFavorite(INT favIdx);
+
+/// Menu callback for the favorite at favIdx
+template<INT favIdx> void cbFav() { loadFavorite(favIdx); }
+
+/// Sets the callbacks of count favorite menu items starting at favIdx
+template<INT favIdx, INT count> struct FavCallbacks {
+    static void fill(FuncItem *favItems) {
+        FavCallbacks<favIdx, count / 2>::fill(favItems);
+        FavCallbacks<favIdx + count / 2, count - count / 2>::fill(favItems);
+    }
+};
+template<INT favIdx> struct FavCallbacks<favIdx, 1> {
+    static void fill(FuncItem *favItems) { favItems[favIdx]._pFunc = cbFav<favIdx>; }
 };
 
 } // end namespace
@@ -128,6 +113,10 @@ void mnu_init()
     cfg::getStr(kMenuLabelSub5, _menuItems[5]._itemName, MNU_MAX_NAME_LEN);
     cfg::getStr(kMenuLabelSub6, _menuItems[6]._itemName, MNU_MAX_NAME_LEN);
     // favorites
+    FavCallbacks<0, MNU_MAX_FAVS>::fill(&_menuItems[MNU_FIRST_FAV_IDX]);
+    for (mnuIdx = 0; mnuIdx < MNU_MAX_FAVS; ++mnuIdx) {
+        _favSesIdx[mnuIdx] = SI_NONE;
+    }
     cfgIdx = 0;
     for (mnuIdx = MNU_FIRST_FAV_IDX; mnuIdx <= MNU_LAST_FAV_IDX; ++mnuIdx) {
         if (!cfg::getStr(kFavorites, cfgIdx++, _menuItems[mnuIdx]._itemName, MNU_MAX_NAME_LEN)) {
@@ -164,6 +153,17 @@ LPCWSTR mnu_getMenuLabel(INT mnuIdx)
     return lbl;
 }
 
+/** Looks up the session index of each favorite menu item. Called after the
+    session list is read. */
+void mnu_indexFavorites()
+{
+    INT favIdx, favCount = _menuItemsCount - MNU_FIRST_FAV_IDX;
+
+    for (favIdx = 0; favIdx < favCount; ++favIdx) {
+        _favSesIdx[favIdx] = app_getSessionIndex(_menuItems[MNU_FIRST_FAV_IDX + favIdx]._itemName);
+    }
+}
+
 //------------------------------------------------------------------------------
 
 namespace {
@@ -215,31 +215,19 @@ extern "C" void cbAbout()
     //LOG("strlen = %u", ::wcslen(m));
 }
 
-void loadFavorite(INT mnuOfs)
+/** Loads the session of the favorite at favIdx, using its cached index if
+    that session still has the favorite's name. */
+void loadFavorite(INT favIdx)
 {
-    app_loadSession(app_getSessionIndex(_menuItems[mnuOfs + MNU_BASE_MAX_ITEMS]._itemName));
-}
+    INT si = _favSesIdx[favIdx];
+    LPCWSTR favName = _menuItems[MNU_FIRST_FAV_IDX + favIdx]._itemName;
 
-extern "C" void cbFav1() { loadFavorite(1); }
-extern "C" void cbFav2() { loadFavorite(2); }
-extern "C" void cbFav3() { loadFavorite(3); }
-extern "C" void cbFav4() { loadFavorite(4); }
-extern "C" void cbFav5() { loadFavorite(5); }
-extern "C" void cbFav6() { loadFavorite(6); }
-extern "C" void cbFav7() { loadFavorite(7); }
-extern "C" void cbFav8() { loadFavorite(8); }
-extern "C" void cbFav9() { loadFavorite(9); }
-extern "C" void cbFav10() { loadFavorite(10); }
-extern "C" void cbFav11() { loadFavorite(11); }
-extern "C" void cbFav12() { loadFavorite(12); }
-extern "C" void cbFav13() { loadFavorite(13); }
-extern "C" void cbFav14() { loadFavorite(14); }
-extern "C" void cbFav15() { loadFavorite(15); }
-extern "C" void cbFav16() { loadFavorite(16); }
-extern "C" void cbFav17() { loadFavorite(17); }
-extern "C" void cbFav18() { loadFavorite(18); }
-extern "C" void cbFav19() { loadFavorite(19); }
-extern "C" void cbFav20() { loadFavorite(20); }
+    if (!app_isValidSessionIndex(si) || ::wcscmp(app_getSessionName(si), favName) != 0) {
+        si = app_getSessionIndex(favName);
+        _favSesIdx[favIdx] = si;
+    }
+    app_loadSession(si);
+}
 
 } // end namespace
 
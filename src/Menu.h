@@ -21,7 +21,7 @@
 namespace NppPlugin {
 
 const int MNU_BASE_MAX_ITEMS = 7;  ///< see _menuItemsCount
-const int MNU_MAX_FAVS       = 20;
+const int MNU_MAX_FAVS       = 200; ///< NPP's command IDs are shared by all plugins
 const int MNU_FIRST_FAV_IDX  = MNU_BASE_MAX_ITEMS + 1;
 const int MNU_LAST_FAV_IDX   = MNU_BASE_MAX_ITEMS + MNU_MAX_FAVS;
 const int MNU_MAX_NAME_LEN   = 63; ///< see nbChar in npp\PluginInterface.h
@@ -41,6 +41,7 @@ FuncItem* mnu_getItems(INT *pNum);
 //------------------------------------------------------------------------------
 
 LPCWSTR mnu_getMenuLabel(INT mnuIdx = -1);
+void mnu_indexFavorites();
 
 } // end namespace NppPlugin
 
@@ -0,0 +1,365 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Perf.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Each phase has a histogram of its times in microseconds. Bucket boundaries
+    are spaced four per power of two, so a percentile read from the histogram
+    is at most 25% above the true value. The maximum is exact. With a debug
+    log level of 5 or more every time is also logged.
+
+    With a debug log level of PRF_TRACE_LEVEL or more, trace events are also
+    recorded, from any thread, into a fixed array. On shutdown they are
+    written to trace.json in the config directory, in the Chrome trace
+    event format, which chrome://tracing and Perfetto can open. Each event
+    is a complete ("X") event with its start and duration in microseconds.
+    The phase statistics and counters are written to stats.json, so runs can
+    be compared by a script.
+*/
+
+#include "System.h"
+#include "SessionMgr.h"
+#include "Util.h"
+#include "Perf.h"
+#include <strsafe.h>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// Covers every 32-bit microsecond value. @see bucketOf
+#define PRF_BUCKETS 124
+/// Events recorded after this many are dropped
+#define PRF_TRACE_MAX 16384
+#define PRF_TRACE_FILE L"trace.json"
+#define PRF_STATS_FILE L"stats.json"
+
+typedef struct Phase_tag {
+    LPCWSTR name;
+    UINT    count;
+    UINT    max;
+    UINT    buckets[PRF_BUCKETS];
+} Phase;
+
+typedef struct TraceEvent_tag {
+    LPCSTR   name;     ///< set last, so an event without one is unfinished
+    DWORD    threadId;
+    PerfTime start;
+    PerfTime end;
+} TraceEvent;
+
+Phase _phases[kPhasesCount] = {
+    { L"Load" },
+    { L"  save outgoing" },
+    { L"  global properties" },
+    { L"  close files" },
+    { L"  open files" },
+    { L"  update bars" },
+    { L"Save" },
+    { L"  write session" },
+    { L"  global properties" }
+};
+
+LPCWSTR _counterNames[kCountersCount] = {
+    L"Automatic saves",
+    L"Automatic saves skipped",
+    L"Heap allocations",
+    L"Scratch allocations",
+    L"Log messages dropped"
+};
+
+volatile LONG _counters[kCountersCount]; ///< updated from any thread
+LONGLONG _ticksPerSec = 0;
+PerfTime _traceStart = 0;
+TraceEvent *_events = NULL;      ///< allocated by startTrace
+volatile LONG _eventCount = 0;   ///< may exceed PRF_TRACE_MAX, by the number dropped
+
+UINT bucketOf(UINT us);
+UINT bucketLimit(UINT bucket);
+UINT percentile(const Phase *phase, UINT pct);
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+namespace api {
+
+void prf_onLoad()
+{
+    LARGE_INTEGER freq;
+
+    ::QueryPerformanceFrequency(&freq);
+    _ticksPerSec = freq.QuadPart;
+}
+
+void prf_onUnload()
+{
+    if (_events) {
+        sys_free(_events);
+        _events = NULL;
+    }
+}
+
+} // end namespace NppPlugin::api
+
+//------------------------------------------------------------------------------
+
+namespace prf {
+
+/** @return the current value of the high-resolution counter */
+PerfTime now()
+{
+    LARGE_INTEGER t;
+
+    ::QueryPerformanceCounter(&t);
+    return t.QuadPart;
+}
+
+/** Records the time since start for phase. */
+void record(PhaseId phase, PerfTime start)
+{
+    UINT us;
+    LONGLONG elapsed = now() - start;
+    Phase *p = &_phases[phase];
+
+    if (_ticksPerSec <= 0 || elapsed < 0) {
+        return;
+    }
+    elapsed = elapsed * 1000000 / _ticksPerSec;
+    us = elapsed > UINT_MAX ? UINT_MAX : (UINT)elapsed;
+    ++p->count;
+    ++p->buckets[bucketOf(us)];
+    if (us > p->max) {
+        p->max = us;
+    }
+    LOGG(5, "%S: %.3f ms", p->name, us / 1000.0);
+}
+
+void getStats(PhaseId phase, PhaseStats *stats)
+{
+    const Phase *p = &_phases[phase];
+
+    stats->count = p->count;
+    stats->p50 = percentile(p, 50);
+    stats->p95 = percentile(p, 95);
+    stats->max = p->max;
+}
+
+void increment(CounterId counter)
+{
+    ::InterlockedIncrement(&_counters[counter]);
+}
+
+UINT getCount(CounterId counter)
+{
+    return (UINT)_counters[counter];
+}
+
+/** Writes a table of all phases' statistics, in milliseconds, followed by the
+    counters and the percentage of automatic saves suppressed, to buf. */
+void formatStats(LPWSTR buf, size_t bufLen)
+{
+    INT i;
+    UINT autoSaves;
+    PhaseStats stats;
+    WCHAR line[100];
+
+    ::StringCchCopyW(buf, bufLen, L"Phase: count, p50, p95, max (ms)\n\n");
+    for (i = 0; i < kPhasesCount; ++i) {
+        getStats((PhaseId)i, &stats);
+        ::StringCchPrintfW(line, 100, L"%s: %u, %.1f, %.1f, %.1f\n", _phases[i].name, stats.count,
+            stats.p50 / 1000.0, stats.p95 / 1000.0, stats.max / 1000.0);
+        ::StringCchCatW(buf, bufLen, line);
+    }
+    ::StringCchCatW(buf, bufLen, L"\n");
+    for (i = 0; i < kCountersCount; ++i) {
+        ::StringCchPrintfW(line, 100, L"%s: %u\n", _counterNames[i], getCount((CounterId)i));
+        ::StringCchCatW(buf, bufLen, line);
+    }
+    autoSaves = getCount(kCountAutoSave) + getCount(kCountAutoSaveSkipped);
+    if (autoSaves > 0) {
+        ::StringCchPrintfW(line, 100, L"Automatic saves suppressed: %.1f%%\n", getCount(kCountAutoSaveSkipped) * 100.0 / autoSaves);
+        ::StringCchCatW(buf, bufLen, line);
+    }
+}
+
+/** Allocates the trace event array if the debug log level enables tracing.
+    Must be called before any background thread starts. */
+void startTrace()
+{
+    if (gDbgLvl >= PRF_TRACE_LEVEL && !_events && _ticksPerSec > 0) {
+        _events = (TraceEvent*)sys_alloc(PRF_TRACE_MAX * sizeof(TraceEvent));
+        _traceStart = now();
+    }
+}
+
+/** Records an event named name from start to now. Can be called from any
+    thread. name must be a string literal. */
+void trace(LPCSTR name, PerfTime start)
+{
+    LONG i;
+    TraceEvent *e;
+
+    if (!_events) {
+        return;
+    }
+    i = ::InterlockedIncrement(&_eventCount) - 1;
+    if (i >= PRF_TRACE_MAX) {
+        return;
+    }
+    e = &_events[i];
+    e->threadId = ::GetCurrentThreadId();
+    e->start = start;
+    e->end = now();
+    ::InterlockedExchangePointer((PVOID*)&e->name, (PVOID)name);
+}
+
+/** Writes the recorded events to the trace file and stops recording. If
+    threadsStopped is false a background thread may still be running, so
+    events it has not finished are left out. */
+void writeTrace(bool threadsStopped)
+{
+    LONG i, recorded, count, written = 0;
+    FILE *fp;
+    WCHAR traceFile[MAX_PATH];
+    const TraceEvent *e;
+
+    if (!_events) {
+        return;
+    }
+    // Later calls to trace find the array full and record nothing.
+    recorded = ::InterlockedExchange(&_eventCount, PRF_TRACE_MAX);
+    if (recorded == 0) {
+        return;
+    }
+    count = min(recorded, PRF_TRACE_MAX);
+    ::StringCchCopyW(traceFile, MAX_PATH, sys_getCfgDir());
+    ::StringCchCatW(traceFile, MAX_PATH, PRF_TRACE_FILE);
+    ::_wfopen_s(&fp, traceFile, L"w");
+    if (!fp) {
+        LOG("Error %i opening \"%S\".", errno, traceFile);
+        return;
+    }
+    ::fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (i = 0; i < count; ++i) {
+        e = &_events[i];
+        if (!e->name) {
+            continue;
+        }
+        ::fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%I64d,\"dur\":%I64d}",
+            written++ > 0 ? "," : "", e->name, e->threadId, (e->start - _traceStart) * 1000000 / _ticksPerSec,
+            (e->end - e->start) * 1000000 / _ticksPerSec);
+    }
+    ::fprintf(fp, "\n]}\n");
+    ::fclose(fp);
+    LOG("Wrote %li trace events, %li dropped%s.", written, recorded - written,
+        threadsStopped ? "" : ", the worker thread was still running");
+}
+
+/** Writes every phase's statistics, in microseconds, and the counters to the
+    stats file, if the debug log level enables tracing. */
+void writeStats()
+{
+    INT i;
+    FILE *fp;
+    PhaseStats stats;
+    WCHAR statsFile[MAX_PATH];
+    CHAR name[64];
+
+    if (gDbgLvl < PRF_TRACE_LEVEL) {
+        return;
+    }
+    ::StringCchCopyW(statsFile, MAX_PATH, sys_getCfgDir());
+    ::StringCchCatW(statsFile, MAX_PATH, PRF_STATS_FILE);
+    ::_wfopen_s(&fp, statsFile, L"w");
+    if (!fp) {
+        LOG("Error %i opening \"%S\".", errno, statsFile);
+        return;
+    }
+    ::fprintf(fp, "{\"phases\":[\n");
+    for (i = 0; i < kPhasesCount; ++i) {
+        getStats((PhaseId)i, &stats);
+        // Names are indented to show nesting, which is not needed here.
+        ::StringCchPrintfA(name, 64, "%S", _phases[i].name + ::wcsspn(_phases[i].name, L" "));
+        ::fprintf(fp, "{\"id\":%i,\"name\":\"%s\",\"count\":%u,\"p50\":%u,\"p95\":%u,\"max\":%u}%s\n",
+            i, name, stats.count, stats.p50, stats.p95, stats.max, i + 1 < kPhasesCount ? "," : "");
+    }
+    ::fprintf(fp, "],\"counters\":{\n");
+    for (i = 0; i < kCountersCount; ++i) {
+        ::StringCchPrintfA(name, 64, "%S", _counterNames[i]);
+        ::fprintf(fp, "\"%s\":%u%s\n", name, getCount((CounterId)i), i + 1 < kCountersCount ? "," : "");
+    }
+    ::fprintf(fp, "}}\n");
+    ::fclose(fp);
+}
+
+} // end namespace NppPlugin::prf
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/** Values 0 to 3 have their own buckets. Above that, the range of each power
+    of two is divided into four buckets.
+    @return the histogram bucket for a time in microseconds */
+UINT bucketOf(UINT us)
+{
+    UINT msb = 0;
+
+    if (us < 4) {
+        return us;
+    }
+    while ((us >> msb) > 1) {
+        ++msb;
+    }
+    return (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+}
+
+/** @return the largest time in microseconds that falls into bucket */
+UINT bucketLimit(UINT bucket)
+{
+    UINT msb, next;
+
+    if (bucket < 4) {
+        return bucket;
+    }
+    msb = bucket / 4 + 1;
+    next = (4 + (bucket & 3) + 1);
+    return msb >= 31 && next == 8 ? UINT_MAX : (next << (msb - 2)) - 1;
+}
+
+/** @return the upper limit of the bucket holding the pct percentile, but not
+    more than the maximum */
+UINT percentile(const Phase *phase, UINT pct)
+{
+    UINT i, seen = 0, target;
+
+    if (phase->count == 0) {
+        return 0;
+    }
+    target = (UINT)(((ULONGLONG)phase->count * pct + 99) / 100);
+    for (i = 0; i < PRF_BUCKETS; ++i) {
+        seen += phase->buckets[i];
+        if (seen >= target) {
+            return min(bucketLimit(i), phase->max);
+        }
+    }
+    return phase->max;
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
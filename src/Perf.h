@@ -0,0 +1,98 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Perf.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#ifndef NPP_PLUGIN_PERF_H
+#define NPP_PLUGIN_PERF_H
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+typedef LONGLONG PerfTime; ///< a high-resolution counter value
+
+/// Trace events are recorded if the debug log level is at least this
+#define PRF_TRACE_LEVEL 5
+
+/// Event counters shown with the phase statistics
+enum CounterId {
+    kCountAutoSave = 0,    ///< automatic saves performed
+    kCountAutoSaveSkipped, ///< automatic saves skipped because the session was unchanged
+    kCountHeapAllocs,      ///< calls to sys_alloc
+    kCountScratchAllocs,   ///< Scratch allocations that did not use the heap
+    kCountLogDropped,      ///< debug log messages dropped because the queue was full
+    kCountersCount
+};
+
+/// Summary of the times recorded for a phase, in microseconds
+typedef struct PhaseStats_tag {
+    UINT count;
+    UINT p50;
+    UINT p95;
+    UINT max;
+} PhaseStats;
+
+//------------------------------------------------------------------------------
+/// @namespace NppPlugin::api Contains functions called only from DllMain.
+
+namespace api {
+
+void prf_onLoad();
+void prf_onUnload();
+
+} // end namespace NppPlugin::api
+
+//------------------------------------------------------------------------------
+/** @namespace NppPlugin::prf Times the phases of session loading and saving,
+    and counts some events. These functions must only be called from NPP's
+    main thread, except increment and getCount. */
+
+namespace prf {
+
+PerfTime now();
+void record(PhaseId phase, PerfTime start);
+void getStats(PhaseId phase, PhaseStats *stats);
+void increment(CounterId counter);
+UINT getCount(CounterId counter);
+void formatStats(LPWSTR buf, size_t bufLen);
+void startTrace();
+void trace(LPCSTR name, PerfTime start);
+void writeTrace(bool threadsStopped = true);
+void writeStats();
+
+} // end namespace NppPlugin::prf
+
+/// Runs statement, recording a trace event named name around it
+#define PRF_TRACE(name, statement) { TraceScope trc_(name); statement; }
+
+//------------------------------------------------------------------------------
+
+/// @class TraceScope
+/** Records a trace event named name covering the lifetime of the object.
+    name must be a string literal. */
+class TraceScope
+{
+  public:
+    TraceScope(LPCSTR name) : _name(name), _start(gDbgLvl >= PRF_TRACE_LEVEL ? prf::now() : 0) {}
+    ~TraceScope() { if (_start) prf::trace(_name, _start); }
+  private:
+    LPCSTR _name;
+    PerfTime _start;
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+};
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_PERF_H
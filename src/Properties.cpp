@@ -19,11 +19,35 @@
     properties". The file "global.xml", in the Session Manager configuration
     directory, stores bookmarks, firstVisibleLine and language for each unique
     pathname in all sessions.
+
+    Before a session is loaded its file is merged with the global properties.
+    The sessions most likely to be loaded next are merged ahead of time by a
+    background task. A session that has been merged is remembered, along with
+    hashes of its pathnames, until its file changes or a save of the global
+    properties touches one of its pathnames, so loading it again can skip the
+    merge.
+
+    The global and session documents are reused by every operation, so once
+    they have grown to the size of the files, loading them again does not
+    allocate. The background merge of pending sessions has its own pair of
+    documents, so it holds the file lock only while it reads and writes files,
+    not while it merges. The global cleanup task uses the shared global
+    document, so it holds the lock while that document is loaded, changed and
+    saved, but not while it checks whether files exist. The merges themselves
+    are in core\GlobalProps.cpp.
 */
 
 #include "System.h"
 #include "Properties.h"
 #include "Util.h"
+#include "Tasks.h"
+#include "Perf.h"
+#include "core\GlobalProps.h"
+#include <algorithm>
+#include <strsafe.h>
+#include <vector>
+
+using std::vector;
 
 //------------------------------------------------------------------------------
 
@@ -34,23 +58,61 @@ namespace NppPlugin {
 namespace {
 
 /// XML nodes
-#define XN_NOTEPADPLUS    "NotepadPlus" ///< root node
-#define XN_SESSION        "Session"
-#define XN_MAINVIEW       "mainView"
-#define XN_SUBVIEW        "subView"
-#define XN_FILE           "File"
-#define XN_MARK           "Mark"
-#define XN_FOLD           "Fold"
-#define XN_FILEPROPERTIES "FileProperties"
+LPCSTR const XN_NOTEPADPLUS    = xmlIntern("NotepadPlus"); ///< root node
+LPCSTR const XN_FILE           = xmlIntern("File");
+LPCSTR const XN_MARK           = xmlIntern("Mark");
+LPCSTR const XN_FOLD           = xmlIntern("Fold");
+LPCSTR const XN_FILEPROPERTIES = xmlIntern("FileProperties");
 
 /// XML attributes
-#define XA_FILENAME         "filename"
-#define XA_LANG             "lang"
-#define XA_FIRSTVISIBLELINE "firstVisibleLine"
-#define XA_LINE             "line"
-
-void removeMissingFilesFromGlobal();
-void deleteChildren(tXmlEleP parent, LPCSTR eleName);
+LPCSTR const XA_FILENAME         = xmlIntern("filename");
+LPCSTR const XA_FIRSTVISIBLELINE = xmlIntern("firstVisibleLine");
+LPCSTR const XA_LINE             = xmlIntern("line");
+
+/// Maximum number of merged sessions remembered
+#define MERGED_MAX_SESSIONS 16
+
+/// Identifies a version of a file on disk
+typedef struct FileStamp_tag {
+    FILETIME modified;
+    DWORD    sizeLow;
+} FileStamp;
+
+/// A session file that has been merged with the global properties
+typedef struct MergedSession_tag {
+    WCHAR        sesFile[MAX_PATH];
+    FileStamp    stamp;      ///< session file stamp after the merge
+    vector<UINT> fileHashes; ///< sorted hashes of the session's pathnames
+} MergedSession;
+
+/// A session file queued for merging in the background
+typedef struct PendingSession_tag {
+    WCHAR sesFile[MAX_PATH];
+} PendingSession;
+
+// These are guarded by sys_lockFiles.
+vector<MergedSession> _merged;      ///< most recently merged last
+FileStamp _mergedGlobalStamp;       ///< global file stamp the merged sessions are valid for
+vector<PendingSession> _pending;    ///< sessions to merge in the background
+tXmlDoc _globalDoc;                 ///< reused so its memory pools stay allocated
+tXmlDoc _localDoc;
+
+// These are used only by the background task.
+tXmlDoc _bgGlobalDoc;
+tXmlDoc _bgLocalDoc;
+
+void globalFromSession(LPWSTR sesFile);
+void sessionFromGlobal(LPWSTR sesFile);
+void sessionFromGlobalInBackground(LPCWSTR sesFile);
+void documentFromGlobal(INT bufferId);
+void removeMissingFilesFromGlobal(LPVOID arg);
+void mergePendingSessions(LPVOID arg);
+bool getFileStamp(LPCWSTR file, FileStamp *stamp);
+bool isSameStamp(const FileStamp *s1, const FileStamp *s2);
+bool lessUtf8(LPCSTR s1, LPCSTR s2);
+bool isMergedCurrent(LPCWSTR sesFile);
+void addMerged(LPCWSTR sesFile, vector<UINT> &fileHashes);
+void updateMergedAfterGlobalSave(bool wasCurrent, vector<UINT> *fileHashes);
 
 } // end namespace
 
@@ -60,8 +122,8 @@ namespace api {
 
 void prp_init()
 {
-    if (cfg::getBool(kCleanGlobalProperties)) {
-        removeMissingFilesFromGlobal();
+    if (cfg::get<kCleanGlobalProperties>()) {
+        tsk::add("cleanGlobal", removeMissingFilesFromGlobal, NULL, kTaskLow);
     }
 }
 
@@ -75,252 +137,244 @@ namespace prp {
     After a session is saved, the global bookmarks, firstVisibleLine and
     language are updated from the session properties. */
 void updateGlobalFromSession(LPWSTR sesFile)
+{
+    TraceScope trc("prp::updateGlobalFromSession");
+    sys_lockFiles();
+    globalFromSession(sesFile);
+    sys_unlockFiles();
+}
+
+/** Updates local (session) file properties from global file properties.
+    When a session is about to be loaded, the session bookmarks and language
+    are updated from the global properties, then the session is loaded. */
+void updateSessionFromGlobal(LPWSTR sesFile)
+{
+    TraceScope trc("prp::updateSessionFromGlobal");
+    sys_lockFiles();
+    sessionFromGlobal(sesFile);
+    sys_unlockFiles();
+}
+
+/** Updates document properties from global file properties.
+    When an existing document is added to a session, its bookmarks and
+    firstVisibleLine are updated from the global properties. */
+void updateDocumentFromGlobal(INT bufferId)
+{
+    TraceScope trc("prp::updateDocumentFromGlobal");
+    sys_lockFiles();
+    documentFromGlobal(bufferId);
+    sys_unlockFiles();
+}
+
+/** Queues a background task that merges the given session files with the
+    global properties, so that a later call to updateSessionFromGlobal for one
+    of them can return immediately. Replaces any sessions still pending from a
+    previous call. */
+void prepareSessions(LPCWSTR *sesFiles, INT count)
+{
+    INT i;
+    PendingSession pending;
+    TraceScope trc("prp::prepareSessions");
+
+    sys_lockFiles();
+    _pending.clear();
+    for (i = 0; i < count; ++i) {
+        ::StringCchCopyW(pending.sesFile, MAX_PATH, sesFiles[i]);
+        _pending.push_back(pending);
+    }
+    sys_unlockFiles();
+    if (count > 0) {
+        tsk::add("prepareSessions", mergePendingSessions, NULL, kTaskLow);
+    }
+}
+
+} // end namespace NppPlugin::prp
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/** Implements prp::updateGlobalFromSession. */
+void globalFromSession(LPWSTR sesFile)
 {
     DWORD lastErr;
     tXmlError xmlErr;
-    LPCSTR target;
+    FileStamp globalStamp;
+    vector<UINT> fileHashes;
+    bool mergedWasCurrent;
 
     LOGF("%S", sesFile);
 
+    mergedWasCurrent = getFileStamp(sys_getGlobalFile(), &globalStamp) && isSameStamp(&globalStamp, &_mergedGlobalStamp);
+
     // Load the properties file (global file properties)
-    tXmlDoc globalDoc;
-    xmlErr = globalDoc.LoadFile(sys_getGlobalFile());
+    tXmlDoc &globalDoc = _globalDoc;
+    PRF_TRACE("xml parse global.xml", xmlErr = globalDoc.LoadFile(sys_getGlobalFile()));
     if (xmlErr != kXmlSuccess) {
         lastErr = ::GetLastError();
         msg::error(lastErr, L"%s: Error %u loading the global properties file.", _W(__FUNCTION__), xmlErr);
         return;
     }
-    tXmlEleP globalPropsEle, globalFileEle, globalMarkEle, globalFoldEle;
-    tXmlHnd globalDocHnd(&globalDoc);
-    globalPropsEle = globalDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_FILEPROPERTIES).ToElement();
-
     // Load the session file (file properties local to a session)
-    tXmlDoc localDoc;
-    xmlErr = localDoc.LoadFile(sesFile);
+    tXmlDoc &localDoc = _localDoc;
+    PRF_TRACE("xml parse session", xmlErr = localDoc.LoadFile(sesFile));
     if (xmlErr != kXmlSuccess) {
         lastErr = ::GetLastError();
         msg::error(lastErr, L"%s: Error %u loading session file \"%s\".", _W(__FUNCTION__), xmlErr, sesFile);
         return;
     }
-    tXmlEleP localViewEle, localFileEle, localMarkEle, localFoldEle;
-    tXmlHnd localDocHnd(&localDoc);
-
-    // Iterate over the local View elements
-    localViewEle = localDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SESSION).FirstChildElement(XN_MAINVIEW).ToElement();
-    while (localViewEle) {
-        // Iterate over the local File elements
-        localFileEle = localViewEle->FirstChildElement(XN_FILE);
-        while (localFileEle) {
-            // Find the global File element corresponding to the current local File element
-            target = localFileEle->Attribute(XA_FILENAME);
-            LOGG(21, "File = %s", target);
-            globalFileEle = globalPropsEle->FirstChildElement(XN_FILE);
-            while (globalFileEle) {
-                if (globalFileEle->Attribute(XA_FILENAME, target)) {
-                    break; // found it
-                }
-                globalFileEle = globalFileEle->NextSiblingElement(XN_FILE);
-            }
-            if (!globalFileEle) { // not found so create one
-                globalFileEle = globalDoc.NewElement(XN_FILE);
-                globalFileEle->SetAttribute(XA_FILENAME, target);
-            }
-            globalPropsEle->InsertFirstChild(globalFileEle); // an existing element will get moved to the top
-            // Update global File attributes with values from the current local File attributes
-            globalFileEle->SetAttribute(XA_LANG, localFileEle->Attribute(XA_LANG));
-            globalFileEle->SetAttribute(XA_FIRSTVISIBLELINE, localFileEle->Attribute(XA_FIRSTVISIBLELINE));
-            LOGG(21, "lang = '%s', firstVisibleLine = %s", localFileEle->Attribute(XA_LANG), localFileEle->Attribute(XA_FIRSTVISIBLELINE));
-            // Iterate over the local Mark elements for the current local File element
-            deleteChildren(globalFileEle, XN_MARK);
-            localMarkEle = localFileEle->FirstChildElement(XN_MARK);
-            while (localMarkEle) {
-                globalMarkEle = globalDoc.NewElement(XN_MARK);
-                globalFileEle->InsertEndChild(globalMarkEle);
-                // Update global Mark attributes with values from the current local Mark attributes
-                globalMarkEle->SetAttribute(XA_LINE, localMarkEle->Attribute(XA_LINE));
-                LOGG(21, "Mark = %s", localMarkEle->Attribute(XA_LINE));
-                localMarkEle = localMarkEle->NextSiblingElement(XN_MARK);
-            }
-            // Iterate over the local Fold elements for the current local File element
-            deleteChildren(globalFileEle, XN_FOLD);
-            localFoldEle = localFileEle->FirstChildElement(XN_FOLD);
-            while (localFoldEle) {
-                globalFoldEle = globalDoc.NewElement(XN_FOLD);
-                globalFileEle->InsertEndChild(globalFoldEle);
-                // Update global Fold attributes with values from the current local Fold attributes
-                globalFoldEle->SetAttribute(XA_LINE, localFoldEle->Attribute(XA_LINE));
-                LOGG(21, "Fold = %s", localFoldEle->Attribute(XA_LINE));
-                localFoldEle = localFoldEle->NextSiblingElement(XN_FOLD);
-            }
-            // Next local File element
-            localFileEle = localFileEle->NextSiblingElement(XN_FILE);
-        }
-        localViewEle = localViewEle->NextSiblingElement(XN_SUBVIEW);
-    }
-
-    // Add XML declaration if missing
-    if (memcmp(globalDoc.FirstChild()->Value(), "xml", 3) != 0) {
-        globalDoc.InsertFirstChild(globalDoc.NewDeclaration());
+    if (!prp::mergeIntoGlobal(globalDoc, localDoc, fileHashes)) {
+        msg::error(0, L"%s: The global properties file has no FileProperties element.", _W(__FUNCTION__));
+        return;
     }
     // Save changes to the properties file
-    xmlErr = globalDoc.SaveFile(sys_getGlobalFile());
+    PRF_TRACE("xml write global.xml", xmlErr = globalDoc.SaveFile(sys_getGlobalFile()));
     if (xmlErr != kXmlSuccess) {
         lastErr = ::GetLastError();
+        updateMergedAfterGlobalSave(false, NULL);
         msg::error(lastErr, L"%s: Error %u saving the global properties file.", _W(__FUNCTION__), xmlErr);
+        return;
     }
+    updateMergedAfterGlobalSave(mergedWasCurrent, &fileHashes);
 }
 
-/** Updates local (session) file properties from global file properties.
-    When a session is about to be loaded, the session bookmarks and language
-    are updated from the global properties, then the session is loaded. */
-void updateSessionFromGlobal(LPWSTR sesFile)
+/** Implements prp::updateSessionFromGlobal. */
+void sessionFromGlobal(LPWSTR sesFile)
 {
-    LPSTR buf;
     DWORD lastErr;
     tXmlError xmlErr;
-    bool save = false;
-    LPCSTR target;
+    bool changed;
+    vector<UINT> fileHashes;
 
     LOGF("%S", sesFile);
 
+    if (isMergedCurrent(sesFile)) {
+        LOGG(10, "Session file already merged");
+        return;
+    }
     // Load the properties file (global file properties)
-    tXmlDoc globalDoc;
-    xmlErr = globalDoc.LoadFile(sys_getGlobalFile());
+    tXmlDoc &globalDoc = _globalDoc;
+    PRF_TRACE("xml parse global.xml", xmlErr = globalDoc.LoadFile(sys_getGlobalFile()));
     if (xmlErr != kXmlSuccess) {
         lastErr = ::GetLastError();
         msg::error(lastErr, L"%s: Error %u loading the global properties file.", _W(__FUNCTION__), xmlErr);
         return;
     }
-    tXmlEleP globalPropsEle, globalFileEle, globalMarkEle, globalFoldEle;
-    tXmlHnd globalDocHnd(&globalDoc);
-    globalPropsEle = globalDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_FILEPROPERTIES).ToElement();
-
     // Load the session file (file properties local to a session)
-    tXmlDoc localDoc;
-    xmlErr = localDoc.LoadFile(sesFile);
+    tXmlDoc &localDoc = _localDoc;
+    PRF_TRACE("xml parse session", xmlErr = localDoc.LoadFile(sesFile));
     if (xmlErr != kXmlSuccess) {
         lastErr = ::GetLastError();
         msg::error(lastErr, L"%s: Error %u loading session file \"%s\".", _W(__FUNCTION__), xmlErr, sesFile);
         return;
     }
-    tXmlEleP localViewEle, localFileEle, localMarkEle, localFoldEle;
-    tXmlHnd localDocHnd(&localDoc);
-
-    // Iterate over the local View elements
-    localViewEle = localDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SESSION).FirstChildElement(XN_MAINVIEW).ToElement();
-    while (localViewEle) {
-        // Iterate over the local File elements
-        localFileEle = localViewEle->FirstChildElement(XN_FILE);
-        while (localFileEle) {
-            // Find the global File element corresponding to the current local File element
-            target = localFileEle->Attribute(XA_FILENAME);
-            LOGG(22, "File = %s", target);
-            globalFileEle = globalPropsEle->FirstChildElement(XN_FILE);
-            while (globalFileEle) {
-                if (globalFileEle->Attribute(XA_FILENAME, target)) {
-                    break; // found it
-                }
-                globalFileEle = globalFileEle->NextSiblingElement(XN_FILE);
-            }
-            if (globalFileEle) {
-                save = true;
-                // Update current local File attributes with values from the global File attributes
-                buf = (LPSTR)sys_alloc(str::utf8ToAscii(target) * sizeof CHAR);
-                if (buf == NULL) {
-                    return;
-                }
-                str::utf8ToAscii(target, buf); // NPP expects the pathname to be encoded like this
-                localFileEle->SetAttribute(XA_FILENAME, buf);
-                sys_free(buf);
-                localFileEle->SetAttribute(XA_LANG, globalFileEle->Attribute(XA_LANG));
-                LOGG(22, "lang = '%s'", globalFileEle->Attribute(XA_LANG));
-                // Iterate over the global Mark elements for the current global File element
-                deleteChildren(localFileEle, XN_MARK);
-                globalMarkEle = globalFileEle->FirstChildElement(XN_MARK);
-                while (globalMarkEle) {
-                    localMarkEle = localDoc.NewElement(XN_MARK);
-                    localFileEle->InsertEndChild(localMarkEle);
-                    // Update local Mark attributes with values from the current global Mark attributes
-                    localMarkEle->SetAttribute(XA_LINE, globalMarkEle->Attribute(XA_LINE));
-                    LOGG(22, "Mark = %s", globalMarkEle->Attribute(XA_LINE));
-                    globalMarkEle = globalMarkEle->NextSiblingElement(XN_MARK);
-                }
-                // Iterate over the global Fold elements for the current global File element
-                deleteChildren(localFileEle, XN_FOLD);
-                globalFoldEle = globalFileEle->FirstChildElement(XN_FOLD);
-                while (globalFoldEle) {
-                    localFoldEle = localDoc.NewElement(XN_FOLD);
-                    localFileEle->InsertEndChild(localFoldEle);
-                    // Update local Fold attributes with values from the current global Fold attributes
-                    localFoldEle->SetAttribute(XA_LINE, globalFoldEle->Attribute(XA_LINE));
-                    LOGG(22, "Fold = %s", globalFoldEle->Attribute(XA_LINE));
-                    globalFoldEle = globalFoldEle->NextSiblingElement(XN_FOLD);
-                }
-            }
-            //else {
-            //    TODO: not found
-            //    This indicates global needs to be updated from this session,
-            //    but we can't call updateGlobalFromSession here.
-            //}
-            localFileEle = localFileEle->NextSiblingElement(XN_FILE);
-        }
-        localViewEle = localViewEle->NextSiblingElement(XN_SUBVIEW);
+    if (!prp::mergeIntoSession(globalDoc, localDoc, fileHashes, &changed)) {
+        return;
     }
-
-    if (save) {
-        // Add XML declaration if missing
-        if (memcmp(localDoc.FirstChild()->Value(), "xml", 3) != 0) {
-            localDoc.InsertFirstChild(localDoc.NewDeclaration());
-        }
+    if (changed) {
         // Save changes to the session file
-        xmlErr = localDoc.SaveFile(sesFile);
+        PRF_TRACE("xml write session", xmlErr = localDoc.SaveFile(sesFile));
         if (xmlErr != kXmlSuccess) {
             lastErr = ::GetLastError();
             msg::error(lastErr, L"%s: Error %u saving session file \"%s\".", _W(__FUNCTION__), xmlErr, sesFile);
+            return;
         }
     }
+    addMerged(sesFile, fileHashes);
 }
 
-/** Updates document properties from global file properties.
-    When an existing document is added to a session, its bookmarks and
-    firstVisibleLine are updated from the global properties. */
-void updateDocumentFromGlobal(INT bufferId)
+/** Merges a session file with the global properties from a background task.
+    Private documents are used, so the file lock is only held while files are
+    read and written. If the session or global file changed while merging,
+    the result is dropped, since it would overwrite that change. Errors are
+    only logged, since they will be reported when the session is actually
+    loaded. The session file's modified time is preserved so the session list
+    order does not change. */
+void sessionFromGlobalInBackground(LPCWSTR sesFile)
+{
+    tXmlError xmlErr;
+    bool changed;
+    FileStamp sesStamp, globalStamp, stamp;
+    vector<UINT> fileHashes;
+
+    LOGF("%S", sesFile);
+
+    sys_lockFiles();
+    if (isMergedCurrent(sesFile)) {
+        sys_unlockFiles();
+        LOGG(10, "Session file already merged");
+        return;
+    }
+    if (!getFileStamp(sesFile, &sesStamp) || !getFileStamp(sys_getGlobalFile(), &globalStamp)) {
+        sys_unlockFiles();
+        return;
+    }
+    PRF_TRACE("xml parse global.xml", xmlErr = _bgGlobalDoc.LoadFile(sys_getGlobalFile()));
+    if (xmlErr == kXmlSuccess) {
+        PRF_TRACE("xml parse session", xmlErr = _bgLocalDoc.LoadFile(sesFile));
+    }
+    sys_unlockFiles();
+    if (xmlErr != kXmlSuccess) {
+        LOG("Error %u loading \"%S\" or the global properties file.", xmlErr, sesFile);
+        return;
+    }
+
+    if (!prp::mergeIntoSession(_bgGlobalDoc, _bgLocalDoc, fileHashes, &changed) || tsk::isCancelled()) {
+        return;
+    }
+
+    sys_lockFiles();
+    if (!getFileStamp(sesFile, &stamp) || !isSameStamp(&stamp, &sesStamp) ||
+        !getFileStamp(sys_getGlobalFile(), &stamp) || !isSameStamp(&stamp, &globalStamp)
+    ) {
+        sys_unlockFiles();
+        LOGG(10, "Changed while merging, not saved");
+        return;
+    }
+    if (changed) {
+        PRF_TRACE("xml write session", xmlErr = _bgLocalDoc.SaveFile(sesFile));
+        if (xmlErr != kXmlSuccess) {
+            sys_unlockFiles();
+            LOG("Error %u saving session file \"%S\".", xmlErr, sesFile);
+            return;
+        }
+        pth::setModifiedTime(sesFile, &sesStamp.modified);
+    }
+    addMerged(sesFile, fileHashes);
+    sys_unlockFiles();
+}
+
+/** Implements prp::updateDocumentFromGlobal. */
+void documentFromGlobal(INT bufferId)
 {
     LPSTR mbPathname;
     WCHAR pathname[MAX_PATH];
     INT line, pos, view;
     HWND hNpp = sys_getNppHandle();
+    Scratch scratch;
 
     LOGF("%i", bufferId);
 
     // Get pathname for bufferId
     ::SendMessage(hNpp, NPPM_GETFULLPATHFROMBUFFERID, bufferId, (LPARAM)pathname);
-    mbPathname = str::utf16ToUtf8(pathname);
+    mbPathname = scratch.toUtf8(pathname);
     if (mbPathname == NULL) {
         return;
     }
     LOGG(20, "File = %s", mbPathname);
     // Load the properties file (global file properties)
-    tXmlDoc globalDoc;
-    tXmlError xmlErr = globalDoc.LoadFile(sys_getGlobalFile());
+    tXmlDoc &globalDoc = _globalDoc;
+    tXmlError xmlErr;
+    PRF_TRACE("xml parse global.xml", xmlErr = globalDoc.LoadFile(sys_getGlobalFile()));
     if (xmlErr != kXmlSuccess) {
         DWORD lastErr = ::GetLastError();
         msg::error(lastErr, L"%s: Error %u loading the global properties file.", _W(__FUNCTION__), xmlErr);
-        sys_free(mbPathname);
         return;
     }
     tXmlEleP globalFileEle, globalMarkEle, globalFoldEle;
-    tXmlHnd globalDocHnd(&globalDoc);
-    globalFileEle = globalDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_FILEPROPERTIES).FirstChildElement(XN_FILE).ToElement();
 
     // Find the global File element corresponding to mbPathname
-    while (globalFileEle) {
-        if (globalFileEle->Attribute(XA_FILENAME, mbPathname)) {
-            break; // found it
-        }
-        globalFileEle = globalFileEle->NextSiblingElement(XN_FILE);
-    }
-    sys_free(mbPathname);
+    globalFileEle = prp::findGlobalFile(globalDoc, mbPathname);
     if (!globalFileEle) { // not found
         return;
     }
@@ -360,77 +414,218 @@ void updateDocumentFromGlobal(INT bufferId)
     LOGG(20, "firstVisibleLine = %i", line);
 }
 
-} // end namespace NppPlugin::prp
-
-//------------------------------------------------------------------------------
-
-namespace {
-
-/** Removes global File elements whose files do not exist on disk. */
-void removeMissingFilesFromGlobal()
+/** Removes global File elements whose files do not exist on disk. Runs as a
+    background task. The file lock is held only while the global file is read
+    and written. The files are checked without it, on a copy of the
+    pathnames, since that can wait on network or removed drives. Errors are
+    logged, since a task must not show a message box. */
+void removeMissingFilesFromGlobal(LPVOID arg)
 {
-    DWORD lastErr;
     tXmlError xmlErr;
     bool save = false;
+    bool mergedWasCurrent;
+    size_t ofs;
+    FileStamp globalStamp;
     LPWSTR wPathname;
     LPCSTR mbPathname;
+    vector<CHAR> pathnames; ///< the global pathnames, each null-terminated
+    vector<LPCSTR> missing; ///< the missing ones, pointing into pathnames
     tXmlEleP propsEle, fileEle, currentFileEle;
 
     LOGF("");
 
-    // Load the properties file (global file properties)
-    tXmlDoc globalDoc;
-    xmlErr = globalDoc.LoadFile(sys_getGlobalFile());
+    // Copy the pathnames from the global file.
+    sys_lockFiles();
+    tXmlDoc &globalDoc = _globalDoc;
+    PRF_TRACE("xml parse global.xml", xmlErr = globalDoc.LoadFile(sys_getGlobalFile()));
     if (xmlErr != kXmlSuccess) {
-        lastErr = ::GetLastError();
-        msg::error(lastErr, L"%s: Error %u loading the global properties file.", _W(__FUNCTION__), xmlErr);
+        sys_unlockFiles();
+        LOG("Error %u loading the global properties file.", xmlErr);
         return;
     }
     tXmlHnd globalDocHnd(&globalDoc);
     propsEle = globalDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_FILEPROPERTIES).ToElement();
-    fileEle = propsEle->FirstChildElement(XN_FILE);
-
-    // Iterate over the File elements and remove those whose files do not exist
-    while (fileEle) {
+    fileEle = propsEle ? propsEle->FirstChildElement(XN_FILE) : NULL;
+    for (; fileEle; fileEle = fileEle->NextSiblingElement(XN_FILE)) {
         mbPathname = fileEle->Attribute(XA_FILENAME);
-        wPathname = str::utf8ToUtf16(mbPathname);
-        if (wPathname == NULL) {
-            continue; // XXX was: return;
+        if (mbPathname) {
+            pathnames.insert(pathnames.end(), mbPathname, mbPathname + ::strlen(mbPathname) + 1);
         }
+    }
+    sys_unlockFiles();
+
+    // Find the pathnames whose files do not exist.
+    for (ofs = 0; ofs < pathnames.size() && !tsk::isCancelled(); ofs += ::strlen(&pathnames[ofs]) + 1) {
+        Scratch scratch;
+        wPathname = scratch.toUtf16(&pathnames[ofs]);
+        if (wPathname && !pth::fileExists(wPathname)) {
+            missing.push_back(&pathnames[ofs]);
+            LOGG(20, "File = %s", &pathnames[ofs]);
+        }
+    }
+    if (missing.empty() || tsk::isCancelled()) {
+        return;
+    }
+    std::sort(missing.begin(), missing.end(), lessUtf8);
+
+    // Reload the global file, since it may have been saved meanwhile, and
+    // remove the missing files.
+    sys_lockFiles();
+    mergedWasCurrent = getFileStamp(sys_getGlobalFile(), &globalStamp) && isSameStamp(&globalStamp, &_mergedGlobalStamp);
+    PRF_TRACE("xml parse global.xml", xmlErr = globalDoc.LoadFile(sys_getGlobalFile()));
+    if (xmlErr != kXmlSuccess) {
+        sys_unlockFiles();
+        LOG("Error %u loading the global properties file.", xmlErr);
+        return;
+    }
+    propsEle = globalDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_FILEPROPERTIES).ToElement();
+    fileEle = propsEle ? propsEle->FirstChildElement(XN_FILE) : NULL;
+    while (fileEle) {
         currentFileEle = fileEle;
         fileEle = fileEle->NextSiblingElement(XN_FILE);
-        if (!pth::fileExists(wPathname)) {
+        mbPathname = currentFileEle->Attribute(XA_FILENAME);
+        if (mbPathname && std::binary_search(missing.begin(), missing.end(), mbPathname, lessUtf8)) {
             save = true;
             propsEle->DeleteChild(currentFileEle);
-            LOGG(20, "File = %s", mbPathname);
         }
-        sys_free(wPathname);
     }
-
     if (save) {
         // Add XML declaration if missing
         if (memcmp(globalDoc.FirstChild()->Value(), "xml", 3) != 0) {
             globalDoc.InsertFirstChild(globalDoc.NewDeclaration());
         }
         // Save changes to the properties file
-        xmlErr = globalDoc.SaveFile(sys_getGlobalFile());
+        PRF_TRACE("xml write global.xml", xmlErr = globalDoc.SaveFile(sys_getGlobalFile()));
         if (xmlErr != kXmlSuccess) {
-            lastErr = ::GetLastError();
-            msg::error(lastErr, L"%s: Error %u saving the global properties file.", _W(__FUNCTION__), xmlErr);
+            LOG("Error %u saving the global properties file.", xmlErr);
+        }
+        // Removing File elements does not change the result of a merge.
+        updateMergedAfterGlobalSave(xmlErr == kXmlSuccess && mergedWasCurrent, NULL);
+    }
+    sys_unlockFiles();
+}
+
+/** Merges the pending session files with the global properties. Runs as a
+    background task. */
+void mergePendingSessions(LPVOID arg)
+{
+    PendingSession pending;
+
+    while (!tsk::isCancelled()) {
+        sys_lockFiles();
+        if (_pending.empty()) {
+            sys_unlockFiles();
+            break;
         }
+        pending = _pending.front();
+        _pending.erase(_pending.begin());
+        sys_unlockFiles();
+        sessionFromGlobalInBackground(pending.sesFile);
     }
 }
 
-/** Deletes parent's child elements having the given element name. */
-void deleteChildren(tXmlEleP parent, LPCSTR eleName)
+/** @return true if file's stamp was copied into stamp, false if file could
+    not be accessed */
+bool getFileStamp(LPCWSTR file, FileStamp *stamp)
 {
-    tXmlEleP ele, tmp;
+    WIN32_FILE_ATTRIBUTE_DATA fad;
 
-    ele = parent->FirstChildElement(eleName);
-    while (ele) {
-        tmp = ele;
-        ele = ele->NextSiblingElement(eleName);
-        parent->DeleteChild(tmp);
+    if (!::GetFileAttributesExW(file, GetFileExInfoStandard, &fad)) {
+        return false;
+    }
+    stamp->modified = fad.ftLastWriteTime;
+    stamp->sizeLow = fad.nFileSizeLow;
+    return true;
+}
+
+bool isSameStamp(const FileStamp *s1, const FileStamp *s2)
+{
+    return ::CompareFileTime(&s1->modified, &s2->modified) == 0 && s1->sizeLow == s2->sizeLow;
+}
+
+bool lessUtf8(LPCSTR s1, LPCSTR s2)
+{
+    return ::strcmp(s1, s2) < 0;
+}
+
+/** @return true if sesFile was merged and neither it nor the global file has
+    changed since then */
+bool isMergedCurrent(LPCWSTR sesFile)
+{
+    FileStamp stamp;
+
+    if (_merged.empty() || !getFileStamp(sys_getGlobalFile(), &stamp) || !isSameStamp(&stamp, &_mergedGlobalStamp)) {
+        return false;
+    }
+    for (vector<MergedSession>::const_iterator it = _merged.begin(); it != _merged.end(); ++it) {
+        if (::lstrcmpiW(it->sesFile, sesFile) == 0) {
+            return getFileStamp(sesFile, &stamp) && isSameStamp(&stamp, &it->stamp);
+        }
+    }
+    return false;
+}
+
+/** Remembers that sesFile has just been merged. fileHashes is swapped into the
+    new entry. */
+void addMerged(LPCWSTR sesFile, vector<UINT> &fileHashes)
+{
+    FileStamp stamp;
+    MergedSession merged;
+
+    if (!getFileStamp(sys_getGlobalFile(), &stamp)) {
+        return;
+    }
+    if (!isSameStamp(&stamp, &_mergedGlobalStamp)) {
+        _merged.clear();
+        _mergedGlobalStamp = stamp;
+    }
+    if (!getFileStamp(sesFile, &merged.stamp)) {
+        return;
+    }
+    for (vector<MergedSession>::iterator it = _merged.begin(); it != _merged.end(); ++it) {
+        if (::lstrcmpiW(it->sesFile, sesFile) == 0) {
+            _merged.erase(it);
+            break;
+        }
+    }
+    if (_merged.size() >= MERGED_MAX_SESSIONS) {
+        _merged.erase(_merged.begin());
+    }
+    ::StringCchCopyW(merged.sesFile, MAX_PATH, sesFile);
+    _merged.push_back(merged);
+    _merged.back().fileHashes.swap(fileHashes);
+    std::sort(_merged.back().fileHashes.begin(), _merged.back().fileHashes.end());
+}
+
+/** Called after the global file was saved. If wasCurrent is false the merged
+    sessions were not valid for the global file as it was before the save, so
+    all are forgotten. Otherwise only those having a pathname in fileHashes are
+    forgotten, and the rest are made valid for the new global file. */
+void updateMergedAfterGlobalSave(bool wasCurrent, vector<UINT> *fileHashes)
+{
+    vector<UINT>::const_iterator h;
+    vector<MergedSession>::iterator it;
+
+    if (!wasCurrent || !getFileStamp(sys_getGlobalFile(), &_mergedGlobalStamp)) {
+        _merged.clear();
+        return;
+    }
+    if (fileHashes) {
+        it = _merged.begin();
+        while (it != _merged.end()) {
+            for (h = fileHashes->begin(); h != fileHashes->end(); ++h) {
+                if (std::binary_search(it->fileHashes.begin(), it->fileHashes.end(), *h)) {
+                    break;
+                }
+            }
+            if (h != fileHashes->end()) {
+                LOGG(10, "Forgetting merged session \"%S\"", it->sesFile);
+                it = _merged.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
     }
 }
 
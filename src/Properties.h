@@ -37,6 +37,7 @@ namespace prp {
 void updateGlobalFromSession(LPWSTR sesFile);
 void updateSessionFromGlobal(LPWSTR sesFile);
 void updateDocumentFromGlobal(INT bufferId);
+void prepareSessions(LPCWSTR *sesFiles, INT count);
 
 } // end namespace NppPlugin::prp
 
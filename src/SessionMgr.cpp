@@ -19,9 +19,12 @@
 #include "Util.h"
 #include "Properties.h"
 #include "ContextMenu.h"
-#include <algorithm>
+#include "Tasks.h"
+#include "Loader.h"
+#include "Perf.h"
+#include "Timers.h"
+#include "Log.h"
 #include <strsafe.h>
-#include <time.h>
 #include <vector>
 
 using std::vector;
@@ -36,8 +39,28 @@ namespace {
 
 #define NPP_BOOKMARK_MARGIN_ID 1 // _SC_MARGE_SYBOLE
 #define NPP_FOLD_MARGIN_ID     2 // _SC_MARGE_FOLDER
-
-vector<Session> _sessions; ///< stores info on sessions read from disk
+#define HISTORY_MAX_SESSIONS   8 // how many recently loaded session names to remember
+#define PREPARE_MAX_SESSIONS   4 // how many likely-next sessions to prepare in the background
+#define TITLEBAR_DELAY_MS   1000 // NPP updates the title bar after SCN_SAVEPOINTLEFT
+#define MARGINCLICK_DELAY_MS 1000
+#define ASYNC_MAX_REQUESTS    32 // SMM_ASYNC requests that can be queued
+#define ASYNC_POLL_MS         50 // how often queued requests are checked
+#define BACKUP_WAIT_MS    10000 // how long the startup load waits for the backup task
+
+/// Lists the session directory for the SessionCatalog with Win32.
+class NppCatalogPlatform : public CatalogPlatform
+{
+  public:
+    WCHAR fileSpec[MAX_PATH];
+    DWORD lastError; ///< ERROR_NO_MORE_FILES if the whole directory was read
+    NppCatalogPlatform();
+    virtual bool listSessions(SessionCatalog &catalog);
+    virtual int compareNames(const wchar_t *s1, const wchar_t *s2);
+    virtual void toLower(wchar_t *str);
+    virtual bool isFavorite(const wchar_t *name);
+};
+
+SessionCatalog _sessions; ///< stores info on sessions read from disk
 INT _sesCurIdx;            ///< current session index
 INT _sesPrvIdx;            ///< previous session index
 INT _sesDefIdx;            ///< default session index
@@ -46,22 +69,34 @@ INT _bidBufferActivated;   ///< XXX experimental. bufferId from most recent NPPN
 bool _appReady;            ///< if false, plugin should do nothing
 bool _sesLoading;          ///< if true, a session is loading
 bool _fileOpenedFromCmdLine;
-time_t _shutdownTimer;     ///< for determining if files are closing due to a shutdown
-time_t _titlebarTimer;     ///< for updating the titlebar text
-time_t _marginClickTimer;  ///< for saving the session on a click in the bookmark or fold margin
-time_t _settingsTimer;     ///< for checking if settings need to be saved
+bool _sesDirty;            ///< if true, the open files may differ from the current session file
+bool _sesDirtyAfterLoad;   ///< true if other files were left open by the load, so the session is dirty when it finishes
+SessionMgrApiAsyncData _asyncQueue[ASYNC_MAX_REQUESTS]; ///< ring of queued SMM_ASYNC requests
+DWORD _asyncQueued[ASYNC_MAX_REQUESTS]; ///< tick count when each request was queued
+INT _asyncFirst;
+INT _asyncCount;
+bool _asyncClosed;         ///< if true, NPP is shutting down so requests are refused
+WCHAR _sesHistory[HISTORY_MAX_SESSIONS][SES_NAME_BUF_LEN]; ///< names of recently loaded sessions, most recent first
+INT _sesHistoryCount;
 
 void onNppReady();
+void onSessionSaveTimer();
+void onTitlebarTimer();
 void removeBracketedPrefix(LPWSTR s);
-void indexSessions();
-void resetSessions();
 INT normalizeSessionIndex(INT si);
+void addToHistory(LPCWSTR sesName);
+void prepareLikelySessions();
+void addCandidate(INT *candidates, INT *count, INT si);
+void autoSaveSession();
+void markDirty(LPCSTR reason);
+INT queueRequest(const SessionMgrApiAsyncData *req);
+void onAsyncTimer();
+void cancelRequests();
+INT listSessions(SessionMgrApiListData *req);
+INT countSessionFiles(LPCWSTR sesFile, vector<CHAR> &buf);
 
 } // end namespace
 
-bool sortByAlpha(const Session s1, const Session s2);
-bool sortByDate(const Session s1, const Session s2);
-
 //------------------------------------------------------------------------------
 
 namespace api {
@@ -76,22 +111,26 @@ void app_onLoad()
     _sesDefIdx = SI_NONE;
     _bidFileOpened = 0;
     _bidBufferActivated = 0;
-    _shutdownTimer = 0;
-    _titlebarTimer = 0;
-    _marginClickTimer = 0;
-    _settingsTimer = ::time(NULL);
+    _sesHistoryCount = 0;
+    _asyncFirst = 0;
+    _asyncCount = 0;
+    _asyncClosed = false;
+    _sesDirty = false;
+    _sesDirtyAfterLoad = false;
 }
 
 void app_onUnload()
 {
     LOG("---------- STOP  %S %s", PLUGIN_FULL_NAME, RES_VERSION_S);
     _appReady = false;
-    resetSessions();
+    _sessions.clear();
 }
 
 void app_init()
 {
     DWORD nppVer = sys_getNppVer();
+    lgr::start();
+    prf::startTrace();
     LOG("-------------- START %S %s", PLUGIN_FULL_NAME, RES_VERSION_S);
     LOG("win:%u, npp:%u.%u, dbg:%u, cfg:\"%S\", ctx:\"%S\"", sys_getWinVer(), HIWORD(nppVer), LOWORD(nppVer), gDbgLvl, sys_getCfgDir(), sys_getNppCtxMnuFile());
     app_readSessionDirectory(true);
@@ -102,7 +141,7 @@ LPCWSTR app_getName()
     return mnu_getMenuLabel();
 }
 
-/** Handles Notepad++ and Scintilla notifications and processes timers. */
+/** Handles Notepad++ and Scintilla notifications. */
 void app_onNotify(SCNotification *pscn)
 {
     uptr_t bufferId = pscn->nmhdr.idFrom;
@@ -133,42 +172,56 @@ void app_onNotify(SCNotification *pscn)
                 break;
             case NPPN_SHUTDOWN:
                 _appReady = false;
+                tmr::cancelAll();
+                ldr::cancel();
+                cancelRequests();
+                prf::writeTrace(tsk::stop());
+                prf::writeStats();
+                lgr::stop();
                 break;
             case NPPN_FILEOPENED:
                 _bidFileOpened = bufferId;
                 if (!_appReady) {
                     _fileOpenedFromCmdLine = true;
                 }
+                markDirty("file opened");
                 break;
             case NPPN_FILESAVED:
                 app_updateNppBars();
                 // intentional fall-thru
             case NPPN_LANGCHANGED:
-            //case NPPN_DOCORDERCHANGED:
-                if (_appReady && !_sesLoading && cfg::getBool(kAutomaticSave)) {
-                    app_saveSession(_sesCurIdx);
-                }
+                // The pathname changes on "save as". Caret and scroll positions,
+                // and bookmarks and folds set from the keyboard or menu, send no
+                // notification, so these always count as changes.
+                markDirty(notificationCode == NPPN_LANGCHANGED ? "language changed" : "file saved");
+                autoSaveSession();
+                break;
+            case NPPN_DOCORDERCHANGED:
+                markDirty("order changed");
                 break;
             //case NPPN_FILEBEFORECLOSE: // XXX experimental
             //    LOGG(10, "Shutdown %s be in progress", (bufferId != _bidBufferActivated) ? "MAY" : "may NOT");
             //    break;
             case NPPN_FILECLOSED:
-                if (_appReady && !_sesLoading && cfg::getBool(kAutomaticSave)) {
-                    _shutdownTimer = ::time(NULL);
-                    LOGG(10, "Save session in %i seconds if no shutdown", cfg::getInt(kSessionSaveDelay));
+                markDirty("file closed");
+                if (_appReady && !_sesLoading && cfg::get<kAutomaticSave>()) {
+                    // If NPP is shutting down NPPN_SHUTDOWN will cancel this.
+                    tmr::set(kTimerSessionSave, cfg::get<kSessionSaveDelay>() * 1000, onSessionSaveTimer);
+                    LOGG(10, "Save session in %i seconds if no shutdown", cfg::get<kSessionSaveDelay>());
                 }
                 break;
             case NPPN_BUFFERACTIVATED:
+                if (_bidBufferActivated != bufferId) {
+                    markDirty("active file changed");
+                }
                 _bidBufferActivated = bufferId;
                 if (_appReady && !_sesLoading) {
                     app_updateNppBars();
                     if (_bidFileOpened == bufferId) { // buffer activated immediately after NPPN_FILEOPENED
-                        if (cfg::getBool(kUseGlobalProperties)) {
+                        if (cfg::get<kUseGlobalProperties>()) {
                             prp::updateDocumentFromGlobal(_bidFileOpened);
                         }
-                        if (cfg::getBool(kAutomaticSave)) {
-                            app_saveSession(_sesCurIdx);
-                        }
+                        autoSaveSession();
                     }
                 }
                 _bidFileOpened = 0;
@@ -187,56 +240,20 @@ void app_onNotify(SCNotification *pscn)
         }
         switch (notificationCode) {
             case SCN_SAVEPOINTLEFT:
-                if (cfg::getBool(kShowInTitlebar)) {
-                    _titlebarTimer = ::time(NULL);
+                if (cfg::get<kShowInTitlebar>()) {
+                    tmr::set(kTimerTitlebar, TITLEBAR_DELAY_MS, onTitlebarTimer);
                 }
                 break;
             case SCN_MARGINCLICK:
-                if (_appReady && !_sesLoading && cfg::getBool(kAutomaticSave) &&
-                        (pscn->margin == NPP_BOOKMARK_MARGIN_ID || pscn->margin == NPP_FOLD_MARGIN_ID)) {
-                    _marginClickTimer = ::time(NULL);
+                if (pscn->margin == NPP_BOOKMARK_MARGIN_ID || pscn->margin == NPP_FOLD_MARGIN_ID) {
+                    markDirty("bookmark or fold changed");
+                    if (_appReady && !_sesLoading && cfg::get<kAutomaticSave>()) {
+                        tmr::set(kTimerMarginClick, MARGINCLICK_DELAY_MS, onSessionSaveTimer);
+                    }
                 }
                 break;
         }
     }
-
-    // Timers
-    if (_shutdownTimer > 0) {
-        if (_appReady && !_sesLoading) {
-            if (::time(NULL) - _shutdownTimer > cfg::getInt(kSessionSaveDelay)) {
-                _shutdownTimer = 0;
-                app_saveSession(_sesCurIdx);
-            }
-        }
-        else {
-            _shutdownTimer = 0;
-        }
-    }
-    if (_titlebarTimer > 0) {
-        if (::time(NULL) - _titlebarTimer > 1) {
-            _titlebarTimer = 0;
-            app_updateNppBars();
-        }
-    }
-    if (_marginClickTimer > 0) {
-        if (_appReady && !_sesLoading) {
-            if (::time(NULL) - _marginClickTimer > 1) {
-                _marginClickTimer = 0;
-                app_saveSession(_sesCurIdx);
-            }
-        }
-        else {
-            _marginClickTimer = 0;
-        }
-    }
-    if (_settingsTimer > 0) {
-        if (::time(NULL) - _settingsTimer > cfg::getInt(kSettingsSavePoll)) {
-            if (cfg::isDirty()) {
-                cfg::saveSettings();
-            }
-            _settingsTimer = ::time(NULL);
-        }
-    }
 }
 
 /** Session Manager P2P API. Handles messages from NPP or a plugin.
@@ -247,7 +264,13 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
         return 1;
     }
     SessionMgrApiData *api = (SessionMgrApiData*)lParam;
-    LOGG(10, "API msg=%u, iData=%i, wData=\"%S\"", api->message, api->iData, api->wData);
+    // SMM_SES_LIST and SMM_ASYNC use other structs, which have no wData.
+    LOGG(10, "API msg=%u, iData=%i, wData=\"%S\"", api->message, api->iData,
+        api->message == SMM_SES_LIST || api->message == SMM_ASYNC ? L"" : api->wData);
+    if (api->message == SMM_ASYNC) {
+        api->iData = queueRequest((SessionMgrApiAsyncData*)lParam);
+        return 1;
+    }
     if (!_appReady || _sesLoading) {
         LOGG(10, "SM_BUSY");
         api->iData = SM_BUSY;
@@ -291,10 +314,7 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
             break;
         case SMM_CFG_GET_INT:
             si = (SettingId)api->iData;
-            if ((si >= kAutomaticSave && si <= kSettingsSavePoll) ||
-                (si >= kCurrentMark && si <= kSessionSortOrder) ||
-                (si >= kSessionsDialogWidth && si <= kDebugLogLevel))
-            {
+            if (cfg::isIntSetting(si)) {
                 api->wData[0] = (WCHAR)cfg::getInt(si);
                 api->iData = SM_OK;
             }
@@ -304,11 +324,8 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
             break;
         case SMM_CFG_PUT_INT:
             si = (SettingId)api->iData;
-            if ((si >= kAutomaticSave && si <= kSettingsSavePoll) ||
-                (si >= kCurrentMark && si <= kSessionSortOrder) ||
-                si == kDebugLogLevel)
-            {
-                i = (INT)api->wData[0];
+            i = (INT)api->wData[0];
+            if (cfg::isIntSetting(si) && cfg::isApiWritable(si) && cfg::isInRange(si, i)) {
                 if (si == kShowInTitlebar) {
                     cfg::setShowInTitlebar(i != 0);
                 }
@@ -316,7 +333,7 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
                     cfg::setShowInStatusbar(i != 0);
                 }
                 else if (si == kUseContextMenu) {
-                    if (cfg::getBool(kUseContextMenu) && !i) {
+                    if (cfg::get<kUseContextMenu>() && !i) {
                         ctx::unload();
                     }
                     cfg::putInt(si, i);
@@ -332,7 +349,7 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
             break;
         case SMM_CFG_GET_STR:
             si = (SettingId)api->iData;
-            if (si >= 0 && si <= kDebugLogFile) {
+            if (si >= 0 && si < kSettingsCount && !cfg::isIntSetting(si)) {
                 cfg::getStr(si, api->wData, MAX_PATH);
                 api->iData = SM_OK;
             }
@@ -342,10 +359,7 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
             break;
         case SMM_CFG_PUT_STR:
             si = (SettingId)api->iData;
-            if ((si >= kSessionDirectory && si <= kSessionExtension) ||
-                (si >= kMenuLabelMain && si <= kMenuLabelSub6) ||
-                si == kDebugLogFile)
-            {
+            if (cfg::isApiWritable(si) && !cfg::isIntSetting(si)) {
                 if (si == kSessionDirectory) {
                     if (!cfg::setSessionDirectory(api->wData)) {
                         api->iData = SM_ERROR; // error creating directory
@@ -364,6 +378,9 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
                 }
                 else {
                     cfg::putStr(si, api->wData);
+                    if (si == kDebugLogFile) {
+                        lgr::setFile(api->wData);
+                    }
                     api->iData = SM_OK;
                 }
             }
@@ -371,6 +388,20 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
                 api->iData = SM_INVARG;
             }
             break;
+        case SMM_PRF_GET:
+            if (api->iData < 0 || api->iData >= kPhasesCount) {
+                api->iData = SM_INVARG;
+            }
+            else {
+                PhaseStats stats;
+                prf::getStats((PhaseId)api->iData, &stats);
+                ::StringCchPrintfW(api->wData, MAX_PATH, L"%u %u %u %u", stats.count, stats.p50, stats.p95, stats.max);
+                api->iData = SM_OK;
+            }
+            break;
+        case SMM_SES_LIST:
+            api->iData = listSessions((SessionMgrApiListData*)lParam);
+            break;
         case SMM_NPP_CFG_DIR:
             ::StringCchCopyW(api->wData, MAX_PATH, sys_getNppCtxMnuFile());
             if (pth::removeName(api->wData, MAX_PATH) != 0) {
@@ -422,27 +453,16 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam)
 
 //------------------------------------------------------------------------------
 
-/** Session constructor. */
-Session::Session(LPCWSTR sesName, FILETIME modTime)
-{
-    ::StringCchCopyW(name, SES_NAME_BUF_LEN, sesName);
-    modified.dwLowDateTime = modTime.dwLowDateTime;
-    modified.dwHighDateTime = modTime.dwHighDateTime;
-    isFavorite = false;
-}
-
 /** Reads all session names from the session directory. If there is a current
     and/or previous session it is made current and/or previous again if it is
     in the new list. */
 void app_readSessionDirectory(bool firstLoad)
 {
-    HANDLE hFind;
     bool appReadyPrv;
-    WIN32_FIND_DATAW ffd;
-    WCHAR sesFileSpec[MAX_PATH];
-    WCHAR sesName[SES_NAME_BUF_LEN];
+    NppCatalogPlatform platform;
     WCHAR sesCur[SES_NAME_BUF_LEN];
     WCHAR sesPrv[SES_NAME_BUF_LEN];
+    TraceScope trc("app_readSessionDirectory");
 
     LOGF("");
 
@@ -456,50 +476,28 @@ void app_readSessionDirectory(bool firstLoad)
         if (_sesPrvIdx > SI_NONE) {
             ::StringCchCopyW(sesPrv, SES_NAME_BUF_LEN, _sessions[_sesPrvIdx].name);
         }
-        resetSessions();
+        _sessions.clear();
     }
     else { // on startup
         cfg::getStr(kCurrentSession, sesCur, SES_NAME_BUF_LEN);
         cfg::getStr(kPreviousSession, sesPrv, SES_NAME_BUF_LEN);
     }
-    // Create the file spec.
-    ::StringCchCopyW(sesFileSpec, MAX_PATH, cfg::getStr(kSessionDirectory));
-    ::StringCchCatW(sesFileSpec, MAX_PATH, L"*");
-    ::StringCchCatW(sesFileSpec, MAX_PATH, cfg::getStr(kSessionExtension));
-    // Loop over files in the session directory, save each in the vector.
-    hFind = ::FindFirstFileW(sesFileSpec, &ffd);
-    if (hFind == INVALID_HANDLE_VALUE) {
-        _sesCurIdx = SI_DEFAULT;
-        return;
-    }
+    // Read, sort and index the files in the session directory.
     appReadyPrv = _appReady;
     _appReady = false;
-    do {
-        ::StringCchCopyW(sesName, SES_NAME_BUF_LEN, ffd.cFileName);
-        pth::removeExt(sesName, SES_NAME_BUF_LEN);
-        Session ses(sesName, ffd.ftLastWriteTime);
-        ses.isFavorite = cfg::isFavorite(sesName);
-        _sessions.push_back(ses);
-    }
-    while (::FindNextFileW(hFind, &ffd) != 0);
-    DWORD lastError = ::GetLastError();
-    ::FindClose(hFind);
-    // Sort before indexing.
-    if (cfg::isSortAlpha()) {
-        std::sort(_sessions.begin(), _sessions.end(), sortByAlpha);
-    }
-    else {
-        std::sort(_sessions.begin(), _sessions.end(), sortByDate);
+    if (!_sessions.read(platform, cfg::isSortAlpha())) {
+        _sesCurIdx = SI_DEFAULT;
+        _appReady = appReadyPrv;
+        return;
     }
-    indexSessions();
-    _sesDefIdx = app_getSessionIndex(cfg::getStr(kDefaultSession));
-    if (firstLoad && !cfg::getBool(kAutomaticLoad)) {
+    _sesDefIdx = app_getSessionIndex(cfg::get<kDefaultSession>());
+    if (firstLoad && !cfg::get<kAutomaticLoad>()) {
         // Set new previous to old current and new current to default.
         cfg::getStr(kCurrentSession, sesCur, SES_NAME_BUF_LEN);
         _sesPrvIdx = app_getSessionIndex(sesCur);
         cfg::putStr(kPreviousSession, app_getSessionName(_sesPrvIdx));
         _sesCurIdx = _sesDefIdx;
-        cfg::putStr(kCurrentSession, cfg::getStr(kDefaultSession));
+        cfg::putStr(kCurrentSession, cfg::get<kDefaultSession>());
     }
     else {
         // If a session was current/previous try to make it current/previous
@@ -507,41 +505,25 @@ void app_readSessionDirectory(bool firstLoad)
         _sesCurIdx = app_getSessionIndex(sesCur);
         _sesPrvIdx = app_getSessionIndex(sesPrv);
     }
+    mnu_indexFavorites();
 
-    if (lastError != ERROR_NO_MORE_FILES) {
-        msg::error(lastError, L"%s: Error reading session files \"%s\".", _W(__FUNCTION__), sesFileSpec);
+    if (platform.lastError != ERROR_NO_MORE_FILES) {
+        msg::error(platform.lastError, L"%s: Error reading session files \"%s\".", _W(__FUNCTION__), platform.fileSpec);
     }
     _appReady = appReadyPrv;
 }
 
-/** Sorts the _sessions vector ascending alphabetically. */
-bool sortByAlpha(const Session s1, const Session s2)
-{
-    return ::lstrcmpW(s1.name, s2.name) <= 0;
-}
-
-/** Sorts the _sessions vector descending by the files' last modified times. For
-    sessions that have the same last modified time it sorts ascending alphabetically. */
-bool sortByDate(const Session s1, const Session s2)
-{
-    INT result = ::CompareFileTime(&s1.modified, &s2.modified);
-    if (result < 0) {
-        return false;
-    }
-    if (result > 0) {
-        return true;
-    }
-    return sortByAlpha(s1, s2);
-}
-
 /** Loads the session at index si. Makes it the current index unless lic is
     true. Closes the previous session before loading si, unless lwc is true. */
 void app_loadSession(INT si)
 {
-    app_loadSession(si, cfg::getBool(kLoadIntoCurrent), cfg::getBool(kLoadWithoutClosing));
+    app_loadSession(si, cfg::get<kLoadIntoCurrent>(), cfg::get<kLoadWithoutClosing>());
 }
 void app_loadSession(INT si, bool lic, bool lwc, bool firstLoad)
 {
+    INT threshold;
+    PerfTime tLoad, t;
+    TraceScope trc("app_loadSession");
     WCHAR sesFile[MAX_PATH];
     HWND hNpp = sys_getNppHandle();
 
@@ -550,6 +532,7 @@ void app_loadSession(INT si, bool lic, bool lwc, bool firstLoad)
     }
 
     LOGF("%i, %i, %i, %i", si, lic, lwc, firstLoad);
+    tLoad = prf::now();
 
     si = normalizeSessionIndex(si);
     if (si <= SI_NONE) {
@@ -557,8 +540,10 @@ void app_loadSession(INT si, bool lic, bool lwc, bool firstLoad)
     }
 
     if (!lic && _sesCurIdx > SI_NONE && !firstLoad) {
-        if (cfg::getBool(kAutomaticSave)) {
+        if (cfg::get<kAutomaticSave>()) {
+            t = prf::now();
             app_saveSession(_sesCurIdx); // Save the current session before closing it
+            prf::record(kPhaseLoadSave, t);
         }
         _sesPrvIdx = _sesCurIdx;
         cfg::putStr(kPreviousSession, _sessions[_sesPrvIdx].name); // save new previous session name
@@ -567,29 +552,65 @@ void app_loadSession(INT si, bool lic, bool lwc, bool firstLoad)
     _sesLoading = true;
 
     app_getSessionFile(si, sesFile);
-    if (cfg::getBool(kUseGlobalProperties)) {
+    if (cfg::get<kUseGlobalProperties>()) {
+        t = prf::now();
         prp::updateSessionFromGlobal(sesFile);
+        prf::record(kPhaseLoadMerge, t);
     }
 
     // Close all open files
     if (!lwc) {
         LOGG(10, "Closing documents for session %i", _sesCurIdx);
+        t = prf::now();
         ::SendMessageW(hNpp, NPPM_MENUCOMMAND, 0, IDM_FILE_CLOSEALL);
+        prf::record(kPhaseLoadClose, t);
     }
     LOGG(10, "Opening documents for session %i", si);
     // Load session
-    ::SendMessageW(hNpp, NPPM_LOADSESSION, 0, (LPARAM)sesFile);
-    _sesLoading = false;
+    t = prf::now();
+    threshold = cfg::get<kProgressiveLoad>();
+    if (threshold <= 0 || !ldr::loadFirstBatch(sesFile, threshold, cfg::get<kProgressiveLoadBatch>())) {
+        ::SendMessageW(hNpp, NPPM_LOADSESSION, 0, (LPARAM)sesFile);
+    }
+    prf::record(kPhaseLoadOpen, t);
+    // The open files match the session file unless other files were left open.
+    _sesDirtyAfterLoad = lic || lwc;
+    _sesDirty = _sesDirtyAfterLoad;
+    // If batches remain, loading continues until app_onBatchesLoaded is called.
+    _sesLoading = ldr::isLoading();
     if (!lic) {
         _sesCurIdx = si;
         cfg::putStr(kCurrentSession, _sessions[si].name); // save new current session name
+        t = prf::now();
         app_updateNppBars();
+        prf::record(kPhaseLoadBars, t);
     }
+    addToHistory(_sessions[si].name);
 
     if (firstLoad && _fileOpenedFromCmdLine) {
         LOGG(10, "File opened from command line. Selecting first tab.");
         ::SendMessageW(hNpp, NPPM_ACTIVATEDOC, 0, 0);
     }
+    if (!firstLoad) {
+        prepareLikelySessions();
+    }
+    prf::record(kPhaseLoad, tLoad);
+}
+
+/** Called when the last batch of a progressively loaded session is loaded.
+    Changes the user made while the batches loaded are kept. */
+void app_onBatchesLoaded()
+{
+    LOGF("");
+    _sesLoading = false;
+    _sesDirty = _sesDirty || _sesDirtyAfterLoad;
+}
+
+/** Called when a progressive load is cancelled before its last batch. */
+void app_onBatchesCancelled()
+{
+    LOGF("");
+    _sesLoading = false;
 }
 
 /** Saves the session at index si. Makes it the current index. */
@@ -604,21 +625,33 @@ void app_saveSession(INT si)
         return;
     }
     WCHAR sesFile[MAX_PATH];
+    TraceScope trc("app_saveSession");
+    PerfTime tSave = prf::now(), t;
+    UINT heapAllocs = prf::getCount(kCountHeapAllocs);
     app_getSessionFile(si, sesFile);
+    sys_lockFiles();
     ::SendMessageW(sys_getNppHandle(), NPPM_SAVECURRENTSESSION, 0, (LPARAM)sesFile); // Save session
+    sys_unlockFiles();
+    prf::record(kPhaseSaveNpp, tSave);
     _sesCurIdx = si;
-    if (cfg::getBool(kUseGlobalProperties)) {
+    _sesDirty = false;
+    if (cfg::get<kUseGlobalProperties>()) {
+        t = prf::now();
         prp::updateGlobalFromSession(sesFile);
+        prf::record(kPhaseSaveGlobal, t);
     }
+    prepareLikelySessions();
+    prf::record(kPhaseSave, tSave);
+    LOGG(5, "Save used %u heap allocations", prf::getCount(kCountHeapAllocs) - heapAllocs);
 }
 
 /** @return true if session index si is valid, else false */
 bool app_isValidSessionIndex(INT si)
 {
-    return (si >= 0 && si < (signed)_sessions.size());
+    return (si >= 0 && si < _sessions.size());
 }
 
-/** @return the number of items in the _sessions vector */
+/** @return the number of sessions */
 INT app_getSessionCount()
 {
     return _sessions.size();
@@ -630,14 +663,8 @@ INT app_getSessionIndex(LPCWSTR name)
     if (name == NULL || *name == 0) {
         return _sesDefIdx;
     }
-    INT i = 0;
-    for (vector<Session>::const_iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
-        if (::wcscmp(it->name, name) == 0) {
-            return i;
-        }
-        ++i;
-    }
-    return _sesDefIdx;
+    INT si = _sessions.find(name);
+    return si >= 0 ? si : _sesDefIdx;
 }
 
 /** @return the current session index */
@@ -658,12 +685,20 @@ INT app_getDefaultIndex()
     return _sesDefIdx;
 }
 
+/** Sets isVisible on each session for the Sessions dialog's filter. The
+    current and previous sessions are always visible. */
+void app_filterSessions(LPCWSTR filter)
+{
+    NppCatalogPlatform platform;
+    _sessions.filter(platform, filter, cfg::get<kUseFilterWildcards>(), _sesCurIdx, _sesPrvIdx);
+}
+
 /** Sets the previous session index to the default index and updates the
     settings file and NPP bars. */
 void app_resetPreviousIndex()
 {
     _sesPrvIdx = _sesDefIdx;
-    cfg::putStr(kPreviousSession, cfg::getStr(kDefaultSession));
+    cfg::putStr(kPreviousSession, cfg::get<kDefaultSession>());
     app_updateNppBars();
 }
 
@@ -673,7 +708,7 @@ void app_renameSession(INT si, LPWSTR newName)
 {
     bool curOrPrv = false;
     if (app_isValidSessionIndex(si)) {
-        ::StringCchCopyW(_sessions[si].name, SES_NAME_BUF_LEN, newName);
+        _sessions.rename(si, newName);
         if (si == _sesCurIdx) {
             curOrPrv = true;
             cfg::putStr(kCurrentSession, newName);
@@ -701,9 +736,9 @@ LPCWSTR app_getSessionName(INT si)
 /** Copies into buf the full pathname of the session at index si. */
 void app_getSessionFile(INT si, LPWSTR buf)
 {
-    ::StringCchCopyW(buf, MAX_PATH, cfg::getStr(kSessionDirectory));
+    ::StringCchCopyW(buf, MAX_PATH, cfg::get<kSessionDirectory>());
     ::StringCchCatW(buf, MAX_PATH, app_getSessionName(si));
-    ::StringCchCatW(buf, MAX_PATH, cfg::getStr(kSessionExtension));
+    ::StringCchCatW(buf, MAX_PATH, cfg::get<kSessionExtension>());
 }
 
 /** @return a pointer to the Session object at index si */
@@ -723,10 +758,10 @@ void app_confirmDefaultSession()
 
     ::StringCchCopyW(oldFile, MAX_PATH, sys_getCfgDir());
     ::StringCchCatW(oldFile, MAX_PATH, L"default");
-    ::StringCchCatW(oldFile, MAX_PATH, cfg::getStr(kSessionExtension));
-    ::StringCchCopyW(newFile, MAX_PATH, cfg::getStr(kSessionDirectory));
-    ::StringCchCatW(newFile, MAX_PATH, cfg::getStr(kDefaultSession));
-    ::StringCchCatW(newFile, MAX_PATH, cfg::getStr(kSessionExtension));
+    ::StringCchCatW(oldFile, MAX_PATH, cfg::get<kSessionExtension>());
+    ::StringCchCopyW(newFile, MAX_PATH, cfg::get<kSessionDirectory>());
+    ::StringCchCatW(newFile, MAX_PATH, cfg::get<kDefaultSession>());
+    ::StringCchCatW(newFile, MAX_PATH, cfg::get<kSessionExtension>());
     if (pth::fileExists(oldFile)) {
         if (!::CopyFileW(oldFile, newFile, TRUE)) {
             pth::createFileIfMissing(newFile, SES_DEFAULT_CONTENTS);
@@ -749,8 +784,8 @@ void app_updateNppBars()
 
     WCHAR buf1[MAX_PATH];
     WCHAR buf2[MAX_PATH];
-    bool sbar = cfg::getBool(kShowInStatusbar);
-    bool tbar = cfg::getBool(kShowInTitlebar);
+    bool sbar = cfg::get<kShowInStatusbar>();
+    bool tbar = cfg::get<kShowInTitlebar>();
 
     if (sbar || tbar) {
         LOGF("");
@@ -778,7 +813,7 @@ void app_updateFavorites(bool clearAll)
 {
     cfg::deleteChildren(kFavorites);
     ctx::deleteFavorites();
-    for (vector<Session>::iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
+    for (SessionCatalog::iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
         if (clearAll) {
             it->isFavorite = false;
         }
@@ -796,7 +831,7 @@ INT app_getLbIdxStartingWith(WCHAR targetChar)
 {
     INT lbIdx = 0;
 
-    for (vector<Session>::const_iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
+    for (SessionCatalog::const_iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
         if (it->isVisible) {
             if ((WCHAR)::CharUpperW((LPWSTR)it->name[0]) == targetChar) {
                 return lbIdx;
@@ -816,7 +851,11 @@ void onNppReady()
     WCHAR name[MAX_PATH];
     name[0] = 0;
     _appReady = true;
-    if (cfg::getBool(kAutomaticLoad)) {
+    // Start the startup tasks. The startup load rewrites its session file, so
+    // it must wait for the backup.
+    tsk::start();
+    tsk::waitFor(SYS_TASK_BACKUP, BACKUP_WAIT_MS);
+    if (cfg::get<kAutomaticLoad>()) {
         cfg::getStr(kPreviousSession, name, MAX_PATH);
         _sesPrvIdx = app_getSessionIndex(name);
         cfg::getStr(kCurrentSession, name, MAX_PATH);
@@ -826,6 +865,263 @@ void onNppReady()
             app_loadSession(app_getSessionIndex(name), false, true, true);
         }
     }
+    prepareLikelySessions();
+}
+
+/** The kTimerSessionSave and kTimerMarginClick timers call this. */
+void onSessionSaveTimer()
+{
+    autoSaveSession();
+}
+
+void onTitlebarTimer()
+{
+    app_updateNppBars();
+}
+
+/** Moves sesName to the front of the load history. */
+void addToHistory(LPCWSTR sesName)
+{
+    INT i;
+
+    for (i = 0; i < _sesHistoryCount; ++i) {
+        if (::wcscmp(_sesHistory[i], sesName) == 0) {
+            break;
+        }
+    }
+    if (i == _sesHistoryCount) { // not found
+        if (_sesHistoryCount < HISTORY_MAX_SESSIONS) {
+            ++_sesHistoryCount;
+        }
+        else {
+            --i; // drop the oldest
+        }
+    }
+    for (; i > 0; --i) {
+        ::StringCchCopyW(_sesHistory[i], SES_NAME_BUF_LEN, _sesHistory[i - 1]);
+    }
+    ::StringCchCopyW(_sesHistory[0], SES_NAME_BUF_LEN, sesName);
+}
+
+/** Has the sessions most likely to be loaded next merged with the global
+    properties in the background, so loading one of them can skip that step.
+    In order of likelihood these are the previous session, recently loaded
+    sessions and favorites. */
+void prepareLikelySessions()
+{
+    INT i, si, count = 0;
+    INT candidates[PREPARE_MAX_SESSIONS];
+    WCHAR sesFiles[PREPARE_MAX_SESSIONS][MAX_PATH];
+    LPCWSTR sesFilePtrs[PREPARE_MAX_SESSIONS];
+
+    if (!cfg::get<kUseGlobalProperties>()) {
+        return;
+    }
+    addCandidate(candidates, &count, _sesPrvIdx);
+    for (i = 0; i < _sesHistoryCount; ++i) {
+        si = app_getSessionIndex(_sesHistory[i]);
+        if (app_isValidSessionIndex(si) && ::wcscmp(_sessions[si].name, _sesHistory[i]) == 0) {
+            addCandidate(candidates, &count, si);
+        }
+    }
+    for (si = 0; si < _sessions.size(); ++si) {
+        if (_sessions[si].isFavorite) {
+            addCandidate(candidates, &count, si);
+        }
+    }
+    for (i = 0; i < count; ++i) {
+        app_getSessionFile(candidates[i], sesFiles[i]);
+        sesFilePtrs[i] = sesFiles[i];
+        LOGG(10, "Likely next session: %S", _sessions[candidates[i]].name);
+    }
+    prp::prepareSessions(sesFilePtrs, count);
+}
+
+/** Appends si to candidates unless it is invalid, current, already present or
+    candidates is full. */
+void addCandidate(INT *candidates, INT *count, INT si)
+{
+    INT i;
+
+    if (*count >= PREPARE_MAX_SESSIONS || !app_isValidSessionIndex(si) || si == _sesCurIdx) {
+        return;
+    }
+    for (i = 0; i < *count; ++i) {
+        if (candidates[i] == si) {
+            return;
+        }
+    }
+    candidates[(*count)++] = si;
+}
+
+/** Saves the current session if automatic save is enabled and the session
+    state has changed since it was loaded or saved. A suppressed save is
+    counted in kCountAutoSaveSkipped. */
+void autoSaveSession()
+{
+    if (!_appReady || _sesLoading || !cfg::get<kAutomaticSave>()) {
+        return;
+    }
+    if (!_sesDirty) {
+        prf::increment(kCountAutoSaveSkipped);
+        LOGG(10, "Session unchanged, not saving");
+        return;
+    }
+    prf::increment(kCountAutoSave);
+    app_saveSession(_sesCurIdx);
+}
+
+void markDirty(LPCSTR reason)
+{
+    if (ldr::isLoadingBatch()) {
+        return; // caused by the loader, not a change to the session
+    }
+    if (!_sesDirty) {
+        LOGG(10, "Session changed: %s", reason);
+        _sesDirty = true;
+    }
+}
+
+/** Adds an SMM_ASYNC request to the queue and starts the timer that runs it.
+    @return SM_OK, SM_BUSY if the queue is full, SM_SHUTDOWN, or SM_INVARG */
+INT queueRequest(const SessionMgrApiAsyncData *req)
+{
+    if (!req->request || req->request->message == SMM_ASYNC || !::IsWindow(req->hReply)) {
+        return SM_INVARG;
+    }
+    if (_asyncClosed) {
+        return SM_SHUTDOWN;
+    }
+    if (_asyncCount == ASYNC_MAX_REQUESTS) {
+        return SM_BUSY;
+    }
+    INT i = (_asyncFirst + _asyncCount++) % ASYNC_MAX_REQUESTS;
+    _asyncQueue[i] = *req;
+    _asyncQueued[i] = ::GetTickCount();
+    LOGG(10, "Queued async request %i, msg=%u", req->id, req->request->message);
+    if (!tmr::isSet(kTimerAsync)) {
+        tmr::set(kTimerAsync, 0, onAsyncTimer);
+    }
+    return SM_OK;
+}
+
+/** Replies to expired requests, then runs the first queued request if not
+    busy. Runs again while requests remain. */
+void onAsyncTimer()
+{
+    SessionMgrApiAsyncData req;
+
+    while (_asyncCount > 0) {
+        req = _asyncQueue[_asyncFirst];
+        if (req.timeoutMs > 0 && ::GetTickCount() - _asyncQueued[_asyncFirst] > req.timeoutMs) {
+            req.request->iData = SM_EXPIRED;
+        }
+        else if (!_appReady || _sesLoading) {
+            break;
+        }
+        else {
+            api::app_msgProc(NPPM_MSGTOPLUGIN, 0, (LPARAM)req.request);
+        }
+        _asyncFirst = (_asyncFirst + 1) % ASYNC_MAX_REQUESTS;
+        --_asyncCount;
+        LOGG(10, "Async request %i done, iData=%i", req.id, req.request->iData);
+        ::PostMessageW(req.hReply, req.replyMsg, (WPARAM)req.id, (LPARAM)req.request->iData);
+        if (req.request->iData != SM_EXPIRED) {
+            break; // one per timer so NPP stays responsive
+        }
+    }
+    if (_asyncCount > 0) {
+        tmr::set(kTimerAsync, ASYNC_POLL_MS, onAsyncTimer);
+    }
+}
+
+/** Replies SM_SHUTDOWN to every queued request and refuses new ones. Called on
+    NPPN_SHUTDOWN so no client waits for a reply that will never come. */
+void cancelRequests()
+{
+    SessionMgrApiAsyncData req;
+
+    _asyncClosed = true;
+    while (_asyncCount > 0) {
+        req = _asyncQueue[_asyncFirst];
+        _asyncFirst = (_asyncFirst + 1) % ASYNC_MAX_REQUESTS;
+        --_asyncCount;
+        req.request->iData = SM_SHUTDOWN;
+        LOGG(10, "Async request %i cancelled", req.id);
+        ::PostMessageW(req.hReply, req.replyMsg, (WPARAM)req.id, (LPARAM)SM_SHUTDOWN);
+    }
+}
+
+/** Copies the sessions list into the client's buffer for SMM_SES_LIST.
+    @return SM_OK or SM_INVARG */
+INT listSessions(SessionMgrApiListData *req)
+{
+    INT si, count, flags;
+    vector<CHAR> buf;
+    WCHAR sesFile[MAX_PATH];
+    SessionMgrApiList *list = req->list;
+    SessionMgrApiListItem *item;
+
+    C_ASSERT(sizeof(item->name) / sizeof(WCHAR) == SES_NAME_BUF_LEN);
+    if (!list || list->version != SM_LIST_VERSION || list->capacity < 0) {
+        return SM_INVARG;
+    }
+    count = _sessions.size();
+    list->count = count;
+    list->itemSize = sizeof(SessionMgrApiListItem);
+    for (si = 0; si < count && si < list->capacity; ++si) {
+        const Session &ses = _sessions[si];
+        item = &list->items[si];
+        flags = ses.isFavorite ? SM_SES_FAVORITE : 0;
+        if (si == _sesCurIdx) {
+            flags |= SM_SES_CURRENT;
+        }
+        if (si == _sesPrvIdx) {
+            flags |= SM_SES_PREVIOUS;
+        }
+        if (si == _sesDefIdx) {
+            flags |= SM_SES_DEFAULT;
+        }
+        item->modified.dwLowDateTime = (DWORD)ses.modified;
+        item->modified.dwHighDateTime = (DWORD)(ses.modified >> 32);
+        item->flags = flags;
+        item->fileCount = -1;
+        if (req->iData & SM_LIST_FILES) {
+            app_getSessionFile(si, sesFile);
+            item->fileCount = countSessionFiles(sesFile, buf);
+        }
+        ::StringCchCopyW(item->name, SES_NAME_BUF_LEN, ses.name);
+    }
+    return SM_OK;
+}
+
+/** Counts the File elements in a session file without parsing it. A '<' can
+    not appear unescaped in an attribute value, so every "<File " starts one.
+    @return the number of files, or -1 if sesFile could not be read */
+INT countSessionFiles(LPCWSTR sesFile, vector<CHAR> &buf)
+{
+    INT count = -1;
+    DWORD bytesRead;
+    LARGE_INTEGER size;
+    LPCSTR p;
+
+    HANDLE hFile = ::CreateFileW(sesFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    if (::GetFileSizeEx(hFile, &size) && size.HighPart == 0 && size.LowPart < 0x7FFFFFFF) {
+        buf.resize(size.LowPart + 1);
+        if (::ReadFile(hFile, &buf[0], size.LowPart, &bytesRead, NULL)) {
+            buf[bytesRead] = 0;
+            count = 0;
+            for (p = ::strstr(&buf[0], "<File "); p; p = ::strstr(p + 6, "<File ")) {
+                ++count;
+            }
+        }
+    }
+    ::CloseHandle(hFile);
+    return count;
 }
 
 /** Removes a possible bracketed prefix including any trailing spaces. */
@@ -851,21 +1147,49 @@ void removeBracketedPrefix(LPWSTR s)
     }
 }
 
-/** Assigns sequential, 0-based numbers (session indexes) to the Session objects
-    in the _sessions vector. Must not be called before the _sessions vector is sorted. */
-void indexSessions()
+NppCatalogPlatform::NppCatalogPlatform()
 {
-    INT idx = 0;
-    for (vector<Session>::iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
-        it->index = idx;
-        ++idx;
+    ::StringCchCopyW(fileSpec, MAX_PATH, cfg::get<kSessionDirectory>());
+    ::StringCchCatW(fileSpec, MAX_PATH, L"*");
+    ::StringCchCatW(fileSpec, MAX_PATH, cfg::get<kSessionExtension>());
+    lastError = ERROR_NO_MORE_FILES;
+}
+
+/** Adds each file matching fileSpec to catalog, without its extension. */
+bool NppCatalogPlatform::listSessions(SessionCatalog &catalog)
+{
+    HANDLE hFind;
+    WIN32_FIND_DATAW ffd;
+    WCHAR sesName[SES_NAME_BUF_LEN];
+
+    hFind = ::FindFirstFileW(fileSpec, &ffd);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return false;
     }
+    do {
+        ::StringCchCopyW(sesName, SES_NAME_BUF_LEN, ffd.cFileName);
+        pth::removeExt(sesName, SES_NAME_BUF_LEN);
+        catalog.add(sesName, ((unsigned long long)ffd.ftLastWriteTime.dwHighDateTime << 32) | ffd.ftLastWriteTime.dwLowDateTime);
+    }
+    while (::FindNextFileW(hFind, &ffd) != 0);
+    lastError = ::GetLastError();
+    ::FindClose(hFind);
+    return true;
 }
 
-/** Empties the _sessions vector. */
-void resetSessions()
+int NppCatalogPlatform::compareNames(const wchar_t *s1, const wchar_t *s2)
 {
-    _sessions.clear();
+    return ::lstrcmpW(s1, s2);
+}
+
+void NppCatalogPlatform::toLower(wchar_t *str)
+{
+    ::CharLowerW(str);
+}
+
+bool NppCatalogPlatform::isFavorite(const wchar_t *name)
+{
+    return cfg::isFavorite(name);
 }
 
 /** Converts a possible virtual index to a real index, else returns si. */
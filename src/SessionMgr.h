@@ -17,6 +17,7 @@
 #define NPP_PLUGIN_APPLICATION_H
 
 #include "res\version.h"
+#include "core\Catalog.h"
 
 //------------------------------------------------------------------------------
 
@@ -26,25 +27,12 @@ namespace NppPlugin {
 #define PLUGIN_FULL_NAME L"Session Manager"
 #define SES_NAME_NONE    L"None"
 #define SES_NAME_DEFAULT L"Default"
-#define SES_NAME_BUF_LEN 100
 /// Used as virtual session indexes
 #define SI_NONE     -1
 #define SI_CURRENT  -2
 #define SI_PREVIOUS -3
 #define SI_DEFAULT  -4
 
-/// @class Session
-class Session
-{
-  public:
-    INT index;
-    bool isVisible;
-    bool isFavorite;
-    FILETIME modified;
-    WCHAR name[SES_NAME_BUF_LEN];
-    Session(LPCWSTR sesName, FILETIME modTime);
-};
-
 //------------------------------------------------------------------------------
 /// @namespace NppPlugin::api Contains functions called only from DllMain.
 
@@ -64,6 +52,8 @@ LRESULT app_msgProc(UINT Message, WPARAM wParam, LPARAM lParam);
 void app_readSessionDirectory(bool firstLoad = false);
 void app_loadSession(INT si);
 void app_loadSession(INT si, bool lic, bool lwc, bool firstLoad = false);
+void app_onBatchesLoaded();
+void app_onBatchesCancelled();
 void app_saveSession(INT si = SI_CURRENT);
 bool app_isValidSessionIndex(INT si);
 INT app_getSessionCount();
@@ -71,6 +61,7 @@ INT app_getSessionIndex(LPCWSTR name);
 INT app_getCurrentIndex();
 INT app_getPreviousIndex();
 INT app_getDefaultIndex();
+void app_filterSessions(LPCWSTR filter);
 void app_resetPreviousIndex();
 void app_renameSession(INT si, LPWSTR newName);
 LPCWSTR app_getSessionName(INT si = SI_CURRENT);
@@ -27,6 +27,8 @@
 #define SM_ERROR  -3
 #define SM_INVMSG -4
 #define SM_INVARG -5
+#define SM_EXPIRED -6
+#define SM_SHUTDOWN -7
 
 /** This is compatible with casting to NPP's CommunicationInfo struct.
     @see npp\Notepad_plus_msgs.h */
@@ -37,6 +39,58 @@ struct SessionMgrApiData {
     WCHAR   wData[MAX_PATH]; ///< input or output API usage
 };
 
+/// Flags of a SessionMgrApiListItem
+#define SM_SES_FAVORITE 0x01
+#define SM_SES_CURRENT  0x02
+#define SM_SES_PREVIOUS 0x04
+#define SM_SES_DEFAULT  0x08
+
+/// SMM_SES_LIST option, in iData: read each session file to count its files
+#define SM_LIST_FILES   0x01
+
+/// Layout version of SessionMgrApiList, changed if the layout changes
+#define SM_LIST_VERSION 1
+
+/// A session in a SessionMgrApiList
+struct SessionMgrApiListItem {
+    FILETIME modified;  ///< last write time of the session file (UTC)
+    INT      flags;     ///< SM_SES_ flags
+    INT      fileCount; ///< files in the session, or -1 if not counted
+    WCHAR    name[100]; ///< session name, no path or extension
+};
+
+/** The caller's buffer for SMM_SES_LIST. Its size in bytes must be at least
+    sizeof(SessionMgrApiList) + (capacity - 1) * sizeof(SessionMgrApiListItem). */
+struct SessionMgrApiList {
+    INT version;   ///< in: SM_LIST_VERSION
+    INT capacity;  ///< in: number of items the buffer can hold
+    INT count;     ///< out: number of sessions, can be more than capacity
+    INT itemSize;  ///< out: sizeof(SessionMgrApiListItem)
+    SessionMgrApiListItem items[1];
+};
+
+/** Sent instead of SessionMgrApiData for SMM_SES_LIST. The first three
+    members are the same. */
+struct SessionMgrApiListData {
+    long    message;         ///< SMM_SES_LIST
+    LPCWSTR caller;          ///< for NPP but not used as of v6.6.9
+    INT     iData;           ///< input and output API usage
+    SessionMgrApiList *list; ///< input and output API usage
+};
+
+/** Sent instead of SessionMgrApiData for SMM_ASYNC. The first three members
+    are the same. */
+struct SessionMgrApiAsyncData {
+    long    message;             ///< SMM_ASYNC
+    LPCWSTR caller;              ///< for NPP but not used as of v6.6.9
+    INT     iData;               ///< input and output API usage
+    SessionMgrApiData *request;  ///< the request to run, which must stay valid until the reply
+    HWND    hReply;              ///< window the reply is posted to
+    UINT    replyMsg;            ///< message posted to hReply
+    INT     id;                  ///< chosen by the caller, the reply's wParam
+    DWORD   timeoutMs;           ///< how long the request can wait to start, 0 for no limit
+};
+
 enum SettingId {
     kAutomaticSave = 0,
     kAutomaticLoad,
@@ -77,9 +131,25 @@ enum SettingId {
     kSettingsDialogHeight,
     kDebugLogLevel,
     kDebugLogFile,
+    kProgressiveLoad,
+    kProgressiveLoadBatch,
     kSettingsCount
 };
 
+/// Timed steps of loading and saving a session. @see SMM_PRF_GET
+enum PhaseId {
+    kPhaseLoad = 0,   ///< all of loading a session
+    kPhaseLoadSave,   ///< saving the outgoing session
+    kPhaseLoadMerge,  ///< updating the session file from global properties
+    kPhaseLoadClose,  ///< closing all files
+    kPhaseLoadOpen,   ///< NPP opening the session's files
+    kPhaseLoadBars,   ///< updating the title and status bars
+    kPhaseSave,       ///< all of saving a session
+    kPhaseSaveNpp,    ///< NPP writing the session file
+    kPhaseSaveGlobal, ///< updating global properties from the session file
+    kPhasesCount
+};
+
 //------------------------------------------------------------------------------
 
 /** Loads a session from the current sessions list.
@@ -121,7 +191,8 @@ enum SettingId {
     @post wData[0] = value of setting */
 #define SMM_CFG_GET_INT  (WM_APP + 7)
 
-/** Sets the integer value of a setting.
+/** Sets the integer value of a setting. SM_INVARG is returned if the value
+    is out of the setting's range.
     @pre  iData    = SettingId
     @pre  wData[0] = value to set
     @post iData    = SM_OK else SM_BUSY or SM_INVARG */
@@ -167,5 +238,36 @@ enum SettingId {
     @post wData = path */
 #define SMM_NPP_CFG_DIR  (WM_APP + 15)
 
+/** Gets timing statistics for a phase of session loading or saving, since
+    NPP started. Times are in microseconds.
+    @pre  iData = PhaseId
+    @post iData = SM_OK else SM_BUSY or SM_INVARG
+    @post wData = "count p50 p95 max" */
+#define SMM_PRF_GET      (WM_APP + 16)
+
+/** Gets the sessions list, in the order shown in the Sessions dialog. lParam
+    points to a SessionMgrApiListData. If count is more than capacity only
+    the first capacity items are written, and the caller can try again with a
+    larger buffer. Counting files reads every session file so it is slower.
+    @pre  iData          = SM_NULL or SM_LIST_FILES
+    @pre  list->version  = SM_LIST_VERSION
+    @pre  list->capacity = number of items list can hold
+    @post iData          = SM_OK else SM_BUSY or SM_INVARG
+    @post list->count, list->itemSize and list->items */
+#define SMM_SES_LIST     (WM_APP + 17)
+
+/** Queues a request to run when Session Manager is not busy, instead of
+    returning SM_BUSY. lParam points to a SessionMgrApiAsyncData. Requests run
+    in the order queued, one each time NPP is idle. When a request has run,
+    or has waited longer than timeoutMs, replyMsg is posted to hReply with
+    wParam = id and lParam = the request's iData, which is SM_EXPIRED if it
+    did not run. For SMM_SES_LIST request can point to a
+    SessionMgrApiListData. When NPP shuts down, queued requests get a reply
+    with SM_SHUTDOWN, and new ones are refused with SM_SHUTDOWN.
+    @pre  iData = SM_NULL
+    @pre  request, hReply, replyMsg, id and timeoutMs
+    @post iData = SM_OK else SM_BUSY if the queue is full, SM_SHUTDOWN or SM_INVARG */
+#define SMM_ASYNC        (WM_APP + 18)
+
 
 #endif // NPP_PLUGIN_SESSIONMGRAPI_H
@@ -0,0 +1,106 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      SettingDefs.h
+    @copyright Copyright 2014,2015 Michael Foster <http://mfoster.com/npp/>
+
+    The schema of the settings: name, default, range and type of each one.
+    It is in a header so that cfg::get can return each setting's own type.
+*/
+
+#ifndef NPP_PLUGIN_SETTINGDEFS_H
+#define NPP_PLUGIN_SETTINGDEFS_H
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+/// Values of kSessionSortOrder
+#define SORT_ORDER_ALPHA 1
+#define SORT_ORDER_DATE  2
+
+/// Setting flags
+#define CFG_VOLATILE 0x01 ///< changes too often to be saved on every change
+#define CFG_API_PUT  0x02 ///< can be changed via SMM_CFG_PUT_INT or SMM_CFG_PUT_STR
+
+/** The schema of each setting is a specialization of SettingDef, defined with
+    CFG_INT, CFG_BOOL, CFG_MARK or CFG_STR. ValueType is what cfg::get returns
+    for it. A SettingId without a definition, or a definition whose default is
+    out of range, fails to compile. */
+template<INT id> struct SettingDef;
+
+#define CFG_NUM(id, cName, defVal, lo, hi, cfgFlags, vType) \
+    template<> struct SettingDef<id> { \
+        typedef vType ValueType; \
+        static LPCSTR name() { return cName; } \
+        static LPCSTR defaultValue() { return #defVal; } \
+        enum { isInt = 1, minValue = lo, maxValue = hi, flags = cfgFlags, bufLen = 0 }; \
+        C_ASSERT(defVal >= lo && defVal <= hi); \
+    }
+
+#define CFG_STR(id, cName, defVal, len, cfgFlags) \
+    template<> struct SettingDef<id> { \
+        typedef LPCWSTR ValueType; \
+        static LPCSTR name() { return cName; } \
+        static LPCSTR defaultValue() { return defVal; } \
+        enum { isInt = 0, minValue = 0, maxValue = 0, flags = cfgFlags, bufLen = len }; \
+        C_ASSERT(sizeof defVal <= len); \
+    }
+
+#define CFG_INT(id, cName, defVal, lo, hi, cfgFlags) CFG_NUM(id, cName, defVal, lo, hi, cfgFlags, INT)
+#define CFG_BOOL(id, cName, defVal) CFG_NUM(id, cName, defVal, 0, 1, CFG_API_PUT, bool)
+#define CFG_MARK(id, cName, defVal) CFG_NUM(id, cName, defVal, 1, 0xFFFF, CFG_API_PUT, INT)
+
+CFG_BOOL(kAutomaticSave,          "automaticSave",         1);
+CFG_BOOL(kAutomaticLoad,          "automaticLoad",         0);
+CFG_BOOL(kLoadIntoCurrent,        "loadIntoCurrent",       0);
+CFG_BOOL(kLoadWithoutClosing,     "loadWithoutClosing",    0);
+CFG_BOOL(kShowInTitlebar,         "showInTitlebar",        0);
+CFG_BOOL(kShowInStatusbar,        "showInStatusbar",       0);
+CFG_BOOL(kUseGlobalProperties,    "useGlobalProperties",   1);
+CFG_BOOL(kCleanGlobalProperties,  "cleanGlobalProperties", 0);
+CFG_BOOL(kUseContextMenu,         "useContextMenu",        1);
+CFG_BOOL(kBackupOnStartup,        "backupOnStartup",       1);
+CFG_INT (kSessionSaveDelay,       "sessionSaveDelay",      3, 0, 3600, CFG_API_PUT);
+CFG_INT (kSettingsSavePoll,       "settingsSavePoll",      2, 1, 3600, CFG_API_PUT);
+CFG_STR (kSessionDirectory,       "sessionDirectory",      "",                 MAX_PATH, CFG_API_PUT);
+CFG_STR (kSessionExtension,       "sessionExtension",      ".npp-session",     MAX_PATH, CFG_API_PUT);
+CFG_MARK(kCurrentMark,            "currentMark",           9674);
+CFG_MARK(kCurrentFavMark,         "currentFavMark",        9830);
+CFG_MARK(kPreviousMark,           "previousMark",          9702);
+CFG_MARK(kPreviousFavMark,        "previousFavMark",       8226);
+CFG_MARK(kDefaultMark,            "defaultMark",           9653);
+CFG_MARK(kDefaultFavMark,         "defaultFavMark",        9652);
+CFG_MARK(kFavoriteMark,           "favoriteMark",          183);
+CFG_BOOL(kUseFilterWildcards,     "useFilterWildcards",    0);
+CFG_INT (kSessionSortOrder,       "sessionSortOrder",      1, SORT_ORDER_ALPHA, SORT_ORDER_DATE, CFG_API_PUT);
+CFG_STR (kCurrentSession,         "currentSession",        "Default",          MAX_PATH, 0);
+CFG_STR (kPreviousSession,        "previousSession",       "Default",          MAX_PATH, 0);
+CFG_STR (kDefaultSession,         "defaultSession",        "Default",          MAX_PATH, 0);
+CFG_STR (kMenuLabelMain,          "menuLabelMain",         "&Session Manager", MAX_PATH, CFG_API_PUT);
+CFG_STR (kMenuLabelSub1,          "menuLabelSub1",         "&Sessions...",     MAX_PATH, CFG_API_PUT);
+CFG_STR (kMenuLabelSub2,          "menuLabelSub2",         "Se&ttings...",     MAX_PATH, CFG_API_PUT);
+CFG_STR (kMenuLabelSub3,          "menuLabelSub3",         "Sa&ve current",    MAX_PATH, CFG_API_PUT);
+CFG_STR (kMenuLabelSub4,          "menuLabelSub4",         "Load &previous",   MAX_PATH, CFG_API_PUT);
+CFG_STR (kMenuLabelSub5,          "menuLabelSub5",         "&Help",            MAX_PATH, CFG_API_PUT);
+CFG_STR (kMenuLabelSub6,          "menuLabelSub6",         "&About...",        MAX_PATH, CFG_API_PUT);
+CFG_INT (kSessionsDialogWidth,    "sessionsDialogWidth",   0, 0, 0x7FFF, CFG_VOLATILE);
+CFG_INT (kSessionsDialogHeight,   "sessionsDialogHeight",  0, 0, 0x7FFF, CFG_VOLATILE);
+CFG_INT (kSettingsDialogWidth,    "settingsDialogWidth",   0, 0, 0x7FFF, CFG_VOLATILE);
+CFG_INT (kSettingsDialogHeight,   "settingsDialogHeight",  0, 0, 0x7FFF, CFG_VOLATILE);
+CFG_INT (kDebugLogLevel,          "debugLogLevel",         0, 0, 255, CFG_API_PUT);
+CFG_STR (kDebugLogFile,           "debugLogFile",          "",                 MAX_PATH, CFG_API_PUT);
+CFG_INT (kProgressiveLoad,        "progressiveLoad",       0, 0, 10000, CFG_API_PUT);
+CFG_INT (kProgressiveLoadBatch,   "progressiveLoadBatch",  20, 1, 10000, CFG_API_PUT);
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_SETTINGDEFS_H
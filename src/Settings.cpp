@@ -13,13 +13,28 @@
     @copyright Copyright 2014,2015 Michael Foster <http://mfoster.com/npp/>
 
     Implements management of configuration settings.
+
+    Each setting and container has a dirty flag. A change schedules a save
+    for when settings have been unchanged for kSettingsSavePoll seconds, so a
+    burst of changes results in one write. Volatile settings, such as dialog
+    sizes, change continuously while a dialog is being resized. They do not
+    schedule a save; the dialog saves them when it closes.
+
+    The document and the indexed Favorites and Filters lists are a core
+    SettingsStore and ItemLists. This file adds the setting schema, the
+    caches, the save timer and the Win32 file access.
 */
 
 #include "System.h"
 #include "SessionMgr.h"
 #include "Menu.h"
 #include "Util.h"
+#include "Timers.h"
+#include "Log.h"
+#include "Perf.h"
+#include "core\SettingsStore.h"
 #include <strsafe.h>
+#include <limits.h>
 #include <shlobj.h>
 
 //------------------------------------------------------------------------------
@@ -28,23 +43,34 @@ namespace NppPlugin {
 
 INT gDbgLvl = 0;
 
+namespace cfg {
+SettingCache gSettingCache[kSettingsCount];
+}
+
 //------------------------------------------------------------------------------
 
 namespace {
 
-/// Initial contents of a new settings.xml file
-#define INITIAL_CONTENTS "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<SessionMgr/>\n"
 /// XML node and attribute names
-#define XN_ROOT  "SessionMgr"
-#define XN_ITEM  "item"
-#define XA_VALUE "value"
+LPCSTR const XN_ROOT  = xmlIntern("SessionMgr");
+LPCSTR const XA_VALUE = xmlIntern("value");
 /// Defaults
 #define DEFAULT_SES_DIR  L"sessions\\"
 #define DEFAULT_SES_EXT  L".npp-session"
+/// Size of a buffer for the UTF-8 form of a MAX_PATH wide string
+#define MB_BUF_LEN (MAX_PATH * 3)
+
+/// Reads and writes settings.xml with the files locked.
+class NppSettingsPlatform : public SettingsPlatform
+{
+  public:
+    virtual bool readSettings(tXmlDoc &doc, bool *missing);
+    virtual bool writeSettings(tXmlDoc &doc);
+};
 
-tXmlDocP _xmlDocument = NULL;
+NppSettingsPlatform _platform;
+SettingsStore _store;
 WCHAR _tmpBuffer[MAX_PATH];
-bool _isDirty = false;
 
 /** These must be in the same order as the ContainerId enums. */
 LPCSTR _containerNames[] = {
@@ -54,66 +80,56 @@ LPCSTR _containerNames[] = {
 };
 
 tXmlEleP _containerElements[kContainersCount];
+/// Indexed by ContainerId. Not used for the Settings container.
+ItemList _lists[kContainersCount];
 
 typedef struct Setting_tag {
-    LPSTR    cName;
-    LPSTR    cDefault;
+    LPCSTR   cName;
+    LPCSTR   cDefault;
     bool     isInt;
-    INT      iCache;
-    LPWSTR   wCache;
+    INT      minValue;
+    INT      maxValue;
+    UINT     flags;
     tXmlEleP element;
-    INT      wCacheSize; // character size of the wCache buffer, 0 if isInt
+    INT      wCacheSize; // character size of the string cache buffer, 0 if isInt
+    bool     isDirty;
 } Setting;
 
-/** These must be in the same order as the SettingId enums. */
-Setting _settings[] = {
-    { "automaticSave",        "1",                true,  0, 0, 0, 0 },
-    { "automaticLoad",        "0",                true,  0, 0, 0, 0 },
-    { "loadIntoCurrent",      "0",                true,  0, 0, 0, 0 },
-    { "loadWithoutClosing",   "0",                true,  0, 0, 0, 0 },
-    { "showInTitlebar",       "0",                true,  0, 0, 0, 0 },
-    { "showInStatusbar",      "0",                true,  0, 0, 0, 0 },
-    { "useGlobalProperties",  "1",                true,  0, 0, 0, 0 },
-    { "cleanGlobalProperties","0",                true,  0, 0, 0, 0 },
-    { "useContextMenu",       "1",                true,  0, 0, 0, 0 },
-    { "backupOnStartup",      "1",                true,  0, 0, 0, 0 },
-    { "sessionSaveDelay",     "3",                true,  0, 0, 0, 0 },
-    { "settingsSavePoll",     "2",                true,  0, 0, 0, 0 },
-    { "sessionDirectory",     "",                 false, 0, 0, 0, MAX_PATH },
-    { "sessionExtension",     ".npp-session",     false, 0, 0, 0, MAX_PATH }, // 25 },
-    { "currentMark",          "9674",             true,  0, 0, 0, 0 },
-    { "currentFavMark",       "9830",             true,  0, 0, 0, 0 },
-    { "previousMark",         "9702",             true,  0, 0, 0, 0 },
-    { "previousFavMark",      "8226",             true,  0, 0, 0, 0 },
-    { "defaultMark",          "9653",             true,  0, 0, 0, 0 },
-    { "defaultFavMark",       "9652",             true,  0, 0, 0, 0 },
-    { "favoriteMark",         "183",              true,  0, 0, 0, 0 },
-    { "useFilterWildcards",   "0",                true,  0, 0, 0, 0 },
-    { "sessionSortOrder",     "1",                true,  0, 0, 0, 0 },
-    { "currentSession",       "Default",          false, 0, 0, 0, MAX_PATH }, // SES_NAME_BUF_LEN },
-    { "previousSession",      "Default",          false, 0, 0, 0, MAX_PATH }, // SES_NAME_BUF_LEN },
-    { "defaultSession",       "Default",          false, 0, 0, 0, MAX_PATH }, // SES_NAME_BUF_LEN },
-    { "menuLabelMain",        "&Session Manager", false, 0, 0, 0, MAX_PATH }, // MNU_MAX_NAME_LEN + 1 },
-    { "menuLabelSub1",        "&Sessions...",     false, 0, 0, 0, MAX_PATH }, // MNU_MAX_NAME_LEN + 1 },
-    { "menuLabelSub2",        "Se&ttings...",     false, 0, 0, 0, MAX_PATH }, // MNU_MAX_NAME_LEN + 1 },
-    { "menuLabelSub3",        "Sa&ve current",    false, 0, 0, 0, MAX_PATH }, // MNU_MAX_NAME_LEN + 1 },
-    { "menuLabelSub4",        "Load &previous",   false, 0, 0, 0, MAX_PATH }, // MNU_MAX_NAME_LEN + 1 },
-    { "menuLabelSub5",        "&Help",            false, 0, 0, 0, MAX_PATH }, // MNU_MAX_NAME_LEN + 1 },
-    { "menuLabelSub6",        "&About...",        false, 0, 0, 0, MAX_PATH }, // MNU_MAX_NAME_LEN + 1 },
-    { "sessionsDialogWidth",  "0",                true,  0, 0, 0, 0 },
-    { "sessionsDialogHeight", "0",                true,  0, 0, 0, 0 },
-    { "settingsDialogWidth",  "0",                true,  0, 0, 0, 0 },
-    { "settingsDialogHeight", "0",                true,  0, 0, 0, 0 },
-    { "debugLogLevel",        "0",                true,  0, 0, 0, 0 },
-    { "debugLogFile",         "",                 false, 0, 0, 0, MAX_PATH }
+/// Indexed by SettingId, filled from the SettingDefs by SchemaRow
+Setting _settings[kSettingsCount];
+
+/** Copies the schema of setting id, then of every following setting, to
+    _settings. Stops at kSettingsCount. */
+template<INT id> struct SchemaRow {
+    static void fill()
+    {
+        typedef SettingDef<id> Def;
+        Setting *s = &_settings[id];
+        s->cName = Def::name();
+        s->cDefault = Def::defaultValue();
+        s->isInt = Def::isInt != 0;
+        s->minValue = Def::minValue;
+        s->maxValue = Def::maxValue;
+        s->flags = Def::flags;
+        s->wCacheSize = Def::bufLen;
+        SchemaRow<id + 1>::fill();
+    }
+};
+
+template<> struct SchemaRow<kSettingsCount> {
+    static void fill() {}
 };
 
-bool readSettingsFile();
 void initContainers();
 void initSettings();
-void updateCache(Setting *setting);
+bool parseInt(LPCSTR value, INT *num);
+void updateCache(INT cfgId);
 void afterLoad();
 void upgradeIniToXml();
+bool isVolatile(SettingId cfgId);
+void setDirty(SettingId cfgId);
+void scheduleSave();
+void onSaveTimer();
 
 } // end namespace
 
@@ -125,21 +141,20 @@ void cfg_onUnload()
 {
     INT i;
 
-    if (_isDirty) {
+    if (cfg::isDirty(true)) {
         cfg::saveSettings();
     }
     for (i = 0; i < kSettingsCount; ++i) {
-        if (!_settings[i].isInt && _settings[i].wCache) {
-            sys_free(_settings[i].wCache);
+        if (!_settings[i].isInt && cfg::gSettingCache[i].w) {
+            sys_free(cfg::gSettingCache[i].w);
+            cfg::gSettingCache[i].w = NULL;
         }
     }
     for (i = 0; i < kContainersCount; ++i) {
         _containerElements[i] = NULL;
+        _lists[i].attach(NULL);
     }
-    if (_xmlDocument) {
-        delete _xmlDocument;
-        _xmlDocument = NULL;
-    }
+    _store.clear();
 }
 
 } // end namespace NppPlugin::api
@@ -150,37 +165,70 @@ namespace cfg {
 
 void loadSettings()
 {
-    if (readSettingsFile()) {
+    bool loaded;
+
+    PRF_TRACE("xml parse settings.xml", loaded = _store.load(_platform, XN_ROOT));
+    if (loaded) {
         initContainers();
         initSettings();
         afterLoad();
-        if (_isDirty) {
+        if (_store.isDirty()) {
             saveSettings();
         }
     }
 }
 
+/** Writes the settings file now and clears all dirty flags. */
 void saveSettings()
 {
-    DWORD lastErr;
-    tXmlError xmlErr;
-
-    if (_xmlDocument) {
-        xmlErr = _xmlDocument->SaveFile(sys_getSettingsFile());
-        if (xmlErr != kXmlSuccess) {
-            lastErr = ::GetLastError();
-            msg::error(lastErr, L"%s: Error %u saving the settings file.", _W(__FUNCTION__), xmlErr);
-        }
-        else {
-            _isDirty = false;
+    INT i;
+    bool saved;
+    TraceScope trc("cfg::saveSettings");
+
+    if (_store.isLoaded()) {
+        tmr::cancel(kTimerSettings);
+        PRF_TRACE("xml write settings.xml", saved = _store.save(_platform));
+        if (saved) {
+            for (i = 0; i < kSettingsCount; ++i) {
+                _settings[i].isDirty = false;
+            }
+            for (i = 0; i < kContainersCount; ++i) {
+                _lists[i].clearDirty();
+            }
             LOG("Settings saved.");
         }
     }
 }
 
-bool isDirty()
+/** Saves settings if any have changed, including volatile settings. Dialogs
+    call this when they close. */
+void saveIfDirty()
+{
+    if (isDirty(true)) {
+        saveSettings();
+    }
+}
+
+/** @return true if any setting or container has changed since the last save.
+    Volatile settings are only considered if includeVolatile is true. */
+bool isDirty(bool includeVolatile)
 {
-    return _isDirty;
+    INT i;
+
+    if (_store.isDirty()) {
+        return true;
+    }
+    for (i = 0; i < kContainersCount; ++i) {
+        if (_lists[i].isDirty()) {
+            return true;
+        }
+    }
+    for (i = 0; i < kSettingsCount; ++i) {
+        if (_settings[i].isDirty && (includeVolatile || !isVolatile((SettingId)i))) {
+            return true;
+        }
+    }
+    return false;
 }
 
 //------------------------------------------------------------------------------
@@ -189,44 +237,44 @@ bool isDirty()
 /** @return a pointer to the value of the cfgId element of the Settings container. */
 LPCWSTR getStr(SettingId cfgId)
 {
-    return _settings[cfgId].wCache;
+    return gSettingCache[cfgId].w;
 }
 
 /** Copies to buf the value of the cfgId element of the Settings container. */
 void getStr(SettingId cfgId, LPWSTR buf, INT bufLen)
 {
-    ::StringCchCopyW(buf, bufLen, _settings[cfgId].wCache);
+    ::StringCchCopyW(buf, bufLen, gSettingCache[cfgId].w);
 }
 
 /** @return the boolean value of the cfgId element of the Settings container. */
 bool getBool(SettingId cfgId)
 {
-    return _settings[cfgId].iCache != 0;
+    return gSettingCache[cfgId].i != 0;
 }
 
 /** @return the integer value of the cfgId element of the Settings container. */
 INT getInt(SettingId cfgId)
 {
-    return _settings[cfgId].iCache;
+    return gSettingCache[cfgId].i;
 }
 
-/** Copies value to the cfgId element of the Settings container. */
+/** Copies value to the cfgId element of the Settings container. Does nothing
+    if the value is unchanged. */
 void putStr(SettingId cfgId, LPCSTR value)
 {
-    if (value && *value) {
+    if (value && *value && !_settings[cfgId].element->Attribute(XA_VALUE, value)) {
         _settings[cfgId].element->SetAttribute(XA_VALUE, value);
-        updateCache(&_settings[cfgId]);
-        _isDirty = true;
+        updateCache(cfgId);
+        setDirty(cfgId);
     }
 }
 
 /** Copies value to the cfgId element of the Settings container. */
 void putStr(SettingId cfgId, LPCWSTR value)
 {
-    LPSTR mbValue = str::utf16ToUtf8(value);
-    if (mbValue) {
+    CHAR mbValue[MB_BUF_LEN];
+    if (str::utf16ToUtf8(value, mbValue, MB_BUF_LEN)) {
         putStr(cfgId, mbValue);
-        sys_free(mbValue);
     }
 }
 
@@ -244,6 +292,24 @@ void putInt(SettingId cfgId, INT value)
     putStr(cfgId, buf);
 }
 
+/** @return true if cfgId is a valid integer setting */
+bool isIntSetting(SettingId cfgId)
+{
+    return cfgId >= 0 && cfgId < kSettingsCount && _settings[cfgId].isInt;
+}
+
+/** @return true if cfgId is a valid setting that other plugins may change */
+bool isApiWritable(SettingId cfgId)
+{
+    return cfgId >= 0 && cfgId < kSettingsCount && (_settings[cfgId].flags & CFG_API_PUT) != 0;
+}
+
+/** @return true if value is in the range of integer setting cfgId */
+bool isInRange(SettingId cfgId, INT value)
+{
+    return value >= _settings[cfgId].minValue && value <= _settings[cfgId].maxValue;
+}
+
 //------------------------------------------------------------------------------
 // Functions that read or write child elements of any container.
 
@@ -251,15 +317,10 @@ void putInt(SettingId cfgId, INT value)
     conId container, or NULL if the element doesn't exist. */
 LPCSTR getCStr(ContainerId conId, INT childIndex)
 {
-    tXmlEleP childEle;
-    childEle = _containerElements[conId]->FirstChildElement();
-    while (childEle && childIndex-- > 0) {
-        childEle = childEle->NextSiblingElement();
-    }
-    if (childEle) {
-        return childEle->Attribute(XA_VALUE);
+    if (conId == kSettings) {
+        return NULL;
     }
-    return NULL;
+    return _lists[conId].value(childIndex);
 }
 
 /** @return a pointer to the value of the 0-based childIndex'th element of the
@@ -289,16 +350,10 @@ bool getStr(ContainerId conId, INT childIndex, LPWSTR buf, INT bufLen)
 /** @return a pointer to the first child of conId with value, else NULL */
 tXmlEleP getChild(ContainerId conId, LPCSTR value)
 {
-    if (value && *value) {
-        tXmlEleP childEle = _containerElements[conId]->FirstChildElement();
-        while (childEle) {
-            if (childEle->Attribute(XA_VALUE, value)) {
-                return childEle;
-            }
-            childEle = childEle->NextSiblingElement();
-        }
+    if (conId == kSettings) {
+        return NULL;
     }
-    return NULL;
+    return _lists[conId].find(value);
 }
 
 /** Adds a new element to the conId container and copies value to it. Appends
@@ -306,19 +361,11 @@ tXmlEleP getChild(ContainerId conId, LPCSTR value)
     value is null or empty, or a child with value already exists. */
 void addChild(ContainerId conId, LPCWSTR value, bool append)
 {
+    CHAR mbValue[MB_BUF_LEN];
+
     if (conId != kSettings && value && *value) {
-        LPSTR mbValue = str::utf16ToUtf8(value);
-        if (mbValue && !getChild(conId, mbValue)) {
-            tXmlEleP cfgEle = _xmlDocument->NewElement(XN_ITEM);
-            cfgEle->SetAttribute(XA_VALUE, mbValue);
-            if (append) {
-                _containerElements[conId]->InsertEndChild(cfgEle);
-            }
-            else {
-                _containerElements[conId]->InsertFirstChild(cfgEle);
-            }
-            sys_free(mbValue);
-            _isDirty = true;
+        if (str::utf16ToUtf8(value, mbValue, MB_BUF_LEN) && _lists[conId].add(mbValue, append)) {
+            scheduleSave();
         }
     }
 }
@@ -329,20 +376,12 @@ void addChild(ContainerId conId, LPCWSTR value, bool append)
     @return true if any change was made, else false */
 bool moveToTop(ContainerId conId, LPCWSTR value)
 {
+    CHAR mbValue[MB_BUF_LEN];
+
     if (conId != kSettings && value && *value) {
-        LPSTR mbValue = str::utf16ToUtf8(value);
-        if (mbValue) {
-            tXmlEleP childEle = getChild(conId, mbValue);
-            sys_free(mbValue);
-            if (!childEle) { // not found so add it at the top
-                addChild(conId, value, false);
-                return true;
-            }
-            if (childEle->PreviousSiblingElement()) { // found and not at top so move it to the top
-                _containerElements[conId]->InsertFirstChild(childEle);
-                _isDirty = true;
-                return true;
-            }
+        if (str::utf16ToUtf8(value, mbValue, MB_BUF_LEN) && _lists[conId].moveToTop(mbValue)) {
+            scheduleSave();
+            return true;
         }
     }
     return false;
@@ -353,8 +392,8 @@ bool moveToTop(ContainerId conId, LPCWSTR value)
 void deleteChildren(ContainerId conId)
 {
     if (conId != kSettings) {
-        _containerElements[conId]->DeleteChildren();
-        _isDirty = true;
+        _lists[conId].clear();
+        scheduleSave();
     }
 }
 
@@ -435,18 +474,13 @@ void getMarkStr(SettingId cfgId, LPWSTR buf)
 
 bool isSortAlpha()
 {
-    return getInt(kSessionSortOrder) == SORT_ORDER_ALPHA;
+    return get<kSessionSortOrder>() == SORT_ORDER_ALPHA;
 }
 
 bool isFavorite(LPCWSTR fav)
 {
-    bool isFav = false;
-    LPSTR mbFav = str::utf16ToUtf8(fav);
-    if (mbFav) {
-        isFav = getChild(kFavorites, mbFav) != NULL;
-        sys_free(mbFav);
-    }
-    return isFav;
+    CHAR mbFav[MB_BUF_LEN];
+    return str::utf16ToUtf8(fav, mbFav, MB_BUF_LEN) && getChild(kFavorites, mbFav) != NULL;
 }
 
 } // end namespace NppPlugin::cfg
@@ -455,48 +489,54 @@ bool isFavorite(LPCWSTR fav)
 
 namespace {
 
-/** Loads the settings.xml file if it has not already been loaded. Creates it if
-    it doesn't exist. */
-bool readSettingsFile()
+/** Loads settings.xml, unless it doesn't exist. */
+bool NppSettingsPlatform::readSettings(tXmlDoc &doc, bool *missing)
 {
     DWORD lastErr;
     tXmlError xmlErr;
-    LPCWSTR settingsFile;
+    LPCWSTR settingsFile = sys_getSettingsFile();
 
-    if (!_xmlDocument) {
-        settingsFile = sys_getSettingsFile();
-        if (!pth::fileExists(settingsFile)) {
-            pth::createFileIfMissing(settingsFile, INITIAL_CONTENTS);
-            _isDirty = true;
-        }
-        _xmlDocument = new tinyxml2::XMLDocument();
-        xmlErr = _xmlDocument->LoadFile(settingsFile);
-        if (xmlErr != kXmlSuccess) {
-            lastErr = ::GetLastError();
-            msg::error(lastErr, L"%s: Error %u loading the settings file.", _W(__FUNCTION__), xmlErr);
-            return false;
-        }
+    if (!pth::fileExists(settingsFile)) {
+        *missing = true;
+        return true;
+    }
+    xmlErr = doc.LoadFile(settingsFile);
+    if (xmlErr != kXmlSuccess) {
+        lastErr = ::GetLastError();
+        msg::error(lastErr, L"%s: Error %u loading the settings file.", _W(__FUNCTION__), xmlErr);
+        return false;
     }
+    return true;
+}
 
+/** Writes settings.xml with the files locked. */
+bool NppSettingsPlatform::writeSettings(tXmlDoc &doc)
+{
+    DWORD lastErr;
+    tXmlError xmlErr;
+
+    sys_lockFiles();
+    xmlErr = doc.SaveFile(sys_getSettingsFile());
+    sys_unlockFiles();
+    if (xmlErr != kXmlSuccess) {
+        lastErr = ::GetLastError();
+        msg::error(lastErr, L"%s: Error %u saving the settings file.", _W(__FUNCTION__), xmlErr);
+        return false;
+    }
     return true;
 }
 
 /** Initializes the _containerElements array with pointers to the ContainerId
-    elements. Creates missing elements. */
+    elements, and attaches the lists. Creates missing elements. */
 void initContainers()
 {
     INT conId;
-    tXmlEleP conEle, rootEle;
 
-    rootEle = _xmlDocument->FirstChildElement(XN_ROOT);
     for (conId = 0; conId < kContainersCount; ++conId) {
-        conEle = rootEle->FirstChildElement(_containerNames[conId]);
-        if (!conEle) {
-            conEle = _xmlDocument->NewElement(_containerNames[conId]);
-            rootEle->InsertEndChild(conEle);
-            _isDirty = true;
+        _containerElements[conId] = _store.container(_containerNames[conId]);
+        if (conId != kSettings) {
+            _lists[conId].attach(_containerElements[conId]);
         }
-        _containerElements[conId] = conEle;
     }
 }
 
@@ -506,11 +546,12 @@ void initSettings()
     INT cfgId;
     tXmlEleP settingsEle, cfgEle, prvCfgEle = NULL;
 
+    SchemaRow<0>::fill();
     settingsEle = _containerElements[kSettings];
     for (cfgId = 0; cfgId < kSettingsCount; ++cfgId) {
         cfgEle = settingsEle->FirstChildElement(_settings[cfgId].cName);
         if (!cfgEle) {
-            cfgEle = _xmlDocument->NewElement(_settings[cfgId].cName);
+            cfgEle = _store.document()->NewElement(_settings[cfgId].cName);
             cfgEle->SetAttribute(XA_VALUE, _settings[cfgId].cDefault);
             if (prvCfgEle) {
                 settingsEle->InsertAfterChild(prvCfgEle, cfgEle);
@@ -518,41 +559,90 @@ void initSettings()
             else {
                 settingsEle->InsertEndChild(cfgEle);
             }
-            _isDirty = true;
+            _store.setDirty();
         }
         if (!_settings[cfgId].isInt) {
-            _settings[cfgId].wCache = (LPWSTR)sys_alloc(_settings[cfgId].wCacheSize * sizeof WCHAR);
-            _settings[cfgId].wCache[0] = 0;
+            cfg::gSettingCache[cfgId].w = (LPWSTR)sys_alloc(_settings[cfgId].wCacheSize * sizeof WCHAR);
+            cfg::gSettingCache[cfgId].w[0] = 0;
         }
         prvCfgEle = cfgEle;
         _settings[cfgId].element = cfgEle;
-        updateCache(&_settings[cfgId]);
+        updateCache(cfgId);
     }
 }
 
-/** Refreshes the cached value of the given setting. */
-void updateCache(Setting *setting)
+/** Refreshes the cached value of the given setting. Integer values are
+    limited to the setting's range, in case the file was edited by hand, and
+    a value that is not a number is replaced by the default. */
+void updateCache(INT cfgId)
 {
+    INT num;
+    Setting *setting = &_settings[cfgId];
+    cfg::SettingCache *cache = &cfg::gSettingCache[cfgId];
     LPCSTR value = setting->element->Attribute(XA_VALUE);
+
     if (!value || !*value) {
         value = setting->cDefault;
     }
     if (setting->isInt) {
-        setting->iCache = ::atoi(value);
+        if (!parseInt(value, &num)) {
+            parseInt(setting->cDefault, &num);
+        }
+        cache->i = max(setting->minValue, min(setting->maxValue, num));
     }
     else {
-         str::utf8ToUtf16(value, setting->wCache, setting->wCacheSize);
+        str::utf8ToUtf16(value, cache->w, setting->wCacheSize);
     }
 }
 
+/** @return true if value is a decimal integer with nothing after it, and
+    puts it in num. Out-of-range values saturate, to be clamped by the caller. */
+bool parseInt(LPCSTR value, INT *num)
+{
+    LPSTR end;
+    long n = ::strtol(value, &end, 10);
+
+    if (end == value || *end) {
+        return false;
+    }
+    *num = n > INT_MAX ? INT_MAX : n < INT_MIN ? INT_MIN : (INT)n;
+    return true;
+}
+
 /** Things that may need to be done after the configuration is loaded and initialized. */
 void afterLoad()
 {
-    if (!*cfg::getStr(kSessionDirectory)) { // If needed, set default session directory.
+    if (!*cfg::get<kSessionDirectory>()) { // If needed, set default session directory.
         cfg::setSessionDirectory(NULL, false);
     }
     cfg::addChild(kFilters, L"*"); // Add "*" filter if it doesn't already exist.
-    gDbgLvl = cfg::getInt(kDebugLogLevel); // Use a global for fastest access.
+    gDbgLvl = cfg::get<kDebugLogLevel>(); // Use a global for fastest access.
+    lgr::setFile(cfg::get<kDebugLogFile>());
+}
+
+/** @return true if cfgId changes too often to be saved on every change */
+bool isVolatile(SettingId cfgId)
+{
+    return (_settings[cfgId].flags & CFG_VOLATILE) != 0;
+}
+
+void setDirty(SettingId cfgId)
+{
+    _settings[cfgId].isDirty = true;
+    if (!isVolatile(cfgId)) {
+        scheduleSave();
+    }
+}
+
+/** Sets or moves the save timer to kSettingsSavePoll seconds from now. */
+void scheduleSave()
+{
+    tmr::set(kTimerSettings, cfg::get<kSettingsSavePoll>() * 1000, onSaveTimer);
+}
+
+void onSaveTimer()
+{
+    cfg::saveIfDirty();
 }
 
 } // end namespace
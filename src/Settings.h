@@ -17,6 +17,7 @@
 #define NPP_PLUGIN_SETTINGS_H
 
 #include "SessionMgrApi.h"
+#include "SettingDefs.h"
 #include "xml\tinyxml.h"
 
 //------------------------------------------------------------------------------
@@ -32,10 +33,8 @@ enum ContainerId {
     kContainersCount
 };
 
-// See SessionMgrApi.h for enum SettingId
+// See SessionMgrApi.h for enum SettingId, SettingDefs.h for their schema
 
-#define SORT_ORDER_ALPHA 1
-#define SORT_ORDER_DATE  2
 #define FILTER_BUF_LEN  50
 #define FILTERS_MAX    100
 
@@ -53,9 +52,41 @@ void cfg_onUnload();
 
 namespace cfg {
 
+/// Cached value of a setting. Read it with get.
+typedef struct SettingCache_tag {
+    INT    i; ///< value of an integer or boolean setting
+    LPWSTR w; ///< value of a string setting
+} SettingCache;
+
+/// Indexed by SettingId, refreshed whenever a setting changes
+extern SettingCache gSettingCache[kSettingsCount];
+
+/** Reads a cached value as type T. */
+template<typename T> struct CacheReader;
+
+template<> struct CacheReader<INT> {
+    static INT read(INT cfgId) { return gSettingCache[cfgId].i; }
+};
+
+template<> struct CacheReader<bool> {
+    static bool read(INT cfgId) { return gSettingCache[cfgId].i != 0; }
+};
+
+template<> struct CacheReader<LPCWSTR> {
+    static LPCWSTR read(INT cfgId) { return gSettingCache[cfgId].w; }
+};
+
+/** @return the value of setting id, typed by its SettingDef. Use this when
+    the id is known at compile time, and getStr/getBool/getInt when it is not. */
+template<SettingId id> inline typename SettingDef<id>::ValueType get()
+{
+    return CacheReader<typename SettingDef<id>::ValueType>::read(id);
+}
+
 void loadSettings();
 void saveSettings();
-bool isDirty();
+void saveIfDirty();
+bool isDirty(bool includeVolatile = false);
 
 // Functions that read or write child elements of the Settings container.
 LPCWSTR getStr(SettingId cfgId);
@@ -66,6 +97,9 @@ void putStr(SettingId cfgId, LPCSTR value);
 void putStr(SettingId cfgId, LPCWSTR value);
 void putBool(SettingId cfgId, bool value);
 void putInt(SettingId cfgId, INT value);
+bool isIntSetting(SettingId cfgId);
+bool isApiWritable(SettingId cfgId);
+bool isInRange(SettingId cfgId, INT value);
 
 // Functions that read or write child elements of any container.
 LPCSTR getCStr(ContainerId conId, INT childIndex);
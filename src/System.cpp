@@ -16,6 +16,8 @@
 #include "System.h"
 #include "SessionMgr.h"
 #include "Util.h"
+#include "Tasks.h"
+#include "Perf.h"
 #include <strsafe.h>
 //#include <shlobj.h> // for findNppCtxMnuFile
 
@@ -46,11 +48,14 @@ LPWSTR _cfgDir;  ///< SessionMgr's config directory, includes trailing slash
 LPWSTR _cfgFile; ///< pathname of settings.xml
 LPWSTR _glbFile; ///< pathname of global.xml
 LPWSTR _ctxFile; ///< pathname of NPP's contextMenu.xml file
+WCHAR _bakSesDir[MAX_PATH]; ///< session directory at the time the backup was queued
+CRITICAL_SECTION _fileLock; ///< serializes access to config and session files
 
 //void findNppCtxMnuFile();
-void backupFiles();
+void backupFiles(LPVOID arg);
 void backupConfigFiles(LPCWSTR backupDir);
 void backupSessionFiles(LPCWSTR backupDir);
+void backupFile(LPCWSTR srcFile, LPCWSTR dstFile);
 
 } // end namespace
 
@@ -61,6 +66,7 @@ namespace api {
 void sys_onLoad(HINSTANCE hDLLInstance)
 {
     _hDll = hDLLInstance;
+    ::InitializeCriticalSection(&_fileLock);
 }
 
 void sys_onUnload()
@@ -69,6 +75,7 @@ void sys_onUnload()
     sys_free(_glbFile);
     sys_free(_cfgFile);
     sys_free(_cfgDir);
+    ::DeleteCriticalSection(&_fileLock);
 }
 
 void sys_init(NppData nppd)
@@ -108,7 +115,7 @@ void sys_init(NppData nppd)
     ::StringCchCatW(_cfgFile, MAX_PATH, CFG_FILE_NAME);
     cfg::loadSettings();
     // Create sessions directory if missing.
-    ::CreateDirectoryW(cfg::getStr(kSessionDirectory), NULL);
+    ::CreateDirectoryW(cfg::get<kSessionDirectory>(), NULL);
     // Create default session file if missing.
     app_confirmDefaultSession();
 
@@ -116,9 +123,12 @@ void sys_init(NppData nppd)
     LPWSTR p = ::wcsstr(_ctxFile, L"plugins\\Config");
     ::StringCchCopyW(p, MAX_PATH, CTX_FILE_NAME);
 
-    // Backup existing config and session files.
-    if (cfg::getBool(kBackupOnStartup)) {
-        backupFiles();
+    // Backup existing config and session files after NPP is ready. This is
+    // the first task, and the startup session load waits for it since the
+    // load rewrites its session file.
+    if (cfg::get<kBackupOnStartup>()) {
+        ::StringCchCopyW(_bakSesDir, MAX_PATH, cfg::get<kSessionDirectory>());
+        tsk::add(SYS_TASK_BACKUP, backupFiles, NULL, kTaskHigh);
     }
 }
 
@@ -178,6 +188,7 @@ UINT sys_getWinVer()
 
 LPVOID sys_alloc(INT bytes)
 {
+    prf::increment(kCountHeapAllocs);
     LPVOID p = ::HeapAlloc(_hHeap, HEAP_ZERO_MEMORY, bytes);
     if (p == NULL) {
         LOG("Error allocating %u bytes.", bytes);
@@ -191,6 +202,18 @@ void sys_free(LPVOID p)
     if (p) ::HeapFree(_hHeap, 0, p);
 }
 
+/** Must be called before reading or writing config or session files from any
+    code that may run concurrently with a background task. Calls may be nested. */
+void sys_lockFiles()
+{
+    ::EnterCriticalSection(&_fileLock);
+}
+
+void sys_unlockFiles()
+{
+    ::LeaveCriticalSection(&_fileLock);
+}
+
 //------------------------------------------------------------------------------
 
 namespace {
@@ -250,7 +273,10 @@ void findNppCtxMnuFile()
 }
 */
 
-void backupFiles()
+/** Copies the config and session files to the backup directory. Only files
+    that changed since they were last backed up are copied. Runs as a
+    background task. */
+void backupFiles(LPVOID arg)
 {
     WCHAR backupDir[MAX_PATH];
 
@@ -280,23 +306,17 @@ void backupConfigFiles(LPCWSTR backupDir)
     WCHAR dstFile[MAX_PATH];
 
     // Copy settings.xml
-    if (pth::fileExists(_cfgFile)) {
-        ::StringCchCopyW(dstFile, MAX_PATH, backupDir);
-        ::StringCchCatW(dstFile, MAX_PATH, CFG_FILE_NAME);
-        ::CopyFileW(_cfgFile, dstFile, FALSE);
-    }
+    ::StringCchCopyW(dstFile, MAX_PATH, backupDir);
+    ::StringCchCatW(dstFile, MAX_PATH, CFG_FILE_NAME);
+    backupFile(_cfgFile, dstFile);
     // Copy global.xml
-    if (pth::fileExists(_glbFile)) {
-        ::StringCchCopyW(dstFile, MAX_PATH, backupDir);
-        ::StringCchCatW(dstFile, MAX_PATH, GLB_FILE_NAME);
-        ::CopyFileW(_glbFile, dstFile, FALSE);
-    }
+    ::StringCchCopyW(dstFile, MAX_PATH, backupDir);
+    ::StringCchCatW(dstFile, MAX_PATH, GLB_FILE_NAME);
+    backupFile(_glbFile, dstFile);
     // Copy NPP's contextMenu.xml
-    if (pth::fileExists(_ctxFile)) {
-        ::StringCchCopyW(dstFile, MAX_PATH, backupDir);
-        ::StringCchCatW(dstFile, MAX_PATH, CTX_FILE_NAME);
-        ::CopyFileW(_ctxFile, dstFile, FALSE);
-    }
+    ::StringCchCopyW(dstFile, MAX_PATH, backupDir);
+    ::StringCchCatW(dstFile, MAX_PATH, CTX_FILE_NAME);
+    backupFile(_ctxFile, dstFile);
 }
 
 void backupSessionFiles(LPCWSTR backupDir)
@@ -308,7 +328,7 @@ void backupSessionFiles(LPCWSTR backupDir)
     WCHAR dstFile[MAX_PATH];
 
     // Create the file spec.
-    ::StringCchCopyW(fileSpec, MAX_PATH, cfg::getStr(kSessionDirectory));
+    ::StringCchCopyW(fileSpec, MAX_PATH, _bakSesDir);
     ::StringCchCatW(fileSpec, MAX_PATH, L"*.*");
     // Loop over files in the session directory and copy them to the backup directory.
     hFind = ::FindFirstFileW(fileSpec, &ffd);
@@ -316,16 +336,42 @@ void backupSessionFiles(LPCWSTR backupDir)
         return;
     }
     do {
-        ::StringCchCopyW(srcFile, MAX_PATH, cfg::getStr(kSessionDirectory));
+        if (tsk::isCancelled()) {
+            break;
+        }
+        if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+        ::StringCchCopyW(srcFile, MAX_PATH, _bakSesDir);
         ::StringCchCatW(srcFile, MAX_PATH, ffd.cFileName);
         ::StringCchCopyW(dstFile, MAX_PATH, backupDir);
         ::StringCchCatW(dstFile, MAX_PATH, ffd.cFileName);
-        ::CopyFileW(srcFile, dstFile, FALSE);
+        backupFile(srcFile, dstFile);
     }
     while (::FindNextFileW(hFind, &ffd) != 0);
     ::FindClose(hFind);
 }
 
+/** Copies srcFile to dstFile unless dstFile has the same size and last write
+    time, which CopyFileW preserves. Holds the file lock only while copying. */
+void backupFile(LPCWSTR srcFile, LPCWSTR dstFile)
+{
+    WIN32_FILE_ATTRIBUTE_DATA src, dst;
+
+    if (!::GetFileAttributesExW(srcFile, GetFileExInfoStandard, &src)) {
+        return;
+    }
+    if (::GetFileAttributesExW(dstFile, GetFileExInfoStandard, &dst) &&
+        ::CompareFileTime(&src.ftLastWriteTime, &dst.ftLastWriteTime) == 0 &&
+        src.nFileSizeLow == dst.nFileSizeLow && src.nFileSizeHigh == dst.nFileSizeHigh
+    ) {
+        return;
+    }
+    sys_lockFiles();
+    ::CopyFileW(srcFile, dstFile, FALSE);
+    sys_unlockFiles();
+}
+
 } // end namespace
 
 } // end namespace NppPlugin
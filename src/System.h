@@ -17,6 +17,7 @@
 #define NPP_PLUGIN_SYSTEM_H
 
 #define SES_DEFAULT_CONTENTS "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<NotepadPlus><Session activeView=\"0\"><mainView activeIndex=\"0\"></mainView></Session></NotepadPlus>\n"
+#define SYS_TASK_BACKUP "backup" ///< name of the startup backup task
 
 #include <windows.h>
 #include "npp\PluginInterface.h"
@@ -49,6 +50,8 @@ DWORD sys_getNppVer();
 UINT sys_getWinVer();
 LPVOID sys_alloc(INT bytes);
 void sys_free(LPVOID p);
+void sys_lockFiles();
+void sys_unlockFiles();
 
 } // end namespace NppPlugin
 
@@ -0,0 +1,296 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Tasks.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Work that is not needed for the plugin to load, such as backing up files
+    and cleaning the global properties, is queued here and run on a worker
+    thread after Notepad++ is ready. Work that must finish before something
+    else, such as the backup before the startup session is loaded, waits for
+    its task with tsk::waitFor. Tasks must not call Notepad++ or create
+    windows. They should check tsk::isCancelled in any long-running loop, and
+    must call sys_lockFiles before reading or writing config or session files.
+*/
+
+#include "System.h"
+#include "SessionMgr.h"
+#include "Tasks.h"
+#include "Util.h"
+#include "Perf.h"
+#include <process.h>
+#include <vector>
+
+using std::vector;
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// How long stop will wait for a running task to notice it was cancelled
+#define STOP_TIMEOUT_MS 5000
+
+typedef struct Task_tag {
+    LPCSTR       name;
+    TaskProc     proc;
+    LPVOID       arg;
+    TaskPriority priority;
+    UINT         seq; ///< keeps tasks with the same priority in FIFO order
+} Task;
+
+vector<Task> _tasks;           ///< pending tasks, guarded by _queueLock
+CRITICAL_SECTION _queueLock;
+HANDLE _hThread = NULL;
+HANDLE _hWakeEvent = NULL;
+HANDLE _hDoneEvent = NULL;     ///< set each time a task finishes
+LPCSTR _runningName = NULL;    ///< name of the running task, guarded by _queueLock
+UINT _taskSeq = 0;
+volatile LONG _cancelled = 0;
+
+unsigned __stdcall workerProc(LPVOID arg);
+bool popTask(Task *task);
+bool isQueuedOrRunning(LPCSTR name);
+void runTask(const Task *task);
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+namespace api {
+
+void tsk_onLoad()
+{
+    ::InitializeCriticalSection(&_queueLock);
+}
+
+/** Called from DllMain so it must not wait for the worker thread. Normally
+    tsk::stop has already been called on NPPN_SHUTDOWN. */
+void tsk_onUnload()
+{
+    ::InterlockedExchange(&_cancelled, 1);
+    if (_hThread) {
+        ::CloseHandle(_hThread);
+        _hThread = NULL;
+    }
+    if (_hWakeEvent) {
+        ::CloseHandle(_hWakeEvent);
+        _hWakeEvent = NULL;
+    }
+    if (_hDoneEvent) {
+        ::CloseHandle(_hDoneEvent);
+        _hDoneEvent = NULL;
+    }
+    ::DeleteCriticalSection(&_queueLock);
+}
+
+} // end namespace NppPlugin::api
+
+//------------------------------------------------------------------------------
+
+namespace tsk {
+
+/** Creates the worker thread, which then runs all queued tasks in priority
+    order. Does nothing if the worker thread is already running. */
+void start()
+{
+    unsigned threadId;
+
+    if (_hThread) {
+        return;
+    }
+    ::InterlockedExchange(&_cancelled, 0);
+    _hWakeEvent = ::CreateEventW(NULL, FALSE, TRUE, NULL); // auto-reset, initially signaled
+    _hDoneEvent = ::CreateEventW(NULL, FALSE, FALSE, NULL); // auto-reset
+    if (!_hWakeEvent || !_hDoneEvent) {
+        LOG("Error %u creating the task events.", ::GetLastError());
+        if (_hWakeEvent) ::CloseHandle(_hWakeEvent);
+        if (_hDoneEvent) ::CloseHandle(_hDoneEvent);
+        _hWakeEvent = NULL;
+        _hDoneEvent = NULL;
+        return;
+    }
+    _hThread = (HANDLE)::_beginthreadex(NULL, 0, workerProc, NULL, 0, &threadId);
+    if (!_hThread) {
+        LOG("Error %u creating the worker thread.", errno);
+        ::CloseHandle(_hWakeEvent);
+        _hWakeEvent = NULL;
+        ::CloseHandle(_hDoneEvent);
+        _hDoneEvent = NULL;
+        return;
+    }
+    LOGG(10, "Worker thread %u started", threadId);
+}
+
+/** Cancels the running task, if any, discards pending tasks and waits for the
+    worker thread to exit.
+    @return false if the thread did not exit within STOP_TIMEOUT_MS, else true */
+bool stop()
+{
+    bool stopped = true;
+    size_t dropped = 0;
+
+    if (!_hThread) {
+        return true;
+    }
+    ::InterlockedExchange(&_cancelled, 1);
+    ::EnterCriticalSection(&_queueLock);
+    dropped = _tasks.size();
+    _tasks.clear();
+    ::LeaveCriticalSection(&_queueLock);
+    ::SetEvent(_hWakeEvent);
+    if (::WaitForSingleObject(_hThread, STOP_TIMEOUT_MS) != WAIT_OBJECT_0) {
+        LOG("Timed out waiting for the worker thread.");
+        stopped = false;
+    }
+    ::CloseHandle(_hThread);
+    _hThread = NULL;
+    ::CloseHandle(_hWakeEvent);
+    _hWakeEvent = NULL;
+    ::CloseHandle(_hDoneEvent);
+    _hDoneEvent = NULL;
+    LOGG(10, "Worker thread stopped, %u pending tasks discarded", dropped);
+    return stopped;
+}
+
+/** Queues a task. If the worker thread is running it is woken up.
+    @return false if the scheduler has been cancelled, else true */
+bool add(LPCSTR name, TaskProc proc, LPVOID arg, TaskPriority priority)
+{
+    Task task;
+
+    if (_hThread && isCancelled()) {
+        return false;
+    }
+    task.name = name;
+    task.proc = proc;
+    task.arg = arg;
+    task.priority = priority;
+    ::EnterCriticalSection(&_queueLock);
+    task.seq = _taskSeq++;
+    _tasks.push_back(task);
+    ::LeaveCriticalSection(&_queueLock);
+    LOGG(10, "Queued task \"%s\", priority %i", name, priority);
+    if (_hWakeEvent) {
+        ::SetEvent(_hWakeEvent);
+    }
+    return true;
+}
+
+/** @return true if tasks should stop as soon as possible */
+bool isCancelled()
+{
+    return _cancelled != 0;
+}
+
+/** Waits until no task with the given name is queued or running. Does not
+    wait if the worker thread has not been started.
+    @return false if such a task is still queued or running */
+bool waitFor(LPCSTR name, DWORD timeoutMs)
+{
+    DWORD t0, elapsed;
+
+    if (!_hThread) {
+        return !isQueuedOrRunning(name);
+    }
+    t0 = ::GetTickCount();
+    while (isQueuedOrRunning(name)) {
+        elapsed = ::GetTickCount() - t0;
+        if (elapsed >= timeoutMs || ::WaitForSingleObject(_hDoneEvent, timeoutMs - elapsed) == WAIT_TIMEOUT) {
+            LOG("Timed out waiting for task \"%s\".", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // end namespace NppPlugin::tsk
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+unsigned __stdcall workerProc(LPVOID arg)
+{
+    Task task;
+
+    while (!tsk::isCancelled()) {
+        while (!tsk::isCancelled() && popTask(&task)) {
+            runTask(&task);
+        }
+        if (!tsk::isCancelled()) {
+            ::WaitForSingleObject(_hWakeEvent, INFINITE);
+        }
+    }
+    return 0;
+}
+
+/** Removes the highest priority task from the queue and copies it to task.
+    @return false if the queue is empty */
+bool popTask(Task *task)
+{
+    bool found = false;
+
+    ::EnterCriticalSection(&_queueLock);
+    if (!_tasks.empty()) {
+        vector<Task>::iterator best = _tasks.begin();
+        for (vector<Task>::iterator it = _tasks.begin() + 1; it != _tasks.end(); ++it) {
+            if (it->priority < best->priority || (it->priority == best->priority && it->seq < best->seq)) {
+                best = it;
+            }
+        }
+        *task = *best;
+        _tasks.erase(best);
+        _runningName = task->name;
+        found = true;
+    }
+    ::LeaveCriticalSection(&_queueLock);
+    return found;
+}
+
+/** @return true if a task with the given name is queued or running */
+bool isQueuedOrRunning(LPCSTR name)
+{
+    bool found;
+
+    ::EnterCriticalSection(&_queueLock);
+    found = _runningName && ::strcmp(_runningName, name) == 0;
+    for (vector<Task>::const_iterator it = _tasks.begin(); !found && it != _tasks.end(); ++it) {
+        found = ::strcmp(it->name, name) == 0;
+    }
+    ::LeaveCriticalSection(&_queueLock);
+    return found;
+}
+
+/** Runs task and logs how long it took. */
+void runTask(const Task *task)
+{
+    LARGE_INTEGER freq, t0, t1;
+    TraceScope trc(task->name);
+
+    ::QueryPerformanceFrequency(&freq);
+    ::QueryPerformanceCounter(&t0);
+    task->proc(task->arg);
+    ::QueryPerformanceCounter(&t1);
+    ::EnterCriticalSection(&_queueLock);
+    _runningName = NULL;
+    ::LeaveCriticalSection(&_queueLock);
+    ::SetEvent(_hDoneEvent);
+    LOG("Task \"%s\" %s in %.3f ms", task->name, tsk::isCancelled() ? "cancelled" : "finished",
+        (double)(t1.QuadPart - t0.QuadPart) * 1000.0 / (double)freq.QuadPart);
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
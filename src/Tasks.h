@@ -0,0 +1,59 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Tasks.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#ifndef NPP_PLUGIN_TASKS_H
+#define NPP_PLUGIN_TASKS_H
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+/// Task priorities. Lower values run first.
+enum TaskPriority {
+    kTaskHigh = 0,
+    kTaskNormal,
+    kTaskLow
+};
+
+typedef void (*TaskProc)(LPVOID arg);
+
+//------------------------------------------------------------------------------
+/// @namespace NppPlugin::api Contains functions called only from DllMain.
+
+namespace api {
+
+void tsk_onLoad();
+void tsk_onUnload();
+
+} // end namespace NppPlugin::api
+
+//------------------------------------------------------------------------------
+/** @namespace NppPlugin::tsk Implements a background task scheduler. Tasks
+    can be added at any time but they do not run until the scheduler is
+    started. */
+
+namespace tsk {
+
+void start();
+bool stop();
+bool add(LPCSTR name, TaskProc proc, LPVOID arg = NULL, TaskPriority priority = kTaskNormal);
+bool isCancelled();
+bool waitFor(LPCSTR name, DWORD timeoutMs);
+
+} // end namespace NppPlugin::tsk
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_TASKS_H
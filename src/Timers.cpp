@@ -0,0 +1,122 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Timers.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    The Windows timer is always set for the earliest deadline. When it fires,
+    every timer that is due is run in deadline order, including those due
+    within the resolution of the Windows timer, which could not wait for them
+    any more precisely. Deadlines are GetTickCount values. The scheduling
+    itself is in core\TimerQueue.cpp.
+*/
+
+#include "System.h"
+#include "Timers.h"
+#include "Util.h"
+#include "core\TimerQueue.h"
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// Timers due this soon run early, since SetTimer cannot wait less than this
+#define TMR_SLACK_MS USER_TIMER_MINIMUM
+
+TimerQueue _queue(kTimersCount);
+TimerCallback _callbacks[kTimersCount];
+UINT_PTR _winTimerId = 0;
+
+VOID CALLBACK onWinTimer(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime);
+void resetWinTimer();
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+namespace tmr {
+
+/** Sets timer id to call callback after delayMs milliseconds. If id is already
+    set its deadline and callback are replaced. */
+void set(TimerId id, UINT delayMs, TimerCallback callback)
+{
+    _queue.set(id, ::GetTickCount(), delayMs);
+    _callbacks[id] = callback;
+    resetWinTimer();
+}
+
+void cancel(TimerId id)
+{
+    if (_queue.cancel(id)) {
+        resetWinTimer();
+    }
+}
+
+void cancelAll()
+{
+    _queue.cancelAll();
+    resetWinTimer();
+}
+
+bool isSet(TimerId id)
+{
+    return _queue.isSet(id);
+}
+
+} // end namespace NppPlugin::tmr
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/** Runs the callbacks of all timers that are due, earliest first. A callback
+    may set or cancel any timer, including its own. A timer set by a callback
+    runs on a later wake-up, even if it is already due. */
+VOID CALLBACK onWinTimer(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
+{
+    INT id;
+    DWORD now = ::GetTickCount();
+    UINT generation = _queue.generation();
+
+    while ((id = _queue.popDue(now, TMR_SLACK_MS, generation)) >= 0) {
+        LOGG(20, "Timer %i fired %li ms late", id, (LONG)(now - _queue.due(id)));
+        _callbacks[id]();
+    }
+    resetWinTimer();
+}
+
+/** Sets the Windows timer for the earliest deadline, or kills it if no timers
+    are set. */
+void resetWinTimer()
+{
+    UINT wait;
+
+    if (!_queue.nextWait(::GetTickCount(), &wait)) {
+        if (_winTimerId) {
+            ::KillTimer(NULL, _winTimerId);
+            _winTimerId = 0;
+        }
+        return;
+    }
+    // Replaces the existing timer if _winTimerId is not zero.
+    _winTimerId = ::SetTimer(NULL, _winTimerId, wait, onWinTimer);
+    if (_winTimerId == 0) {
+        LOG("Error %u setting the timer.", ::GetLastError());
+    }
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
@@ -0,0 +1,53 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**
+    @file      Timers.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#ifndef NPP_PLUGIN_TIMERS_H
+#define NPP_PLUGIN_TIMERS_H
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+/// Each timer has a fixed slot, so setting a timer that is already set only
+/// moves its deadline.
+enum TimerId {
+    kTimerSessionSave = 0, ///< save the session after files are closed, if not shutting down
+    kTimerTitlebar,        ///< update the title bar after NPP changes it
+    kTimerMarginClick,     ///< save the session after a bookmark or fold change
+    kTimerSettings,        ///< save settings after they stop changing
+    kTimerLoadBatch,       ///< load the next batch of a progressive session load
+    kTimerAsync,           ///< run the next queued SMM_ASYNC request
+    kTimersCount
+};
+
+typedef void (*TimerCallback)();
+
+//------------------------------------------------------------------------------
+/** @namespace NppPlugin::tmr Implements one-shot timers with millisecond
+    deadlines, all driven by a single Windows timer. Callbacks run on NPP's
+    main thread. These functions must only be called from that thread. */
+
+namespace tmr {
+
+void set(TimerId id, UINT delayMs, TimerCallback callback);
+void cancel(TimerId id);
+void cancelAll();
+bool isSet(TimerId id);
+
+} // end namespace NppPlugin::tmr
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_TIMERS_H
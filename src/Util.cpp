@@ -16,7 +16,8 @@
 #include "System.h"
 #include "SessionMgr.h"
 #include "Util.h"
-#include "utf8\unchecked.h"
+#include "Perf.h"
+#include "Log.h"
 #include <strsafe.h>
 
 //------------------------------------------------------------------------------
@@ -25,6 +26,62 @@ namespace NppPlugin {
 
 //------------------------------------------------------------------------------
 
+Scratch::Scratch()
+{
+    _used = 0;
+    _heapBlocks = NULL;
+}
+
+Scratch::~Scratch()
+{
+    LPVOID block;
+
+    while (_heapBlocks) {
+        block = _heapBlocks;
+        _heapBlocks = *(LPVOID*)block;
+        sys_free(block);
+    }
+}
+
+/** @return bytes of uninitialized memory, 8-byte aligned, else NULL */
+LPVOID Scratch::alloc(INT bytes)
+{
+    LPVOID *block;
+
+    bytes = (bytes + 7) & ~7;
+    if (bytes <= SCRATCH_BUF_LEN - _used) {
+        prf::increment(kCountScratchAllocs);
+        block = (LPVOID*)((LPBYTE)_buf + _used);
+        _used += bytes;
+        return block;
+    }
+    block = (LPVOID*)sys_alloc(bytes + sizeof(LONGLONG));
+    if (!block) {
+        return NULL;
+    }
+    *block = _heapBlocks;
+    _heapBlocks = block;
+    return (LPBYTE)block + sizeof(LONGLONG);
+}
+
+/** @return a UTF-8 copy of wStr, else NULL */
+LPSTR Scratch::toUtf8(LPCWSTR wStr)
+{
+    size_t bufLen = ::wcslen(wStr) * 3 + 1;
+    LPSTR buf = (LPSTR)alloc((INT)bufLen);
+    return buf ? str::utf16ToUtf8(wStr, buf, bufLen) : NULL;
+}
+
+/** @return a UTF-16 copy of cStr, else NULL */
+LPWSTR Scratch::toUtf16(LPCSTR cStr)
+{
+    size_t bufLen = ::strlen(cStr) + 1;
+    LPWSTR buf = (LPWSTR)alloc((INT)(bufLen * sizeof(WCHAR)));
+    return buf ? str::utf8ToUtf16(cStr, buf, bufLen) : NULL;
+}
+
+//------------------------------------------------------------------------------
+
 namespace msg {
 
 /** Displays a simple message box. For title/options see the M_* constants. */
@@ -78,20 +135,10 @@ void error(DWORD lastError, LPCWSTR format, ...)
 void log(LPCSTR format, ...)
 {
     if (gDbgLvl) {
-        LPCWSTR logFile = cfg::getStr(kDebugLogFile);
-        if (logFile && *logFile) {
-            FILE *fp;
-            ::_wfopen_s(&fp, logFile, L"a+");
-            if (fp) {
-                va_list argptr;
-                va_start(argptr, format);
-                ::vfprintf(fp, format, argptr); // Expects 'format' to be UTF-8, vfwprintf would write UTF-16
-                va_end(argptr);
-                ::fputwc(L'\n', fp);
-                ::fflush(fp);
-                ::fclose(fp);
-            }
-        }
+        va_list argptr;
+        va_start(argptr, format);
+        lgr::write(format, argptr); // Expects 'format' to be UTF-8
+        va_end(argptr);
     }
 }
 
@@ -190,6 +237,22 @@ void createFileIfMissing(LPCWSTR pathname, LPCSTR contents)
     }
 }
 
+/** Sets the last modified time of an existing file.
+    @return true on success */
+bool setModifiedTime(LPCWSTR pathname, const FILETIME *modified)
+{
+    BOOL suc;
+    HANDLE hFile;
+
+    hFile = ::CreateFileW(pathname, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    suc = ::SetFileTime(hFile, NULL, NULL, modified);
+    ::CloseHandle(hFile);
+    return suc != FALSE;
+}
+
 } // end namespace NppPlugin::pth
 
 //------------------------------------------------------------------------------
@@ -220,88 +283,6 @@ void removeAmp(LPCSTR src, LPSTR dst)
     *dst = 0;
 }
 
-/** Case-insensitive wildcard match. */
-bool wildcardMatchI(LPCWSTR wild, LPCWSTR str)
-{
-    WCHAR lcWild[MAX_PATH], lcStr[MAX_PATH];
-
-    ::StringCchCopyW(lcWild, MAX_PATH, wild);
-    ::StringCchCopyW(lcStr, MAX_PATH, str);
-    ::CharLower(lcWild);
-    ::CharLower(lcStr);
-    return wildcardMatch(lcWild, lcStr);
-}
-
-/** Originally written by Jack Handy and slightly modified by Mike Foster.
-    @see http://www.codeproject.com/Articles/1088/Wildcard-string-compare-globbing */
-bool wildcardMatch(LPCWSTR wild, LPCWSTR str)
-{
-    LPCWSTR cp = NULL, mp = NULL;
-
-    while (*str && *wild != L'*') {
-        if (*wild != *str && *wild != L'?') {
-            return false;
-        }
-        wild++;
-        str++;
-    }
-
-    while (*str) {
-        if (*wild == L'*') {
-            if (!*++wild) {
-                return true;
-            }
-            mp = wild;
-            cp = str + 1;
-        }
-        else if (*wild == *str || *wild == L'?') {
-            wild++;
-            str++;
-        }
-        else {
-            wild = mp;
-            str = cp++;
-        }
-    }
-
-    while (*wild == L'*') {
-        wild++;
-    }
-
-    return !*wild;
-}
-
-/** Converts a UTF-8 string to a string where all chars < 32 or > 126 are
-    converted to entities. Pass NULL for buf to get the size needed for buf.
-    @return the number of bytes in the converted string including the terminator */
-INT utf8ToAscii(LPCSTR str, LPSTR buf)
-{
-    INT bytes = 0;
-    LPSTR b = buf;
-    LPCSTR s = str;
-    utf8::uint32_t cp;
-    while (*s) {
-        cp = utf8::unchecked::next(s);
-        if (cp < 32 || cp > 126) {
-            if (buf) {
-                ::sprintf_s(b, 9, "&#x%04X;", cp);
-                b += 8;
-            }
-            bytes += 8;
-        }
-        else {
-            if (buf) {
-                *b++ = (unsigned char)cp;
-            }
-            ++bytes;
-        }
-    }
-    if (buf) {
-        *b = 0;
-    }
-    return bytes + 1;
-}
-
 /** cStr must be zero-terminated.
     @return a pointer to an allocated buffer which caller must free, else NULL
     on error */
@@ -310,51 +291,59 @@ LPWSTR utf8ToUtf16(LPCSTR cStr)
     return utf8ToUtf16(cStr, NULL, 0);
 }
 
-/** cStr must be zero-terminated.
+/** cStr must be zero-terminated. A UTF-16 string never has more units than
+    its UTF-8 string has bytes, so the allocated buffer is sized for that and
+    no sizing call is needed. Valid UTF-8 is converted in one pass by
+    str::decodeUtf8; invalid characters, or a buf that is too small, are left
+    to Windows, which replaces or reports them as before.
     @return if buf is NULL, a pointer to an allocated buffer which caller must
     free, else buf, or NULL on error */
 LPWSTR utf8ToUtf16(LPCSTR cStr, LPWSTR buf, size_t bufLen)
 {
-    size_t wLen;
+    INT wLen;
+    size_t cLen, size;
     DWORD lastError;
-    LPWSTR wBuf = NULL;
-
-    wLen = ::MultiByteToWideChar(CP_UTF8, 0, cStr, -1, NULL, 0);
-    if (wLen > 0) {
-        if (buf) {
-            if (bufLen >= wLen) {
-                if (::MultiByteToWideChar(CP_UTF8, 0, cStr, -1, buf, bufLen)) {
-                    wBuf = buf;
-                }
-                else {
-                    lastError = ::GetLastError();
-                    LOG("Error %lu for \"%s\".", lastError, cStr);
-                }
-            }
-            else {
-                LOG("Error. Provided buffer size (%i) is smaller than required (%i) for \"%s\".", bufLen, wLen, cStr);
-            }
+    LPWSTR wBuf;
+
+    cLen = ::strlen(cStr) + 1;
+    if (buf) {
+        if (str::decodeUtf8(cStr, buf, bufLen)) {
+            return buf;
         }
-        else {
-            wBuf = (LPWSTR)sys_alloc(wLen * sizeof(WCHAR));
-            if (wBuf) {
-                if (!::MultiByteToWideChar(CP_UTF8, 0, cStr, -1, wBuf, wLen)) {
-                    lastError = ::GetLastError();
-                    LOG("Error %lu for \"%s\".", lastError, cStr);
-                    sys_free(wBuf);
-                    wBuf = NULL;
-                }
+        if (bufLen < cLen) {
+            wLen = ::MultiByteToWideChar(CP_UTF8, 0, cStr, -1, NULL, 0);
+            if (wLen <= 0) {
+                lastError = ::GetLastError();
+                LOG("Error %lu. Invalid characters in \"%s\".", lastError, cStr);
+                return NULL;
             }
-            else {
-                LOG("Error allocating %u bytes for \"%s\".", wLen * sizeof(WCHAR), cStr);
+            if ((size_t)wLen > bufLen) {
+                LOG("Error. Provided buffer size (%i) is smaller than required (%i) for \"%s\".", bufLen, wLen, cStr);
+                return NULL;
             }
         }
+        wBuf = buf;
+        size = bufLen;
     }
     else {
+        size = UTF16_LEN_FOR_UTF8(cLen - 1);
+        wBuf = (LPWSTR)sys_alloc(size * sizeof(WCHAR));
+        if (!wBuf) {
+            LOG("Error allocating %u bytes for \"%s\".", size * sizeof(WCHAR), cStr);
+            return NULL;
+        }
+        if (str::decodeUtf8(cStr, wBuf, size)) {
+            return wBuf;
+        }
+    }
+    if (!::MultiByteToWideChar(CP_UTF8, 0, cStr, -1, wBuf, (INT)size)) {
         lastError = ::GetLastError();
-        LOG("Error %lu. Invalid characters in \"%s\".", lastError, cStr);
+        LOG("Error %lu for \"%s\".", lastError, cStr);
+        if (!buf) {
+            sys_free(wBuf);
+        }
+        return NULL;
     }
-
     return wBuf;
 }
 
@@ -366,51 +355,59 @@ LPSTR utf16ToUtf8(LPCWSTR wStr)
     return utf16ToUtf8(wStr, NULL, 0);
 }
 
-/** wStr must be zero-terminated.
+/** wStr must be zero-terminated. A UTF-8 string never has more than three
+    bytes per UTF-16 unit, so the allocated buffer is sized for that and no
+    sizing call is needed. Valid UTF-16 is converted in one pass by
+    str::encodeUtf8; unpaired surrogates, or a buf that is too small, are left
+    to Windows, which replaces or reports them as before.
     @return if buf is NULL, a pointer to an allocated buffer which caller must
     free, else buf, or NULL on error */
 LPSTR utf16ToUtf8(LPCWSTR wStr, LPSTR buf, size_t bufLen)
 {
-    size_t cLen;
+    INT cLen;
+    size_t wLen, size;
     DWORD lastError;
-    LPSTR cBuf = NULL;
-
-    cLen = ::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, NULL, 0, NULL, NULL);
-    if (cLen > 0) {
-        if (buf) {
-            if (bufLen >= cLen) {
-                if (::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, buf, bufLen, NULL, NULL)) {
-                    cBuf = buf;
-                }
-                else {
-                    lastError = ::GetLastError();
-                    LOG("Error %lu for \"%S\".", lastError, wStr);
-                }
-            }
-            else {
-                LOG("Error. Provided buffer size (%i) is smaller than required (%i) for \"%S\".", bufLen, cLen, wStr);
-            }
+    LPSTR cBuf;
+
+    wLen = ::wcslen(wStr);
+    if (buf) {
+        if (str::encodeUtf8(wStr, buf, bufLen)) {
+            return buf;
         }
-        else {
-            cBuf = (LPSTR)sys_alloc(cLen * sizeof(CHAR));
-            if (cBuf) {
-                if (!::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, cBuf, cLen, NULL, NULL)) {
-                    lastError = ::GetLastError();
-                    LOG("Error %lu for \"%S\".", lastError, wStr);
-                    sys_free(cBuf);
-                    cBuf = NULL;
-                }
+        if (bufLen < UTF8_LEN_FOR_UTF16(wLen)) {
+            cLen = ::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, NULL, 0, NULL, NULL);
+            if (cLen <= 0) {
+                lastError = ::GetLastError();
+                LOG("Error %lu. Invalid characters in \"%S\".", lastError, wStr);
+                return NULL;
             }
-            else {
-                LOG("Error allocating %u bytes for \"%S\".", cLen * sizeof(WCHAR), wStr);
+            if ((size_t)cLen > bufLen) {
+                LOG("Error. Provided buffer size (%i) is smaller than required (%i) for \"%S\".", bufLen, cLen, wStr);
+                return NULL;
             }
         }
+        cBuf = buf;
+        size = bufLen;
     }
     else {
+        size = UTF8_LEN_FOR_UTF16(wLen);
+        cBuf = (LPSTR)sys_alloc(size * sizeof(CHAR));
+        if (!cBuf) {
+            LOG("Error allocating %u bytes for \"%S\".", size * sizeof(CHAR), wStr);
+            return NULL;
+        }
+        if (str::encodeUtf8(wStr, cBuf, size)) {
+            return cBuf;
+        }
+    }
+    if (!::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, cBuf, (INT)size, NULL, NULL)) {
         lastError = ::GetLastError();
-        LOG("Error %lu. Invalid characters in \"%S\".", lastError, wStr);
+        LOG("Error %lu for \"%S\".", lastError, wStr);
+        if (!buf) {
+            sys_free(cBuf);
+        }
+        return NULL;
     }
-
     return cBuf;
 }
 
@@ -17,6 +17,7 @@
 #define NPP_PLUGIN_UTIL_H
 
 #include "Settings.h"
+#include "core\Text.h"
 
 //------------------------------------------------------------------------------
 
@@ -42,6 +43,30 @@ namespace NppPlugin {
 inline LPCWSTR boolToStr(const bool b) { return b ? L"true" : L"false"; }
 inline const bool uintToBool(UINT n) { return n == 0 ? false : true; }
 
+/// Bytes a Scratch can allocate before it uses the heap
+#define SCRATCH_BUF_LEN 4096
+
+/// @class Scratch
+/** Allocates temporary memory for one operation. Allocations are taken from
+    a buffer inside the object by bumping a pointer, and only go to the heap
+    if the buffer is full. Everything is freed when the Scratch goes out of
+    scope, so declare it on the stack in the scope that needs it. */
+class Scratch
+{
+  public:
+    Scratch();
+    ~Scratch();
+    LPVOID alloc(INT bytes);
+    LPSTR toUtf8(LPCWSTR wStr);
+    LPWSTR toUtf16(LPCSTR cStr);
+  private:
+    LONGLONG _buf[SCRATCH_BUF_LEN / sizeof(LONGLONG)]; ///< LONGLONG for alignment
+    INT _used;
+    LPVOID _heapBlocks; ///< each block starts with a pointer to the next
+    Scratch(const Scratch&);
+    Scratch& operator=(const Scratch&);
+};
+
 //------------------------------------------------------------------------------
 /** @namespace NppPlugin::msg Contains functions for displaying error and
     informational messages to the user and for logging to the debug log file. */
@@ -67,6 +92,7 @@ void appendSlash(LPWSTR buf, size_t bufLen);
 bool dirExists(LPCWSTR path);
 bool fileExists(LPCWSTR pathname);
 void createFileIfMissing(LPCWSTR pathname, LPCSTR contents);
+bool setModifiedTime(LPCWSTR pathname, const FILETIME *modified);
 
 } // end namespace NppPlugin::pth
 
@@ -77,9 +103,6 @@ namespace str {
 
 void removeAmp(LPCWSTR src, LPWSTR dst);
 void removeAmp(LPCSTR src, LPSTR dst);
-bool wildcardMatchI(LPCWSTR wild, LPCWSTR str);
-bool wildcardMatch(LPCWSTR wild, LPCWSTR str);
-INT utf8ToAscii(LPCSTR str, LPSTR buf = NULL);
 LPWSTR utf8ToUtf16(LPCSTR cStr);
 LPWSTR utf8ToUtf16(LPCSTR cStr, LPWSTR buf, size_t bufLen);
 LPSTR utf16ToUtf8(LPCWSTR wStr);
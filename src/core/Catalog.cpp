@@ -0,0 +1,219 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Catalog.cpp
+    @copyright Copyright 2011,2013-2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "Catalog.h"
+#include "Text.h"
+#include <algorithm>
+#include <cwchar>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// Sorts ascending alphabetically.
+struct ByName {
+    CatalogPlatform *platform;
+    explicit ByName(CatalogPlatform *p) : platform(p) {}
+    bool operator()(const Session &s1, const Session &s2) const
+    {
+        return platform->compareNames(s1.name, s2.name) < 0;
+    }
+};
+
+/// Sorts descending by the files' last modified times. Sessions that have the
+/// same last modified time are sorted ascending alphabetically.
+struct ByDate {
+    CatalogPlatform *platform;
+    explicit ByDate(CatalogPlatform *p) : platform(p) {}
+    bool operator()(const Session &s1, const Session &s2) const
+    {
+        if (s1.modified != s2.modified) {
+            return s1.modified > s2.modified;
+        }
+        return platform->compareNames(s1.name, s2.name) < 0;
+    }
+};
+
+/** Copies src to dst, a buffer of SES_NAME_BUF_LEN, truncating if needed. */
+void copyName(wchar_t *dst, const wchar_t *src)
+{
+    int i;
+
+    for (i = 0; i < SES_NAME_BUF_LEN - 1 && src[i]; ++i) {
+        dst[i] = src[i];
+    }
+    dst[i] = 0;
+}
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+/** Session constructor. */
+Session::Session(const wchar_t *sesName, unsigned long long modTime)
+{
+    copyName(name, sesName);
+    modified = modTime;
+    index = 0;
+    isVisible = false;
+    isFavorite = false;
+}
+
+//------------------------------------------------------------------------------
+
+/** Replaces the catalog with the sessions listed by platform, sorted
+    alphabetically if sortAlpha is true, else by date, then indexes them.
+    @return false if the session directory could not be read */
+bool SessionCatalog::read(CatalogPlatform &platform, bool sortAlpha)
+{
+    bool ok;
+
+    clear();
+    ok = platform.listSessions(*this);
+    for (iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
+        it->isFavorite = platform.isFavorite(it->name);
+    }
+    // Sort before indexing.
+    if (sortAlpha) {
+        std::sort(_sessions.begin(), _sessions.end(), ByName(&platform));
+    }
+    else {
+        std::sort(_sessions.begin(), _sessions.end(), ByDate(&platform));
+    }
+    reindex();
+    return ok;
+}
+
+/** Appends a session. Called from CatalogPlatform::listSessions, so it can
+    not be found until read returns. */
+void SessionCatalog::add(const wchar_t *name, unsigned long long modified)
+{
+    _sessions.push_back(Session(name, modified));
+}
+
+/** @return the index of the session named name, else -1 */
+int SessionCatalog::find(const wchar_t *name) const
+{
+    unsigned int mask, slot;
+    int si;
+
+    if (_slots.empty()) {
+        return -1;
+    }
+    mask = (unsigned int)_slots.size() - 1;
+    slot = str::hash(name) & mask;
+    while ((si = _slots[slot]) != 0) {
+        --si;
+        if (std::wcscmp(_sessions[si].name, name) == 0) {
+            return si;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/** Changes the name of the session at index si, keeping the index valid.
+    Its position in the sort order is not changed. */
+void SessionCatalog::rename(int si, const wchar_t *newName)
+{
+    if (si >= 0 && si < size()) {
+        copyName(_sessions[si].name, newName);
+        reindex();
+    }
+}
+
+/** Sets isVisible on each session: true for the sessions at ci and pi, which
+    are the current and previous sessions in the dialog, and for those whose
+    names match filter, ignoring case. No filter or "*" matches every session.
+    With useWildcards the filter is matched with str::wildcardMatch, else it
+    matches the names it is a prefix of. The filter is lower-cased once, and
+    each name as it is matched.
+    @return the number of visible sessions */
+int SessionCatalog::filter(CatalogPlatform &platform, const wchar_t *filter, bool useWildcards, int ci, int pi)
+{
+    int si, count = 0;
+    size_t filterLen = 0;
+    bool matchAll;
+    wchar_t lcFilter[SES_NAME_BUF_LEN], lcName[SES_NAME_BUF_LEN];
+
+    matchAll = !filter || !*filter || (filter[0] == L'*' && filter[1] == 0);
+    if (!matchAll) {
+        std::wcsncpy(lcFilter, filter, SES_NAME_BUF_LEN - 1);
+        lcFilter[SES_NAME_BUF_LEN - 1] = 0;
+        platform.toLower(lcFilter);
+        filterLen = std::wcslen(lcFilter);
+    }
+    for (si = 0; si < size(); ++si) {
+        Session &ses = _sessions[si];
+        if (matchAll || si == ci || si == pi) {
+            ses.isVisible = true;
+        }
+        else {
+            std::wcscpy(lcName, ses.name);
+            platform.toLower(lcName);
+            if (useWildcards) {
+                ses.isVisible = str::wildcardMatch(lcFilter, lcName);
+            }
+            else {
+                ses.isVisible = std::wcsncmp(lcFilter, lcName, filterLen) == 0;
+            }
+        }
+        if (ses.isVisible) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+/** Removes all sessions. */
+void SessionCatalog::clear()
+{
+    _sessions.clear();
+    _slots.clear();
+}
+
+/** Assigns sequential, 0-based numbers (session indexes) to the sessions, and
+    rebuilds the hash table. Must not be called before the sessions are sorted. */
+void SessionCatalog::reindex()
+{
+    int si, count = size();
+    unsigned int slots = 16;
+
+    while (slots < (unsigned int)count * 2) {
+        slots <<= 1;
+    }
+    _slots.assign(slots, 0);
+    for (si = 0; si < count; ++si) {
+        _sessions[si].index = si;
+        insertSlot(si);
+    }
+}
+
+/** Adds the session at si to the hash table, which must have a free slot. */
+void SessionCatalog::insertSlot(int si)
+{
+    unsigned int mask = (unsigned int)_slots.size() - 1;
+    unsigned int slot = str::hash(_sessions[si].name) & mask;
+
+    while (_slots[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    _slots[slot] = si + 1;
+}
+
+} // end namespace NppPlugin
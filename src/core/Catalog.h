@@ -0,0 +1,96 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Catalog.h
+    @copyright Copyright 2011,2013-2015 Michael Foster <http://mfoster.com/npp/>
+
+    The session catalog is the list of sessions found in the session
+    directory, sorted the way the Sessions dialog shows them, with a hash
+    index for finding a session by name, and the Sessions dialog's filter.
+    It does not call the OS directly: listing the directory, comparing and
+    lower-casing names and looking up favorites go through a CatalogPlatform, which the plugin implements with Win32 and
+    the tests implement with POSIX.
+*/
+
+#ifndef NPP_PLUGIN_CORE_CATALOG_H
+#define NPP_PLUGIN_CORE_CATALOG_H
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+#define SES_NAME_BUF_LEN 100
+
+class SessionCatalog;
+
+/// @class Session
+class Session
+{
+  public:
+    int index;
+    bool isVisible;
+    bool isFavorite;
+    unsigned long long modified; ///< last write time, in 100 ns units since 1601 (UTC)
+    wchar_t name[SES_NAME_BUF_LEN];
+    Session(const wchar_t *sesName, unsigned long long modTime);
+};
+
+/// @class CatalogPlatform The services a SessionCatalog needs from the OS.
+class CatalogPlatform
+{
+  public:
+    virtual ~CatalogPlatform() {}
+    /** Calls catalog.add for each session file in the session directory.
+        @return false if the directory could not be read at all */
+    virtual bool listSessions(SessionCatalog &catalog) = 0;
+    /** @return <0, 0 or >0 as s1 sorts before, with or after s2 */
+    virtual int compareNames(const wchar_t *s1, const wchar_t *s2) = 0;
+    /** Lower-cases str in place, for case-insensitive filtering. */
+    virtual void toLower(wchar_t *str) = 0;
+    virtual bool isFavorite(const wchar_t *name) = 0;
+};
+
+/// @class SessionCatalog
+class SessionCatalog
+{
+  public:
+    typedef std::vector<Session>::iterator iterator;
+    typedef std::vector<Session>::const_iterator const_iterator;
+
+    bool read(CatalogPlatform &platform, bool sortAlpha);
+    void add(const wchar_t *name, unsigned long long modified);
+    int find(const wchar_t *name) const;
+    int filter(CatalogPlatform &platform, const wchar_t *filter, bool useWildcards, int ci, int pi);
+    void rename(int si, const wchar_t *newName);
+    void clear();
+
+    int size() const { return (int)_sessions.size(); }
+    bool empty() const { return _sessions.empty(); }
+    Session& operator[](int si) { return _sessions[si]; }
+    const Session& operator[](int si) const { return _sessions[si]; }
+    /// Names must not be changed through these, only with rename.
+    iterator begin() { return _sessions.begin(); }
+    iterator end() { return _sessions.end(); }
+    const_iterator begin() const { return _sessions.begin(); }
+    const_iterator end() const { return _sessions.end(); }
+
+  private:
+    std::vector<Session> _sessions;
+    std::vector<int> _slots; ///< hash table of session indexes + 1, 0 if empty; size is a power of 2
+
+    void reindex();
+    void insertSlot(int si);
+};
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_CORE_CATALOG_H
@@ -0,0 +1,229 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      GlobalProps.cpp
+    @copyright Copyright 2014,2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "GlobalProps.h"
+#include "Text.h"
+#include <cstdlib>
+#include <cstring>
+
+using std::vector;
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// XML nodes
+const char* const XN_NOTEPADPLUS    = xmlIntern("NotepadPlus"); ///< root node
+const char* const XN_SESSION        = xmlIntern("Session");
+const char* const XN_MAINVIEW       = xmlIntern("mainView");
+const char* const XN_SUBVIEW        = xmlIntern("subView");
+const char* const XN_FILE           = xmlIntern("File");
+const char* const XN_MARK           = xmlIntern("Mark");
+const char* const XN_FOLD           = xmlIntern("Fold");
+const char* const XN_FILEPROPERTIES = xmlIntern("FileProperties");
+
+/// XML attributes
+const char* const XA_FILENAME         = xmlIntern("filename");
+const char* const XA_LANG             = xmlIntern("lang");
+const char* const XA_FIRSTVISIBLELINE = xmlIntern("firstVisibleLine");
+const char* const XA_LINE             = xmlIntern("line");
+
+tXmlEleP getPropsElement(tXmlDoc &globalDoc);
+void copyLines(tXmlDoc &dstDoc, tXmlEleP dstFileEle, tXmlEleP srcFileEle, const char *eleName);
+void addDeclaration(tXmlDoc &doc);
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+namespace prp {
+
+/** Updates the global File elements of globalDoc with the lang,
+    firstVisibleLine, bookmarks and folds of each File element of localDoc,
+    creating any that are missing, and adds the hash of each of localDoc's
+    pathnames to fileHashes. Each updated element is moved to the top, so the
+    most recently saved files are found first.
+    @return false if globalDoc has no FileProperties element */
+bool mergeIntoGlobal(tXmlDoc &globalDoc, tXmlDoc &localDoc, vector<unsigned int> &fileHashes)
+{
+    const char *target;
+    tXmlEleP globalPropsEle, globalFileEle;
+    tXmlEleP localViewEle, localFileEle;
+
+    globalPropsEle = getPropsElement(globalDoc);
+    if (!globalPropsEle) {
+        return false;
+    }
+    tXmlHnd localDocHnd(&localDoc);
+
+    // Iterate over the local View elements
+    localViewEle = localDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SESSION).FirstChildElement(XN_MAINVIEW).ToElement();
+    while (localViewEle) {
+        // Iterate over the local File elements
+        localFileEle = localViewEle->FirstChildElement(XN_FILE);
+        while (localFileEle) {
+            // Find the global File element corresponding to the current local File element
+            target = localFileEle->Attribute(XA_FILENAME);
+            fileHashes.push_back(str::hash(target ? target : ""));
+            globalFileEle = globalPropsEle->FirstChildElement(XN_FILE);
+            while (globalFileEle) {
+                if (globalFileEle->Attribute(XA_FILENAME, target)) {
+                    break; // found it
+                }
+                globalFileEle = globalFileEle->NextSiblingElement(XN_FILE);
+            }
+            if (!globalFileEle) { // not found so create one
+                globalFileEle = globalDoc.NewElement(XN_FILE);
+                globalFileEle->SetAttribute(XA_FILENAME, target);
+            }
+            globalPropsEle->InsertFirstChild(globalFileEle); // an existing element will get moved to the top
+            // Update global File attributes with values from the current local File attributes
+            globalFileEle->SetAttribute(XA_LANG, localFileEle->Attribute(XA_LANG));
+            globalFileEle->SetAttribute(XA_FIRSTVISIBLELINE, localFileEle->Attribute(XA_FIRSTVISIBLELINE));
+            copyLines(globalDoc, globalFileEle, localFileEle, XN_MARK);
+            copyLines(globalDoc, globalFileEle, localFileEle, XN_FOLD);
+            // Next local File element
+            localFileEle = localFileEle->NextSiblingElement(XN_FILE);
+        }
+        localViewEle = localViewEle->NextSiblingElement(XN_SUBVIEW);
+    }
+    addDeclaration(globalDoc);
+    return true;
+}
+
+/** Updates the File elements of localDoc with the global properties in
+    globalDoc, and adds the hash of each of its pathnames to fileHashes.
+    *changed is set true if localDoc was modified.
+    @return false if memory could not be allocated */
+bool mergeIntoSession(tXmlDoc &globalDoc, tXmlDoc &localDoc, vector<unsigned int> &fileHashes, bool *changed)
+{
+    char *buf = NULL;
+    size_t bufLen = 0;
+    const char *target;
+    tXmlEleP globalPropsEle, globalFileEle;
+    tXmlEleP localViewEle, localFileEle;
+
+    *changed = false;
+    globalPropsEle = getPropsElement(globalDoc);
+    tXmlHnd localDocHnd(&localDoc);
+
+    // Iterate over the local View elements
+    localViewEle = localDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_SESSION).FirstChildElement(XN_MAINVIEW).ToElement();
+    while (localViewEle) {
+        // Iterate over the local File elements
+        localFileEle = localViewEle->FirstChildElement(XN_FILE);
+        while (localFileEle) {
+            // Find the global File element corresponding to the current local File element
+            target = localFileEle->Attribute(XA_FILENAME);
+            fileHashes.push_back(str::hash(target ? target : ""));
+            globalFileEle = globalPropsEle ? globalPropsEle->FirstChildElement(XN_FILE) : NULL;
+            while (globalFileEle) {
+                if (globalFileEle->Attribute(XA_FILENAME, target)) {
+                    break; // found it
+                }
+                globalFileEle = globalFileEle->NextSiblingElement(XN_FILE);
+            }
+            if (globalFileEle) {
+                *changed = true;
+                // Update current local File attributes with values from the global File attributes
+                if (!str::utf8ToAscii(target, &buf, &bufLen)) { // NPP expects the pathname to be encoded like this
+                    return false;
+                }
+                localFileEle->SetAttribute(XA_FILENAME, buf);
+                localFileEle->SetAttribute(XA_LANG, globalFileEle->Attribute(XA_LANG));
+                copyLines(localDoc, localFileEle, globalFileEle, XN_MARK);
+                copyLines(localDoc, localFileEle, globalFileEle, XN_FOLD);
+            }
+            //else {
+            //    TODO: not found
+            //    This indicates global needs to be updated from this session,
+            //    but we can't call updateGlobalFromSession here.
+            //}
+            localFileEle = localFileEle->NextSiblingElement(XN_FILE);
+        }
+        localViewEle = localViewEle->NextSiblingElement(XN_SUBVIEW);
+    }
+    if (buf) {
+        std::free(buf);
+    }
+    if (*changed) {
+        addDeclaration(localDoc);
+    }
+    return true;
+}
+
+/** @return the global File element of globalDoc for the UTF-8 pathname, or
+    NULL if there is none */
+tXmlEleP findGlobalFile(tXmlDoc &globalDoc, const char *pathname)
+{
+    tXmlEleP globalPropsEle, globalFileEle;
+
+    globalPropsEle = getPropsElement(globalDoc);
+    globalFileEle = globalPropsEle ? globalPropsEle->FirstChildElement(XN_FILE) : NULL;
+    while (globalFileEle) {
+        if (globalFileEle->Attribute(XA_FILENAME, pathname)) {
+            break; // found it
+        }
+        globalFileEle = globalFileEle->NextSiblingElement(XN_FILE);
+    }
+    return globalFileEle;
+}
+
+} // end namespace NppPlugin::prp
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/** @return the FileProperties element of globalDoc, or NULL */
+tXmlEleP getPropsElement(tXmlDoc &globalDoc)
+{
+    tXmlHnd globalDocHnd(&globalDoc);
+    return globalDocHnd.FirstChildElement(XN_NOTEPADPLUS).FirstChildElement(XN_FILEPROPERTIES).ToElement();
+}
+
+/** Replaces dstFileEle's child elements named eleName with copies of the
+    line attribute of srcFileEle's child elements of that name. */
+void copyLines(tXmlDoc &dstDoc, tXmlEleP dstFileEle, tXmlEleP srcFileEle, const char *eleName)
+{
+    tXmlEleP ele, tmp;
+
+    ele = dstFileEle->FirstChildElement(eleName);
+    while (ele) {
+        tmp = ele;
+        ele = ele->NextSiblingElement(eleName);
+        dstFileEle->DeleteChild(tmp);
+    }
+    for (ele = srcFileEle->FirstChildElement(eleName); ele; ele = ele->NextSiblingElement(eleName)) {
+        tmp = dstDoc.NewElement(eleName);
+        dstFileEle->InsertEndChild(tmp);
+        tmp->SetAttribute(XA_LINE, ele->Attribute(XA_LINE));
+    }
+}
+
+/** Adds an XML declaration to doc if it is missing. */
+void addDeclaration(tXmlDoc &doc)
+{
+    if (std::memcmp(doc.FirstChild()->Value(), "xml", 3) != 0) {
+        doc.InsertFirstChild(doc.NewDeclaration());
+    }
+}
+
+} // end namespace
+
+} // end namespace NppPlugin
@@ -0,0 +1,42 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      GlobalProps.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    The document-level work behind the prp::update functions: merging a
+    session document with the global properties document, in either
+    direction, and finding a pathname in the global document. These neither
+    read nor write files, so the caller owns locking, loading and saving.
+*/
+
+#ifndef NPP_PLUGIN_CORE_GLOBALPROPS_H
+#define NPP_PLUGIN_CORE_GLOBALPROPS_H
+
+#include "../xml/tinyxml.h"
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace prp {
+
+bool mergeIntoGlobal(tXmlDoc &globalDoc, tXmlDoc &localDoc, std::vector<unsigned int> &fileHashes);
+bool mergeIntoSession(tXmlDoc &globalDoc, tXmlDoc &localDoc, std::vector<unsigned int> &fileHashes, bool *changed);
+tXmlEleP findGlobalFile(tXmlDoc &globalDoc, const char *pathname);
+
+} // end namespace NppPlugin::prp
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_CORE_GLOBALPROPS_H
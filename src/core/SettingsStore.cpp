@@ -0,0 +1,308 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      SettingsStore.cpp
+    @copyright Copyright 2014,2015 Michael Foster <http://mfoster.com/npp/>
+
+    An ItemList's index is a vector of its elements in document order and an
+    open-addressing hash table of their positions keyed by value. An appended
+    child is added to the index. Any other change, such as a prepend or a
+    move to the top, shifts the positions, so it marks the index stale and
+    the index is rebuilt from the DOM on the next lookup. These changes are
+    rare compared to reads.
+*/
+
+#include "SettingsStore.h"
+#include "Text.h"
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// XML node and attribute names
+const char* const XN_ITEM  = xmlIntern("item");
+const char* const XA_VALUE = xmlIntern("value");
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+SettingsStore::SettingsStore() : _doc(NULL), _root(NULL), _isDirty(false)
+{
+}
+
+SettingsStore::~SettingsStore()
+{
+    clear();
+}
+
+/** Loads the settings file if it has not already been loaded. If the file or
+    its rootName element is missing they are created, and the store is marked
+    dirty so the next save writes them.
+    @return false if the file could not be loaded */
+bool SettingsStore::load(SettingsPlatform &platform, const char *rootName)
+{
+    bool missing = false;
+
+    if (_doc) {
+        return true;
+    }
+    _doc = new tXmlDoc();
+    if (!platform.readSettings(*_doc, &missing)) {
+        clear();
+        return false;
+    }
+    if (missing) {
+        _doc->Clear();
+        _doc->InsertFirstChild(_doc->NewDeclaration());
+        _isDirty = true;
+    }
+    _root = _doc->FirstChildElement(rootName);
+    if (!_root) {
+        _root = _doc->NewElement(rootName);
+        _doc->InsertEndChild(_root);
+        _isDirty = true;
+    }
+    return true;
+}
+
+/** Writes the document and clears the dirty flag. ItemLists keep their own
+    flags, which the caller clears.
+    @return false if nothing is loaded or the file could not be written */
+bool SettingsStore::save(SettingsPlatform &platform)
+{
+    if (!_doc || !platform.writeSettings(*_doc)) {
+        return false;
+    }
+    _isDirty = false;
+    return true;
+}
+
+/** Discards the document. Elements and ItemLists attached to it must not be
+    used afterwards. */
+void SettingsStore::clear()
+{
+    delete _doc;
+    _doc = NULL;
+    _root = NULL;
+    _isDirty = false;
+}
+
+/** @return the first child of the root element named name, creating it at
+    the end if it doesn't exist, else NULL if nothing is loaded */
+tXmlEleP SettingsStore::container(const char *name)
+{
+    tXmlEleP conEle;
+
+    if (!_root) {
+        return NULL;
+    }
+    conEle = _root->FirstChildElement(name);
+    if (!conEle) {
+        conEle = _doc->NewElement(name);
+        _root->InsertEndChild(conEle);
+        _isDirty = true;
+    }
+    return conEle;
+}
+
+//------------------------------------------------------------------------------
+
+ItemList::ItemList() : _container(NULL), _isStale(false), _isDirty(false)
+{
+}
+
+/** Indexes the children of container, which may be NULL to detach the list. */
+void ItemList::attach(tXmlEleP container)
+{
+    _container = container;
+    _isDirty = false;
+    reindex();
+}
+
+/** @return the number of children */
+int ItemList::size()
+{
+    if (_isStale) {
+        reindex();
+    }
+    return (int)_children.size();
+}
+
+/** @return the value of the 0-based pos'th child, or NULL if it doesn't exist */
+const char* ItemList::value(int pos)
+{
+    if (pos < 0 || pos >= size()) {
+        return NULL;
+    }
+    return _children[pos]->Attribute(XA_VALUE);
+}
+
+/** @return the first child with value, else NULL */
+tXmlEleP ItemList::find(const char *value)
+{
+    int pos;
+
+    if (value && *value) {
+        pos = findPos(value);
+        if (pos >= 0) {
+            return _children[pos];
+        }
+    }
+    return NULL;
+}
+
+/** Adds a new element with value. Appends if append is true else prepends.
+    Does nothing if value is null or empty or a child with value already exists.
+    @return true if the element was added */
+bool ItemList::add(const char *value, bool append)
+{
+    tXmlEleP itemEle;
+
+    if (!_container || !value || !*value || find(value)) {
+        return false;
+    }
+    itemEle = _container->GetDocument()->NewElement(XN_ITEM);
+    itemEle->SetAttribute(XA_VALUE, value);
+    if (append) {
+        _container->InsertEndChild(itemEle);
+        changed(itemEle);
+    }
+    else {
+        _container->InsertFirstChild(itemEle);
+        changed();
+    }
+    return true;
+}
+
+/** If a child with value exists, moves it to the top, else adds a new element
+    at the top with value. If it already exists at the top, does nothing.
+    Does nothing if value is null or empty.
+    @return true if any change was made, else false */
+bool ItemList::moveToTop(const char *value)
+{
+    tXmlEleP itemEle = find(value);
+
+    if (!itemEle) { // not found so add it at the top
+        return add(value, false);
+    }
+    if (itemEle->PreviousSiblingElement()) { // found and not at top so move it to the top
+        _container->InsertFirstChild(itemEle);
+        changed();
+        return true;
+    }
+    return false;
+}
+
+/** Deletes all children. */
+void ItemList::clear()
+{
+    if (_container) {
+        _container->DeleteChildren();
+        changed();
+    }
+}
+
+/** Marks the list dirty. Every change to the children must call this. If the
+    only change was to append the appended element, it is added to the index
+    in constant time, so a sequence of n appends costs O(n). Otherwise the
+    index is rebuilt on the next lookup, which is O(n) for n children. A
+    sequence of prepends or moves to the top, each followed by a lookup as in
+    add and moveToTop, is therefore O(n) per change and O(n^2) overall. */
+void ItemList::changed(tXmlEleP appended)
+{
+    _isDirty = true;
+    if (appended && !_isStale) {
+        _children.push_back(appended);
+        if (_children.size() * 2 > _slots.size()) {
+            _isStale = true; // too full, so rebuild at twice the size
+        }
+        else {
+            insertSlot((int)_children.size() - 1);
+        }
+    }
+    else {
+        _isStale = true;
+    }
+}
+
+/** Rebuilds the index from the elements. */
+void ItemList::reindex()
+{
+    int pos, count;
+    unsigned int slots;
+    tXmlEleP childEle;
+
+    _isStale = false;
+    _children.clear();
+    _slots.clear();
+    if (!_container) {
+        return;
+    }
+    for (childEle = _container->FirstChildElement(); childEle; childEle = childEle->NextSiblingElement()) {
+        _children.push_back(childEle);
+    }
+    count = (int)_children.size();
+    slots = 16;
+    while (slots < (unsigned int)count * 2) {
+        slots <<= 1;
+    }
+    _slots.assign(slots, 0);
+    for (pos = 0; pos < count; ++pos) {
+        insertSlot(pos);
+    }
+}
+
+/** Adds the child at pos to the hash table, which must have a free slot. */
+void ItemList::insertSlot(int pos)
+{
+    unsigned int mask, slot;
+    const char *value = _children[pos]->Attribute(XA_VALUE);
+
+    if (value && *value) {
+        mask = (unsigned int)_slots.size() - 1;
+        slot = str::hash(value) & mask;
+        while (_slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        _slots[slot] = pos + 1;
+    }
+}
+
+/** @return the position of the first child with value, else -1 */
+int ItemList::findPos(const char *value)
+{
+    unsigned int mask, slot;
+    int pos, found = -1;
+
+    if (_isStale) {
+        reindex();
+    }
+    if (_slots.empty()) {
+        return -1;
+    }
+    mask = (unsigned int)_slots.size() - 1;
+    slot = str::hash(value) & mask;
+    // Duplicates are possible in a hand-edited file, so find the first.
+    while ((pos = _slots[slot]) != 0) {
+        --pos;
+        if ((found < 0 || pos < found) && _children[pos]->Attribute(XA_VALUE, value)) {
+            found = pos;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return found;
+}
+
+} // end namespace NppPlugin
@@ -0,0 +1,106 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      SettingsStore.h
+    @copyright Copyright 2014,2015 Michael Foster <http://mfoster.com/npp/>
+
+    The document behind cfg: the settings.xml DOM with its containers, and the
+    item lists, such as Favorites, with an index of their children by value.
+    Reading and writing the file go through a SettingsPlatform, which the
+    plugin implements with Win32, including the file lock, and the tests
+    implement with POSIX. The setting schema and the UTF-16 caches stay in
+    the plugin's Settings.cpp.
+*/
+
+#ifndef NPP_PLUGIN_CORE_SETTINGSSTORE_H
+#define NPP_PLUGIN_CORE_SETTINGSSTORE_H
+
+#include "../xml/tinyxml.h"
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+/// @class SettingsPlatform The services a SettingsStore needs from the OS.
+class SettingsPlatform
+{
+  public:
+    virtual ~SettingsPlatform() {}
+    /** Loads the settings file into doc. If the file does not exist, sets
+        *missing to true and leaves doc empty.
+        @return false on error, which the platform has reported */
+    virtual bool readSettings(tXmlDoc &doc, bool *missing) = 0;
+    /** Writes doc to the settings file.
+        @return false on error, which the platform has reported */
+    virtual bool writeSettings(tXmlDoc &doc) = 0;
+};
+
+/// @class SettingsStore
+class SettingsStore
+{
+  public:
+    SettingsStore();
+    ~SettingsStore();
+
+    bool load(SettingsPlatform &platform, const char *rootName);
+    bool save(SettingsPlatform &platform);
+    void clear();
+    tXmlEleP container(const char *name);
+
+    bool isLoaded() const { return _doc != NULL; }
+    tXmlDocP document() { return _doc; }
+    /// True if elements were added since the last load or save.
+    bool isDirty() const { return _isDirty; }
+    void setDirty() { _isDirty = true; }
+
+  private:
+    tXmlDocP _doc;
+    tXmlEleP _root;
+    bool _isDirty;
+
+    SettingsStore(const SettingsStore&);
+    SettingsStore& operator=(const SettingsStore&);
+};
+
+/// @class ItemList The item children of a container, each with a value attribute.
+class ItemList
+{
+  public:
+    ItemList();
+
+    void attach(tXmlEleP container);
+    int size();
+    const char* value(int pos);
+    tXmlEleP find(const char *value);
+    bool add(const char *value, bool append = true);
+    bool moveToTop(const char *value);
+    void clear();
+
+    /// True if the list changed since the last clearDirty.
+    bool isDirty() const { return _isDirty; }
+    void clearDirty() { _isDirty = false; }
+
+  private:
+    tXmlEleP _container;
+    std::vector<tXmlEleP> _children; ///< child elements in document order
+    std::vector<int> _slots;         ///< hash table of child positions + 1, 0 if empty; size is a power of 2
+    bool _isStale;                   ///< if true, rebuilt on the next lookup
+    bool _isDirty;
+
+    void changed(tXmlEleP appended = NULL);
+    void reindex();
+    void insertSlot(int pos);
+    int findPos(const char *value);
+};
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_CORE_SETTINGSSTORE_H
@@ -0,0 +1,307 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Text.cpp
+    @copyright Copyright 2011-2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "Text.h"
+#include "../utf8/unchecked.h"
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace str {
+
+/** Originally written by Jack Handy and slightly modified by Mike Foster.
+    @see http://www.codeproject.com/Articles/1088/Wildcard-string-compare-globbing */
+bool wildcardMatch(const wchar_t *wild, const wchar_t *str)
+{
+    const wchar_t *cp = 0, *mp = 0;
+
+    while (*str && *wild != L'*') {
+        if (*wild != *str && *wild != L'?') {
+            return false;
+        }
+        wild++;
+        str++;
+    }
+
+    while (*str) {
+        if (*wild == L'*') {
+            if (!*++wild) {
+                return true;
+            }
+            mp = wild;
+            cp = str + 1;
+        }
+        else if (*wild == *str || *wild == L'?') {
+            wild++;
+            str++;
+        }
+        else {
+            wild = mp;
+            str = cp++;
+        }
+    }
+
+    while (*wild == L'*') {
+        wild++;
+    }
+
+    return !*wild;
+}
+
+/** @return the FNV-1a hash of str */
+unsigned int hash(const wchar_t *str)
+{
+    unsigned int h = 2166136261U;
+
+    while (*str) {
+        h ^= (unsigned int)*str++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/** @return the FNV-1a hash of the bytes of str */
+unsigned int hash(const char *str)
+{
+    unsigned int h = 2166136261U;
+
+    while (*str) {
+        h ^= (unsigned int)(unsigned char)*str++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/** Converts a UTF-8 string to a string where all chars < 32 or > 126 are
+    converted to entities of four hex digits. Code points above U+FFFF are
+    written as a UTF-16 surrogate pair, one entity each. *buf is a buffer of
+    *bufLen bytes, or NULL, which is replaced by a larger one if needed. Pass
+    the same buffer for every string in a loop, then free it with free.
+    @return *buf, or NULL if it could not be allocated */
+char* utf8ToAscii(const char *str, char **buf, size_t *bufLen)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    int i, units;
+    char *b;
+    const char *s = str;
+    utf8::uint32_t cp, unit[2];
+    size_t need = std::strlen(str) * 8 + 1; // at most one 8-byte entity per input byte
+
+    if (*bufLen < need) {
+        if (*buf) {
+            std::free(*buf);
+        }
+        *buf = (char*)std::malloc(need);
+        *bufLen = *buf ? need : 0;
+        if (!*buf) {
+            return NULL;
+        }
+    }
+    b = *buf;
+    while (*s) {
+        // Copy a run of printable ASCII. Bytes of multi-byte sequences and the terminator end it.
+        while ((unsigned char)(*s - 32) < 95) {
+            *b++ = *s++;
+        }
+        if (!*s) {
+            break;
+        }
+        cp = utf8::unchecked::next(s);
+        if (cp > 0xFFFF && cp <= 0x10FFFF) {
+            cp -= 0x10000;
+            unit[0] = 0xD800 + (cp >> 10);
+            unit[1] = 0xDC00 + (cp & 0x3FF);
+            units = 2;
+        }
+        else {
+            unit[0] = cp > 0xFFFF ? 0xFFFD : cp; // invalid input
+            units = 1;
+        }
+        for (i = 0; i < units; ++i) {
+            *b++ = '&';
+            *b++ = '#';
+            *b++ = 'x';
+            *b++ = hex[(unit[i] >> 12) & 0xF];
+            *b++ = hex[(unit[i] >> 8) & 0xF];
+            *b++ = hex[(unit[i] >> 4) & 0xF];
+            *b++ = hex[unit[i] & 0xF];
+            *b++ = ';';
+        }
+    }
+    *b = 0;
+    return *buf;
+}
+
+/// Units checked at a time by the ASCII fast paths. The loops over a block
+/// have no branches, so the compiler can vectorize them.
+#define ASCII_BLOCK 16
+
+/** Converts a zero-terminated UTF-8 string to UTF-16, in one pass and without
+    allocating. dst is a buffer of dstLen units; UTF16_LEN_FOR_UTF8(strlen(src))
+    is always enough. Each wchar_t holds one UTF-16 unit, also where wchar_t is
+    wider. Invalid UTF-8, including overlong forms, encoded surrogates and code
+    points above U+10FFFF, is rejected rather than replaced.
+    @return dst, or NULL if src is not valid UTF-8 or dst is too small */
+wchar_t* decodeUtf8(const char *src, wchar_t *dst, size_t dstLen)
+{
+    int k, n;
+    unsigned int c, acc;
+    size_t i = 0, j = 0, len = std::strlen(src);
+    const unsigned char *s = (const unsigned char*)src;
+
+    while (i < len) {
+        if (len - i >= ASCII_BLOCK && dstLen - j > ASCII_BLOCK) {
+            acc = 0;
+            for (k = 0; k < ASCII_BLOCK; ++k) {
+                acc |= s[i + k];
+            }
+            if (acc < 0x80) {
+                for (k = 0; k < ASCII_BLOCK; ++k) {
+                    dst[j + k] = (wchar_t)s[i + k];
+                }
+                i += ASCII_BLOCK;
+                j += ASCII_BLOCK;
+                continue;
+            }
+        }
+        c = s[i];
+        if (c < 0x80) {
+            n = 0;
+        }
+        else if (c >= 0xC2 && c <= 0xDF) {
+            n = 1;
+            c &= 0x1F;
+        }
+        else if (c >= 0xE0 && c <= 0xEF) {
+            n = 2;
+            c &= 0x0F;
+        }
+        else if (c >= 0xF0 && c <= 0xF4) {
+            n = 3;
+            c &= 0x07;
+        }
+        else {
+            return NULL;
+        }
+        // A truncated sequence stops at the terminator, which is not a continuation byte.
+        for (k = 1; k <= n; ++k) {
+            if ((s[i + k] & 0xC0) != 0x80) {
+                return NULL;
+            }
+            c = (c << 6) | (s[i + k] & 0x3F);
+        }
+        if ((n == 2 && (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF))) || (n == 3 && (c < 0x10000 || c > 0x10FFFF))) {
+            return NULL;
+        }
+        i += n + 1;
+        if (c < 0x10000) {
+            if (j + 1 >= dstLen) {
+                return NULL;
+            }
+            dst[j++] = (wchar_t)c;
+        }
+        else {
+            if (j + 2 >= dstLen) {
+                return NULL;
+            }
+            c -= 0x10000;
+            dst[j++] = (wchar_t)(0xD800 + (c >> 10));
+            dst[j++] = (wchar_t)(0xDC00 + (c & 0x3FF));
+        }
+    }
+    if (j >= dstLen) {
+        return NULL;
+    }
+    dst[j] = 0;
+    return dst;
+}
+
+/** Converts a zero-terminated UTF-16 string to UTF-8, in one pass and without
+    allocating. dst is a buffer of dstLen bytes; UTF8_LEN_FOR_UTF16(wcslen(src))
+    is always enough. Unpaired surrogates are rejected rather than replaced.
+    @return dst, or NULL if src is not valid UTF-16 or dst is too small */
+char* encodeUtf8(const wchar_t *src, char *dst, size_t dstLen)
+{
+    int k, n;
+    unsigned int c, c2, acc;
+    size_t i = 0, j = 0, len = std::wcslen(src);
+
+    while (i < len) {
+        if (len - i >= ASCII_BLOCK && dstLen - j > ASCII_BLOCK) {
+            acc = 0;
+            for (k = 0; k < ASCII_BLOCK; ++k) {
+                acc |= (unsigned int)src[i + k];
+            }
+            if (acc < 0x80) {
+                for (k = 0; k < ASCII_BLOCK; ++k) {
+                    dst[j + k] = (char)src[i + k];
+                }
+                i += ASCII_BLOCK;
+                j += ASCII_BLOCK;
+                continue;
+            }
+        }
+        c = (unsigned int)src[i++];
+        if (c >= 0xD800 && c <= 0xDBFF) {
+            c2 = (unsigned int)src[i]; // the terminator if c is last
+            if (c2 < 0xDC00 || c2 > 0xDFFF) {
+                return NULL;
+            }
+            ++i;
+            c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+        }
+        else if ((c >= 0xDC00 && c <= 0xDFFF) || c > 0xFFFF) {
+            return NULL;
+        }
+        n = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        if (dstLen - j <= (size_t)n) {
+            return NULL;
+        }
+        switch (n) {
+            case 1:
+                dst[j++] = (char)c;
+                break;
+            case 2:
+                dst[j++] = (char)(0xC0 | (c >> 6));
+                dst[j++] = (char)(0x80 | (c & 0x3F));
+                break;
+            case 3:
+                dst[j++] = (char)(0xE0 | (c >> 12));
+                dst[j++] = (char)(0x80 | ((c >> 6) & 0x3F));
+                dst[j++] = (char)(0x80 | (c & 0x3F));
+                break;
+            default:
+                dst[j++] = (char)(0xF0 | (c >> 18));
+                dst[j++] = (char)(0x80 | ((c >> 12) & 0x3F));
+                dst[j++] = (char)(0x80 | ((c >> 6) & 0x3F));
+                dst[j++] = (char)(0x80 | (c & 0x3F));
+                break;
+        }
+    }
+    if (j >= dstLen) {
+        return NULL;
+    }
+    dst[j] = 0;
+    return dst;
+}
+
+} // end namespace NppPlugin::str
+
+} // end namespace NppPlugin
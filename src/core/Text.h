@@ -0,0 +1,47 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Text.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Portable string functions. Everything under src/core builds without
+    Windows headers, so it can be compiled and tested on any platform.
+*/
+
+#ifndef NPP_PLUGIN_CORE_TEXT_H
+#define NPP_PLUGIN_CORE_TEXT_H
+
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace str {
+
+/// Buffer lengths, with the terminator, that always fit the conversion of a
+/// string of len units
+#define UTF16_LEN_FOR_UTF8(len) ((len) + 1)
+#define UTF8_LEN_FOR_UTF16(len) ((len) * 3 + 1)
+
+bool wildcardMatch(const wchar_t *wild, const wchar_t *str);
+unsigned int hash(const wchar_t *str);
+unsigned int hash(const char *str);
+char* utf8ToAscii(const char *str, char **buf, size_t *bufLen);
+wchar_t* decodeUtf8(const char *src, wchar_t *dst, size_t dstLen);
+char* encodeUtf8(const wchar_t *src, char *dst, size_t dstLen);
+
+} // end namespace NppPlugin::str
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_CORE_TEXT_H
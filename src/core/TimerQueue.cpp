@@ -0,0 +1,108 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      TimerQueue.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Deadlines are compared as signed differences, so the wrap-around of the
+    clock does not matter as long as no timer is set more than 24 days ahead.
+*/
+
+#include "TimerQueue.h"
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+/** TimerQueue constructor. All count timers start cancelled. */
+TimerQueue::TimerQueue(int count)
+{
+    Slot slot;
+
+    slot.isSet = false;
+    slot.due = 0;
+    slot.generation = 0;
+    _slots.assign(count, slot);
+    _generation = 0;
+}
+
+/** Sets timer id to be due delayMs after now. If id is already set its
+    deadline is replaced. */
+void TimerQueue::set(int id, unsigned int now, unsigned int delayMs)
+{
+    _slots[id].isSet = true;
+    _slots[id].due = now + delayMs;
+    _slots[id].generation = _generation++;
+}
+
+/** @return true if timer id was set */
+bool TimerQueue::cancel(int id)
+{
+    bool wasSet = _slots[id].isSet;
+    _slots[id].isSet = false;
+    return wasSet;
+}
+
+void TimerQueue::cancelAll()
+{
+    for (int i = 0; i < (int)_slots.size(); ++i) {
+        _slots[i].isSet = false;
+    }
+}
+
+/** Finds the timer with the earliest deadline that is due at now, or within
+    slackMs after it, and was set before the given generation. Ties go to the
+    lower id. Timers set at or after generation, such as those a callback
+    re-arms, are left for the next run.
+    @return the id of that timer, which is cancelled, or -1 if none is due */
+int TimerQueue::popDue(unsigned int now, unsigned int slackMs, unsigned int generation)
+{
+    int best = -1;
+
+    for (int i = 0; i < (int)_slots.size(); ++i) {
+        const Slot &slot = _slots[i];
+        if (slot.isSet && (int)(slot.due - now) <= (int)slackMs && (int)(slot.generation - generation) < 0) {
+            if (best < 0 || (int)(slot.due - _slots[best].due) < 0) {
+                best = i;
+            }
+        }
+    }
+    if (best >= 0) {
+        _slots[best].isSet = false;
+    }
+    return best;
+}
+
+/** Gets the time from now until the earliest deadline, which is zero if a
+    timer is overdue.
+    @return false if no timer is set */
+bool TimerQueue::nextWait(unsigned int now, unsigned int *waitMs) const
+{
+    int wait, minWait = 0;
+    bool found = false;
+
+    for (int i = 0; i < (int)_slots.size(); ++i) {
+        if (_slots[i].isSet) {
+            wait = (int)(_slots[i].due - now);
+            if (!found || wait < minWait) {
+                minWait = wait;
+                found = true;
+            }
+        }
+    }
+    if (found) {
+        *waitMs = minWait < 0 ? 0 : (unsigned int)minWait;
+    }
+    return found;
+}
+
+} // end namespace NppPlugin
@@ -0,0 +1,58 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      TimerQueue.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    The scheduling behind tmr: one-shot timers in fixed slots, each with a
+    deadline on a millisecond clock that wraps at 2^32. The caller supplies
+    the clock and runs the callbacks, so the queue can be tested without a
+    message loop.
+*/
+
+#ifndef NPP_PLUGIN_CORE_TIMERQUEUE_H
+#define NPP_PLUGIN_CORE_TIMERQUEUE_H
+
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+/// @class TimerQueue
+class TimerQueue
+{
+  public:
+    explicit TimerQueue(int count);
+
+    void set(int id, unsigned int now, unsigned int delayMs);
+    bool cancel(int id);
+    void cancelAll();
+    bool isSet(int id) const { return _slots[id].isSet; }
+    unsigned int due(int id) const { return _slots[id].due; }
+    /// Increases each time a timer is set, so a run can skip timers set during it.
+    unsigned int generation() const { return _generation; }
+    int popDue(unsigned int now, unsigned int slackMs, unsigned int generation);
+    bool nextWait(unsigned int now, unsigned int *waitMs) const;
+
+  private:
+    typedef struct Slot_tag {
+        bool         isSet;
+        unsigned int due;
+        unsigned int generation; ///< value of _generation when it was set
+    } Slot;
+
+    std::vector<Slot> _slots;
+    unsigned int _generation;
+};
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_CORE_TIMERQUEUE_H
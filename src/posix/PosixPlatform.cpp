@@ -0,0 +1,199 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      PosixPlatform.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "PosixPlatform.h"
+#include <cerrno>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <dirent.h>
+#include <sys/stat.h>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// Seconds from 1601-01-01, the FILETIME epoch, to 1970-01-01
+#define EPOCH_DIFF_SECS 11644473600ULL
+
+} // end namespace
+
+//------------------------------------------------------------------------------
+
+PosixCatalogPlatform::PosixCatalogPlatform(const char *sesDir, const char *sesExt)
+    : _sesDir(sesDir), _sesExt(sesExt)
+{
+    if (!_sesDir.empty() && _sesDir[_sesDir.size() - 1] != '/') {
+        _sesDir += '/';
+    }
+}
+
+void PosixCatalogPlatform::addFavorite(const wchar_t *name)
+{
+    _favorites.insert(name);
+}
+
+/** Adds each regular file in the session directory whose name ends with the
+    session extension, without the extension. */
+bool PosixCatalogPlatform::listSessions(SessionCatalog &catalog)
+{
+    DIR *dir;
+    struct dirent *ent;
+    struct stat st;
+    size_t nameLen, extLen = _sesExt.size();
+    std::string path;
+    wchar_t name[SES_NAME_BUF_LEN];
+
+    dir = ::opendir(_sesDir.c_str());
+    if (!dir) {
+        return false;
+    }
+    while ((ent = ::readdir(dir)) != NULL) {
+        nameLen = std::strlen(ent->d_name);
+        if (nameLen <= extLen || std::strcmp(ent->d_name + nameLen - extLen, _sesExt.c_str()) != 0) {
+            continue;
+        }
+        path = _sesDir + ent->d_name;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        path.assign(ent->d_name, nameLen - extLen);
+        if (utf8ToWide(path.c_str(), name, SES_NAME_BUF_LEN)) {
+            catalog.add(name, ((unsigned long long)st.st_mtime + EPOCH_DIFF_SECS) * 10000000ULL);
+        }
+    }
+    ::closedir(dir);
+    return true;
+}
+
+int PosixCatalogPlatform::compareNames(const wchar_t *s1, const wchar_t *s2)
+{
+    return std::wcscmp(s1, s2);
+}
+
+void PosixCatalogPlatform::toLower(wchar_t *str)
+{
+    for (; *str; ++str) {
+        *str = (wchar_t)std::towlower(*str);
+    }
+}
+
+bool PosixCatalogPlatform::isFavorite(const wchar_t *name)
+{
+    return _favorites.find(name) != _favorites.end();
+}
+
+//------------------------------------------------------------------------------
+
+PosixSettingsPlatform::PosixSettingsPlatform(const char *settingsFile)
+    : _settingsFile(settingsFile)
+{
+}
+
+bool PosixSettingsPlatform::readSettings(tXmlDoc &doc, bool *missing)
+{
+    struct stat st;
+
+    if (::stat(_settingsFile.c_str(), &st) != 0 && errno == ENOENT) {
+        *missing = true;
+        return true;
+    }
+    return doc.LoadFile(_settingsFile.c_str()) == kXmlSuccess;
+}
+
+bool PosixSettingsPlatform::writeSettings(tXmlDoc &doc)
+{
+    return doc.SaveFile(_settingsFile.c_str()) == kXmlSuccess;
+}
+
+//------------------------------------------------------------------------------
+
+/** Decodes UTF-8 src into dst, a buffer of dstLen wide chars. Invalid bytes
+    are decoded as U+FFFD.
+    @return false if dst is too small */
+bool utf8ToWide(const char *src, wchar_t *dst, size_t dstLen)
+{
+    const unsigned char *s = (const unsigned char*)src;
+    unsigned int cp;
+    int more;
+    size_t n = 0;
+
+    while (*s) {
+        if (n + 1 >= dstLen) {
+            return false;
+        }
+        if (*s < 0x80) {
+            cp = *s++;
+            more = 0;
+        }
+        else if ((*s & 0xE0) == 0xC0) {
+            cp = *s++ & 0x1F;
+            more = 1;
+        }
+        else if ((*s & 0xF0) == 0xE0) {
+            cp = *s++ & 0x0F;
+            more = 2;
+        }
+        else if ((*s & 0xF8) == 0xF0) {
+            cp = *s++ & 0x07;
+            more = 3;
+        }
+        else {
+            ++s;
+            cp = 0xFFFD;
+            more = 0;
+        }
+        while (more > 0 && (*s & 0xC0) == 0x80) {
+            cp = (cp << 6) | (*s++ & 0x3F);
+            --more;
+        }
+        dst[n++] = more > 0 ? 0xFFFD : (wchar_t)cp;
+    }
+    dst[n] = 0;
+    return true;
+}
+
+/** Appends src, a wide string, to dst encoded as UTF-8. */
+void wideToUtf8(const wchar_t *src, std::string &dst)
+{
+    unsigned int cp;
+
+    for (; *src; ++src) {
+        cp = (unsigned int)*src;
+        if (cp < 0x80) {
+            dst += (char)cp;
+        }
+        else if (cp < 0x800) {
+            dst += (char)(0xC0 | (cp >> 6));
+            dst += (char)(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000) {
+            dst += (char)(0xE0 | (cp >> 12));
+            dst += (char)(0x80 | ((cp >> 6) & 0x3F));
+            dst += (char)(0x80 | (cp & 0x3F));
+        }
+        else {
+            dst += (char)(0xF0 | (cp >> 18));
+            dst += (char)(0x80 | ((cp >> 12) & 0x3F));
+            dst += (char)(0x80 | ((cp >> 6) & 0x3F));
+            dst += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+}
+
+} // end namespace NppPlugin
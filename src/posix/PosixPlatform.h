@@ -0,0 +1,67 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      PosixPlatform.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    POSIX implementations of the core platform interfaces, used by the tests
+    and benchmarks that build the core outside Notepad++.
+*/
+
+#ifndef NPP_PLUGIN_POSIX_PLATFORM_H
+#define NPP_PLUGIN_POSIX_PLATFORM_H
+
+#include "../core/Catalog.h"
+#include "../core/SettingsStore.h"
+#include <set>
+#include <string>
+
+//------------------------------------------------------------------------------
+
+namespace NppPlugin {
+
+/// @class PosixCatalogPlatform Lists session files with opendir and readdir.
+/// Names are compared by code point, where the plugin uses lstrcmpW, and
+/// lower-cased with towlower, where it uses CharLowerW.
+class PosixCatalogPlatform : public CatalogPlatform
+{
+  public:
+    PosixCatalogPlatform(const char *sesDir, const char *sesExt);
+    void addFavorite(const wchar_t *name);
+    virtual bool listSessions(SessionCatalog &catalog);
+    virtual int compareNames(const wchar_t *s1, const wchar_t *s2);
+    virtual void toLower(wchar_t *str);
+    virtual bool isFavorite(const wchar_t *name);
+
+  private:
+    std::string _sesDir;
+    std::string _sesExt;
+    std::set<std::wstring> _favorites;
+};
+
+/// @class PosixSettingsPlatform Reads and writes a settings file with stdio.
+/// There is no file lock, where the plugin takes sys_lockFiles.
+class PosixSettingsPlatform : public SettingsPlatform
+{
+  public:
+    explicit PosixSettingsPlatform(const char *settingsFile);
+    virtual bool readSettings(tXmlDoc &doc, bool *missing);
+    virtual bool writeSettings(tXmlDoc &doc);
+
+  private:
+    std::string _settingsFile;
+};
+
+bool utf8ToWide(const char *src, wchar_t *dst, size_t dstLen);
+void wideToUtf8(const wchar_t *src, std::string &dst);
+
+} // end namespace NppPlugin
+
+#endif // NPP_PLUGIN_POSIX_PLATFORM_H
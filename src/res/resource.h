@@ -56,6 +56,7 @@
 #define IDC_CFG_BTN_BRW         1408
 #define IDC_CFG_ETX_DIR         1409
 #define IDC_CFG_ETX_EXT         1410
+#define IDC_CFG_BTN_STA         1411
 
 // Common sizes
 #define IDC_MAR_1               6
@@ -139,5 +140,7 @@
 #define IDC_CFG_BTN_OK_Y        (IDD_CFG_H - IDC_CFG_BTN_YBO)
 #define IDC_CFG_BTN_CAN_X       (IDD_CFG_W - IDC_CFG_BTN_CAN_XRO)
 #define IDC_CFG_BTN_CAN_Y       IDC_CFG_BTN_OK_Y
+#define IDC_CFG_BTN_STA_X       IDC_MAR_1
+#define IDC_CFG_BTN_STA_Y       IDC_CFG_BTN_OK_Y
 
 
@@ -8,6 +8,10 @@ typedef tinyxml2::XMLDocument  tXmlDoc;
 typedef tinyxml2::XMLDocument* tXmlDocP;
 typedef tinyxml2::XMLElement*  tXmlEleP;
 typedef tinyxml2::XMLError     tXmlError;
-const INT kXmlSuccess = tinyxml2::XML_SUCCESS;
+const int kXmlSuccess = tinyxml2::XML_SUCCESS;
+
+/** @return the interned copy of name, which element and attribute names are
+    compared with by pointer. Call only from static initializers. */
+inline const char* xmlIntern(const char *name) { return tinyxml2::XMLUtil::Intern(name); }
 
 #endif // NPP_PLUGIN_TINYXML_H
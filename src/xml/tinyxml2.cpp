@@ -2,6 +2,19 @@
 Original code by Lee Thomason (www.grinninglizard.com)
 
 Changes by Michael Foster (mfoster.com):
+- 2015-12-13: SaveFile fails with XML_ERROR_FILE_WRITE_ERROR if a write or the
+  close fails, instead of reporting success for a truncated file. '&' in text
+  is written as is, like in attribute values, instead of being dropped.
+- 2015-12-12: ScanFor is in XMLUtil, so it can be tested, and is a plain loop:
+  the SSE2 version was no faster at parsing a large global.xml. An unknown
+  entity after a converted one is copied instead of skipped.
+- 2015-12-11: XMLPrinter writes to a file through a large buffer, without the
+  printf family, and integers are formatted without it.
+- 2015-12-10: Added interned element and attribute names.
+- 2015-12-09: Text, attribute values and entities are scanned 16 bytes at a time
+  with SSE2 where available.
+- 2015-12-08: The wide char LoadFile reads with ReadFile on Windows.
+- 2015-12-07: Clear keeps the character buffer, and LoadFile and Parse reuse it.
 - 2014-10-31: Removed "amp" from the entities table.
 - 2014-10-29: Added wide char versions of LoadFile and SaveFile.
 
@@ -27,6 +40,10 @@ distribution.
 
 #include "tinyxml2.h"
 
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#endif
 #include <new>		// yes, this one new style header, is in the Android SDK.
 #   ifdef ANDROID_NDK
 #   include <stddef.h>
@@ -67,6 +84,41 @@ static const Entity entities[NUM_ENTITIES] = {
 };
 
 
+// Interned names. The table is written only by XMLUtil::Intern, before
+// documents are used, so lookups need no locking.
+static const int INTERN_MAX      = 64;
+static const int INTERN_SLOTS    = 128;	// a power of 2, at least twice INTERN_MAX
+static const int INTERN_POOL_LEN = 2048;
+static char        internPool[INTERN_POOL_LEN];
+static int         internPoolUsed = 0;
+static const char* internSlots[INTERN_SLOTS];
+static int         internCount = 0;
+
+static inline bool IsInterned( const char* p )
+{
+    return p >= internPool && p < internPool + INTERN_POOL_LEN;
+}
+
+static unsigned HashName( const char* p, size_t len )
+{
+    unsigned hash = 2166136261U;	// FNV-1a
+    for ( size_t i = 0; i < len; ++i ) {
+        hash ^= static_cast<unsigned char>( p[i] );
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+
+char* XMLUtil::ScanFor( char* p, char a, char b, char c )
+{
+    while ( *p && *p != a && *p != b && *p != c ) {
+        ++p;
+    }
+    return p;
+}
+
+
 StrPair::~StrPair()
 {
     Reset();
@@ -104,14 +156,17 @@ char* StrPair::ParseText( char* p, const char* endTag, int strFlags )
     size_t length = strlen( endTag );
 
     // Inner loop of text parsing.
-    while ( *p ) {
-        if ( *p == endChar && strncmp( p, endTag, length ) == 0 ) {
+    for ( ;; ) {
+        p = XMLUtil::ScanFor( p, endChar, 0, 0 );
+        if ( !*p ) {
+            return 0;
+        }
+        if ( strncmp( p, endTag, length ) == 0 ) {
             Set( start, p, strFlags );
             return p + length;
         }
         ++p;
     }
-    return 0;
 }
 
 
@@ -128,7 +183,13 @@ char* StrPair::ParseName( char* p )
     }
 
     if ( p > start ) {
-        Set( start, p, 0 );
+        const char* interned = XMLUtil::FindInterned( start, p - start );
+        if ( interned ) {
+            SetInternedStr( interned );
+        }
+        else {
+            Set( start, p, 0 );
+        }
         return p;
     }
     return 0;
@@ -171,8 +232,11 @@ const char* StrPair::GetStr()
         _flags ^= NEEDS_FLUSH;
 
         if ( _flags ) {
-            char* p = _start;	// the read pointer
-            char* q = _start;	// the write pointer
+            // Nothing before the first CR, LF or '&' that needs processing
+            // changes, so skip to it. Most strings have none.
+            const char nl = ( _flags & NEEDS_NEWLINE_NORMALIZATION ) ? LF : 0;
+            char* p = XMLUtil::ScanFor( _start, nl ? CR : 0, nl, ( _flags & NEEDS_ENTITY_PROCESSING ) ? '&' : 0 );	// the read pointer
+            char* q = p;	// the write pointer
 
             while( p < _end ) {
                 if ( (_flags & NEEDS_NEWLINE_NORMALIZATION) && *p == CR ) {
@@ -226,8 +290,8 @@ const char* StrPair::GetStr()
                         }
                         if ( i == NUM_ENTITIES ) {
                             // fixme: treat as error?
-                            ++p;
-                            ++q;
+                            // Copied, since q is behind p after an earlier entity.
+                            *q++ = *p++;
                         }
                     }
                 }
@@ -254,6 +318,59 @@ const char* StrPair::GetStr()
 
 // --------- XMLUtil ----------- //
 
+const char* XMLUtil::Intern( const char* name )
+{
+    const size_t len = strlen( name );
+    const char* interned = FindInterned( name, len );
+    if ( interned ) {
+        return interned;
+    }
+    if ( internCount >= INTERN_MAX || len + 1 > static_cast<size_t>( INTERN_POOL_LEN - internPoolUsed ) ) {
+        return name;
+    }
+    char* copy = internPool + internPoolUsed;
+    memcpy( copy, name, len + 1 );
+    internPoolUsed += static_cast<int>( len + 1 );
+    unsigned slot = HashName( name, len ) & ( INTERN_SLOTS - 1 );
+    while ( internSlots[slot] ) {
+        slot = ( slot + 1 ) & ( INTERN_SLOTS - 1 );
+    }
+    internSlots[slot] = copy;
+    ++internCount;
+    return copy;
+}
+
+
+const char* XMLUtil::FindInterned( const char* p, size_t len )
+{
+    if ( internCount == 0 ) {
+        return 0;
+    }
+    unsigned slot = HashName( p, len ) & ( INTERN_SLOTS - 1 );
+    while ( internSlots[slot] ) {
+        const char* name = internSlots[slot];
+        if ( strncmp( name, p, len ) == 0 && name[len] == 0 ) {
+            return name;
+        }
+        slot = ( slot + 1 ) & ( INTERN_SLOTS - 1 );
+    }
+    return 0;
+}
+
+
+bool XMLUtil::NameEqual( const char* p, const char* q )
+{
+    if ( p == q ) {
+        return true;
+    }
+    // Equal interned names are always the same pointer.
+    if ( IsInterned( p ) && IsInterned( q ) ) {
+        return false;
+    }
+    return StringEqual( p, q );
+}
+
+
 const char* XMLUtil::ReadBOM( const char* p, bool* bom )
 {
     *bom = false;
@@ -395,15 +512,38 @@ const char* XMLUtil::GetCharacterRef( const char* p, char* value, int* length )
 }
 
 
+// Formats v, preceded by a minus sign if negative, like snprintf but without
+// parsing a format. Integers are formatted for every one set or printed.
+static void UnsignedToStr( unsigned v, bool negative, char* buffer, int bufferSize )
+{
+    char digits[12];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>( '0' + v % 10 );
+        v /= 10;
+    } while ( v );
+    if ( negative ) {
+        digits[n++] = '-';
+    }
+    int i = 0;
+    while ( n > 0 && i < bufferSize - 1 ) {
+        buffer[i++] = digits[--n];
+    }
+    if ( bufferSize > 0 ) {
+        buffer[i] = 0;
+    }
+}
+
+
 void XMLUtil::ToStr( int v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%d", v );
+    UnsignedToStr( v < 0 ? 0U - static_cast<unsigned>( v ) : static_cast<unsigned>( v ), v < 0, buffer, bufferSize );
 }
 
 
 void XMLUtil::ToStr( unsigned v, char* buffer, int bufferSize )
 {
-    TIXML_SNPRINTF( buffer, bufferSize, "%u", v );
+    UnsignedToStr( v, false, buffer, bufferSize );
 }
 
 
@@ -735,7 +875,7 @@ const XMLElement* XMLNode::FirstChildElement( const char* value ) const
     for( XMLNode* node=_firstChild; node; node=node->_next ) {
         XMLElement* element = node->ToElement();
         if ( element ) {
-            if ( !value || XMLUtil::StringEqual( element->Name(), value ) ) {
+            if ( !value || XMLUtil::NameEqual( element->Name(), value ) ) {
                 return element;
             }
         }
@@ -749,7 +889,7 @@ const XMLElement* XMLNode::LastChildElement( const char* value ) const
     for( XMLNode* node=_lastChild; node; node=node->_prev ) {
         XMLElement* element = node->ToElement();
         if ( element ) {
-            if ( !value || XMLUtil::StringEqual( element->Name(), value ) ) {
+            if ( !value || XMLUtil::NameEqual( element->Name(), value ) ) {
                 return element;
             }
         }
@@ -763,7 +903,7 @@ const XMLElement* XMLNode::NextSiblingElement( const char* value ) const
     for( XMLNode* node=this->_next; node; node = node->_next ) {
         const XMLElement* element = node->ToElement();
         if ( element
-                && (!value || XMLUtil::StringEqual( value, node->Value() ))) {
+                && (!value || XMLUtil::NameEqual( value, node->Value() ))) {
             return element;
         }
     }
@@ -776,7 +916,7 @@ const XMLElement* XMLNode::PreviousSiblingElement( const char* value ) const
     for( XMLNode* node=_prev; node; node = node->_prev ) {
         const XMLElement* element = node->ToElement();
         if ( element
-                && (!value || XMLUtil::StringEqual( value, node->Value() ))) {
+                && (!value || XMLUtil::NameEqual( value, node->Value() ))) {
             return element;
         }
     }
@@ -845,7 +985,7 @@ char* XMLNode::ParseDeep( char* p, StrPair* parentEnd )
                 p = 0;
             }
             else if ( !endTag.Empty() ) {
-                if ( !XMLUtil::StringEqual( endTag.GetStr(), node->Value() )) {
+                if ( !XMLUtil::NameEqual( endTag.GetStr(), node->Value() )) {
                     _document->SetError( XML_ERROR_MISMATCHED_ELEMENT, node->Value(), 0 );
                     p = 0;
                 }
@@ -1108,7 +1248,13 @@ char* XMLAttribute::ParseDeep( char* p, bool processEntities )
 
 void XMLAttribute::SetName( const char* n )
 {
-    _name.SetStr( n );
+    const char* interned = XMLUtil::FindInterned( n, strlen( n ) );
+    if ( interned ) {
+        _name.SetInternedStr( interned );
+    }
+    else {
+        _name.SetStr( n );
+    }
 }
 
 
@@ -1222,7 +1368,7 @@ XMLElement::~XMLElement()
 XMLAttribute* XMLElement::FindAttribute( const char* name )
 {
     for( XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
-        if ( XMLUtil::StringEqual( a->Name(), name ) ) {
+        if ( XMLUtil::NameEqual( a->Name(), name ) ) {
             return a;
         }
     }
@@ -1233,7 +1379,7 @@ XMLAttribute* XMLElement::FindAttribute( const char* name )
 const XMLAttribute* XMLElement::FindAttribute( const char* name ) const
 {
     for( XMLAttribute* a = _rootAttribute; a; a = a->_next ) {
-        if ( XMLUtil::StringEqual( a->Name(), name ) ) {
+        if ( XMLUtil::NameEqual( a->Name(), name ) ) {
             return a;
         }
     }
@@ -1387,7 +1533,7 @@ XMLAttribute* XMLElement::FindOrCreateAttribute( const char* name )
     for( attrib = _rootAttribute;
             attrib;
             last = attrib, attrib = attrib->_next ) {
-        if ( XMLUtil::StringEqual( attrib->Name(), name ) ) {
+        if ( XMLUtil::NameEqual( attrib->Name(), name ) ) {
             break;
         }
     }
@@ -1411,7 +1557,7 @@ void XMLElement::DeleteAttribute( const char* name )
 {
     XMLAttribute* prev = 0;
     for( XMLAttribute* a=_rootAttribute; a; a=a->_next ) {
-        if ( XMLUtil::StringEqual( name, a->Name() ) ) {
+        if ( XMLUtil::NameEqual( name, a->Name() ) ) {
             if ( prev ) {
                 prev->_next = a->_next;
             }
@@ -1602,7 +1748,8 @@ const char* XMLDocument::_errorNames[XML_ERROR_COUNT] = {
     "XML_ERROR_MISMATCHED_ELEMENT",
     "XML_ERROR_PARSING",
     "XML_CAN_NOT_CONVERT_TEXT",
-    "XML_NO_TEXT_NODE"
+    "XML_NO_TEXT_NODE",
+    "XML_ERROR_FILE_WRITE_ERROR"
 };
 
 
@@ -1614,7 +1761,8 @@ XMLDocument::XMLDocument( bool processEntities, Whitespace whitespace ) :
     _whitespace( whitespace ),
     _errorStr1( 0 ),
     _errorStr2( 0 ),
-    _charBuffer( 0 )
+    _charBuffer( 0 ),
+    _charBufferSize( 0 )
 {
     _document = this;	// avoid warning about 'this' in initializer list
 }
@@ -1650,9 +1798,19 @@ void XMLDocument::Clear()
     _errorID = XML_NO_ERROR;
     _errorStr1 = 0;
     _errorStr2 = 0;
+}
 
-    delete [] _charBuffer;
-    _charBuffer = 0;
+
+// Returns a buffer of at least size bytes, reusing the current one if it is
+// large enough.
+char* XMLDocument::ReserveCharBuffer( size_t size )
+{
+    if ( size > _charBufferSize ) {
+        delete [] _charBuffer;
+        _charBuffer = new char[size];
+        _charBufferSize = size;
+    }
+    return _charBuffer;
 }
 
 
@@ -1714,6 +1872,8 @@ static FILE* callfopen( const char* filepath, const char* mode )
     return fp;
 }
 
+// The wide-character file API is only available on Windows.
+#ifdef _WIN32
 static FILE* callfopen( const wchar_t* filepath, const wchar_t* mode )
 {
     FILE* fp = 0;
@@ -1723,6 +1883,7 @@ static FILE* callfopen( const wchar_t* filepath, const wchar_t* mode )
     }
     return fp;
 }
+#endif
 
 XMLError XMLDocument::LoadFile( const char* filename )
 {
@@ -1737,19 +1898,61 @@ XMLError XMLDocument::LoadFile( const char* filename )
     return _errorID;
 }
 
+#ifdef _WIN32
+
+// Reads the file with one ReadFile call directly into the reused character
+// buffer, without the stdio buffer and seeks. The file is not memory-mapped:
+// the caller often rewrites it while the parsed tree, which points into the
+// buffer, is still alive, and a mapped file cannot be truncated.
 XMLError XMLDocument::LoadFile( const wchar_t* filename )
 {
     Clear();
-    FILE* fp = callfopen( filename, L"rb" );
-    if ( !fp ) {
+    // Share like _wfopen does, so a writer or a rename of the file does not
+    // fail while it is being read.
+    HANDLE hFile = CreateFileW( filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0 );
+    if ( hFile == INVALID_HANDLE_VALUE ) {
         SetError( XML_ERROR_FILE_NOT_FOUND, 0, 0 );
         return _errorID;
     }
-    LoadFile( fp );
-    fclose( fp );
+    LARGE_INTEGER filelength;
+    if ( !GetFileSizeEx( hFile, &filelength ) || filelength.HighPart != 0 || filelength.LowPart >= 0x7FFFFFFF ) {
+        CloseHandle( hFile );
+        SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
+        return _errorID;
+    }
+    const DWORD size = filelength.LowPart;
+    if ( size == 0 ) {
+        CloseHandle( hFile );
+        SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0 );
+        return _errorID;
+    }
+
+    ReserveCharBuffer( size+1 );
+    DWORD read = 0;
+    BOOL ok = ReadFile( hFile, _charBuffer, size, &read, 0 );
+    CloseHandle( hFile );
+    if ( !ok || read != size ) {
+        SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
+        return _errorID;
+    }
+
+    _charBuffer[size] = 0;
+
+    const char* p = _charBuffer;
+    p = XMLUtil::SkipWhiteSpace( p );
+    p = XMLUtil::ReadBOM( p, &_writeBOM );
+    if ( !p || !*p ) {
+        SetError( XML_ERROR_EMPTY_DOCUMENT, 0, 0 );
+        return _errorID;
+    }
+
+    ParseDeep( _charBuffer + (p-_charBuffer), 0 );
     return _errorID;
 }
 
+#endif
+
 XMLError XMLDocument::LoadFile( FILE* fp )
 {
     Clear();
@@ -1774,7 +1977,7 @@ XMLError XMLDocument::LoadFile( FILE* fp )
         return _errorID;
     }
 
-    _charBuffer = new char[size+1];
+    ReserveCharBuffer( size+1 );
     size_t read = fread( _charBuffer, 1, size, fp );
     if ( read != size ) {
         SetError( XML_ERROR_FILE_READ_ERROR, 0, 0 );
@@ -1804,10 +2007,13 @@ XMLError XMLDocument::SaveFile( const char* filename, bool compact )
         return _errorID;
     }
     SaveFile(fp, compact);
-    fclose( fp );
+    if ( fclose( fp ) != 0 && _errorID == XML_SUCCESS ) {
+        SetError( XML_ERROR_FILE_WRITE_ERROR, 0, 0 );
+    }
     return _errorID;
 }
 
+#ifdef _WIN32
 XMLError XMLDocument::SaveFile( const wchar_t* filename, bool compact )
 {
     FILE* fp = callfopen( filename, L"w" );
@@ -1816,15 +2022,21 @@ XMLError XMLDocument::SaveFile( const wchar_t* filename, bool compact )
         return _errorID;
     }
     SaveFile(fp, compact);
-    fclose( fp );
+    if ( fclose( fp ) != 0 && _errorID == XML_SUCCESS ) {
+        SetError( XML_ERROR_FILE_WRITE_ERROR, 0, 0 );
+    }
     return _errorID;
 }
+#endif
 
 
 XMLError XMLDocument::SaveFile( FILE* fp, bool compact )
 {
     XMLPrinter stream( fp, compact );
     Print( &stream );
+    if ( !stream.Flush() || ferror( fp ) ) {
+        SetError( XML_ERROR_FILE_WRITE_ERROR, 0, 0 );
+    }
     return _errorID;
 }
 
@@ -1841,7 +2053,7 @@ XMLError XMLDocument::Parse( const char* p, size_t len )
     if ( len == (size_t)(-1) ) {
         len = strlen( p );
     }
-    _charBuffer = new char[ len+1 ];
+    ReserveCharBuffer( len+1 );
     memcpy( _charBuffer, p, len );
     _charBuffer[len] = 0;
 
@@ -1908,8 +2120,14 @@ XMLPrinter::XMLPrinter( FILE* file, bool compact, int depth ) :
     _depth( depth ),
     _textDepth( -1 ),
     _processEntities( true ),
-    _compactMode( compact )
+    _compactMode( compact ),
+    _out( 0 ),
+    _outLen( 0 ),
+    _writeError( false )
 {
+    if ( _fp ) {
+        _out = new char[OUT_SIZE];
+    }
     for( int i=0; i<ENTITY_RANGE; ++i ) {
         _entityFlag[i] = false;
         _restrictedEntityFlag[i] = false;
@@ -1927,15 +2145,53 @@ XMLPrinter::XMLPrinter( FILE* file, bool compact, int depth ) :
 }
 
 
-void XMLPrinter::Print( const char* format, ... )
+XMLPrinter::~XMLPrinter()
 {
-    va_list     va;
-    va_start( va, format );
+    Flush();
+    delete [] _out;
+}
+
 
+bool XMLPrinter::Flush()
+{
+    if ( _fp && _outLen > 0 ) {
+        if ( !_writeError && fwrite( _out, 1, _outLen, _fp ) != _outLen ) {
+            _writeError = true;
+        }
+        _outLen = 0;
+    }
+    return !_writeError;
+}
+
+
+void XMLPrinter::Write( const char* data, size_t size )
+{
     if ( _fp ) {
-        vfprintf( _fp, format, va );
+        if ( _outLen + size > OUT_SIZE ) {
+            Flush();
+            if ( size > OUT_SIZE ) {
+                if ( !_writeError && fwrite( data, 1, size, _fp ) != size ) {
+                    _writeError = true;
+                }
+                return;
+            }
+        }
+        memcpy( _out + _outLen, data, size );
+        _outLen += size;
     }
     else {
+        char* p = _buffer.PushArr( static_cast<int>( size ) ) - 1;	// back up over the null terminator.
+        memcpy( p, data, size );
+        p[size] = 0;
+    }
+}
+
+
+void XMLPrinter::Print( const char* format, ... )
+{
+    va_list     va;
+    va_start( va, format );
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1400 )
 		#if defined(WINCE)
 		int len = 512;
@@ -1951,10 +2207,14 @@ void XMLPrinter::Print( const char* format, ... )
 #else
         int len = vsnprintf( 0, 0, format, va );
 #endif
-        // Close out and re-start the va-args
-        va_end( va );
-        va_start( va, format );
-        char* p = _buffer.PushArr( len ) - 1;	// back up over the null terminator.
+    // Close out and re-start the va-args
+    va_end( va );
+    if ( len < 0 ) {
+        return;
+    }
+    va_start( va, format );
+    char small[BUF_SIZE];
+    char* p = len < BUF_SIZE ? small : new char[len+1];
 #if defined(_MSC_VER) && (_MSC_VER >= 1400 )
 		#if defined(WINCE)
 		_vsnprintf( p, len+1, format, va );
@@ -1964,15 +2224,18 @@ void XMLPrinter::Print( const char* format, ... )
 #else
 		vsnprintf( p, len+1, format, va );
 #endif
-    }
     va_end( va );
+    Write( p, len );
+    if ( p != small ) {
+        delete [] p;
+    }
 }
 
 
 void XMLPrinter::PrintSpace( int depth )
 {
     for( int i=0; i<depth; ++i ) {
-        Print( "    " );
+        Write( "    ", 4 );
     }
 }
 
@@ -1987,31 +2250,34 @@ void XMLPrinter::PrintString( const char* p, bool restricted )
         while ( *q ) {
             // Remember, char is sometimes signed. (How many times has that bitten me?)
             if ( *q > 0 && *q < ENTITY_RANGE ) {
-                // Check for entities. If one is found, flush
-                // the stream up until the entity, write the
-                // entity, and keep looking.
+                // Check for entities. If one is found, write the run
+                // up until the entity, write the entity, and keep looking.
                 if ( flag[(unsigned)(*q)] ) {
-                    while ( p < q ) {
-                        Print( "%c", *p );
-                        ++p;
-                    }
-                    for( int i=0; i<NUM_ENTITIES; ++i ) {
+                    Write( p, q - p );
+                    int i = 0;
+                    for( ; i<NUM_ENTITIES; ++i ) {
                         if ( entities[i].value == *q ) {
-                            Print( "&%s;", entities[i].pattern );
+                            Write( "&", 1 );
+                            Write( entities[i].pattern, entities[i].length );
+                            Write( ";", 1 );
                             break;
                         }
                     }
-                    ++p;
+                    if ( i == NUM_ENTITIES ) {
+                        Write( q, 1 );	// '&', since "amp" is not in the table
+                    }
+                    p = q + 1;
                 }
             }
             ++q;
         }
     }
-    // Flush the remaining string. This will be the entire
-    // string if an entity wasn't found.
-    if ( !_processEntities || (q-p > 0) ) {
-        Print( "%s", p );
+    else {
+        q = p + strlen( p );
     }
+    // Write the remaining string. This will be the entire
+    // string if an entity wasn't found.
+    Write( p, q - p );
 }
 
 
@@ -2019,7 +2285,7 @@ void XMLPrinter::PushHeader( bool writeBOM, bool writeDec )
 {
     if ( writeBOM ) {
         static const unsigned char bom[] = { TIXML_UTF_LEAD_0, TIXML_UTF_LEAD_1, TIXML_UTF_LEAD_2, 0 };
-        Print( "%s", bom );
+        Write( reinterpret_cast<const char*>( bom ), 3 );
     }
     if ( writeDec ) {
         PushDeclaration( "xml version=\"1.0\"" );
@@ -2035,13 +2301,14 @@ void XMLPrinter::OpenElement( const char* name, bool compactMode )
     _stack.Push( name );
 
     if ( _textDepth < 0 && !_firstElement && !compactMode ) {
-        Print( "\n" );
+        Write( "\n", 1 );
     }
     if ( !compactMode ) {
         PrintSpace( _depth );
     }
 
-    Print( "<%s", name );
+    Write( "<", 1 );
+    Write( name );
     _elementJustOpened = true;
     _firstElement = false;
     ++_depth;
@@ -2051,9 +2318,11 @@ void XMLPrinter::OpenElement( const char* name, bool compactMode )
 void XMLPrinter::PushAttribute( const char* name, const char* value )
 {
     TIXMLASSERT( _elementJustOpened );
-    Print( " %s=\"", name );
+    Write( " ", 1 );
+    Write( name );
+    Write( "=\"", 2 );
     PrintString( value, false );
-    Print( "\"" );
+    Write( "\"", 1 );
 }
 
 
@@ -2095,21 +2364,23 @@ void XMLPrinter::CloseElement( bool compactMode )
     const char* name = _stack.Pop();
 
     if ( _elementJustOpened ) {
-        Print( "/>" );
+        Write( "/>", 2 );
     }
     else {
         if ( _textDepth < 0 && !compactMode) {
-            Print( "\n" );
+            Write( "\n", 1 );
             PrintSpace( _depth );
         }
-        Print( "</%s>", name );
+        Write( "</", 2 );
+        Write( name );
+        Write( ">", 1 );
     }
 
     if ( _textDepth == _depth ) {
         _textDepth = -1;
     }
     if ( _depth == 0 && !compactMode) {
-        Print( "\n" );
+        Write( "\n", 1 );
     }
     _elementJustOpened = false;
 }
@@ -2118,7 +2389,7 @@ void XMLPrinter::CloseElement( bool compactMode )
 void XMLPrinter::SealElement()
 {
     _elementJustOpened = false;
-    Print( ">" );
+    Write( ">", 1 );
 }
 
 
@@ -2130,9 +2401,9 @@ void XMLPrinter::PushText( const char* text, bool cdata )
         SealElement();
     }
     if ( cdata ) {
-        Print( "<![CDATA[" );
-        Print( "%s", text );
-        Print( "]]>" );
+        Write( "<![CDATA[", 9 );
+        Write( text );
+        Write( "]]>", 3 );
     }
     else {
         PrintString( text, true );
@@ -2185,11 +2456,13 @@ void XMLPrinter::PushComment( const char* comment )
         SealElement();
     }
     if ( _textDepth < 0 && !_firstElement && !_compactMode) {
-        Print( "\n" );
+        Write( "\n", 1 );
         PrintSpace( _depth );
     }
     _firstElement = false;
-    Print( "<!--%s-->", comment );
+    Write( "<!--", 4 );
+    Write( comment );
+    Write( "-->", 3 );
 }
 
 
@@ -2199,11 +2472,13 @@ void XMLPrinter::PushDeclaration( const char* value )
         SealElement();
     }
     if ( _textDepth < 0 && !_firstElement && !_compactMode) {
-        Print( "\n" );
+        Write( "\n", 1 );
         PrintSpace( _depth );
     }
     _firstElement = false;
-    Print( "<?%s?>", value );
+    Write( "<?", 2 );
+    Write( value );
+    Write( "?>", 2 );
 }
 
 
@@ -2213,11 +2488,13 @@ void XMLPrinter::PushUnknown( const char* value )
         SealElement();
     }
     if ( _textDepth < 0 && !_firstElement && !_compactMode) {
-        Print( "\n" );
+        Write( "\n", 1 );
         PrintSpace( _depth );
     }
     _firstElement = false;
-    Print( "<!%s>", value );
+    Write( "<!", 2 );
+    Write( value );
+    Write( ">", 1 );
 }
 
 
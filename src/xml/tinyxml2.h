@@ -506,6 +506,7 @@ enum XMLError {
     XML_ERROR_PARSING,
     XML_CAN_NOT_CONVERT_TEXT,
     XML_NO_TEXT_NODE,
+    XML_ERROR_FILE_WRITE_ERROR,
 
 	XML_ERROR_COUNT
 };
@@ -518,21 +519,22 @@ class XMLUtil
 {
 public:
     // Anything in the high order range of UTF-8 is assumed to not be whitespace. This isn't
-    // correct, but simple, and usually works.
+    // correct, but simple, and usually works. Whitespace is what isspace accepts in the
+    // "C" locale, tested directly since this is in the inner loop of parsing.
     static const char* SkipWhiteSpace( const char* p )	{
-        while( !IsUTF8Continuation(*p) && isspace( *reinterpret_cast<const unsigned char*>(p) ) ) {
+        while( IsWhiteSpace( *p ) ) {
             ++p;
         }
         return p;
     }
     static char* SkipWhiteSpace( char* p )				{
-        while( !IsUTF8Continuation(*p) && isspace( *reinterpret_cast<unsigned char*>(p) ) )		{
+        while( IsWhiteSpace( *p ) )		{
             ++p;
         }
         return p;
     }
     static bool IsWhiteSpace( char p )					{
-        return !IsUTF8Continuation(p) && isspace( static_cast<unsigned char>(p) );
+        return p == ' ' || ( p >= '\t' && p <= '\r' );
     }
     
     inline static bool IsNameStartChar( unsigned char ch ) {
@@ -568,6 +570,22 @@ public:
         return p & 0x80;
     }
 
+    // Registers name and returns the interned copy of it. Element and attribute
+    // names equal to an interned name, whether parsed or set, point to the
+    // interned copy, so comparing with it is a pointer comparison. Not thread
+    // safe: names must be interned before documents are used, typically by
+    // static initializers. If the table is full, name is returned unchanged
+    // and still compares correctly.
+    static const char* Intern( const char* name );
+    // Returns the interned copy of the len characters at p, or null.
+    static const char* FindInterned( const char* p, size_t len );
+    // StringEqual for element and attribute names.
+    static bool NameEqual( const char* p, const char* q );
+
+    // Returns a pointer to the first character at or after p that is a, b or c,
+    // or to the terminating null. Pass 0 for a character that is not needed.
+    static char* ScanFor( char* p, char a, char b, char c );
+
     static const char* ReadBOM( const char* p, bool* hasBOM );
     // p is the starting location,
     // the UTF-8 value of the entity will be placed in value, and length filled in.
@@ -1144,7 +1162,13 @@ public:
     }
     /// Set the name of the element.
     void SetName( const char* str, bool staticMem=false )	{
-        SetValue( str, staticMem );
+        const char* interned = XMLUtil::FindInterned( str, strlen( str ) );
+        if ( interned ) {
+            SetValue( interned, true );
+        }
+        else {
+            SetValue( str, staticMem );
+        }
     }
 
     virtual XMLElement* ToElement()				{
@@ -1539,31 +1563,38 @@ public:
     	an errorID.
     */
     XMLError LoadFile( const char* filename );
+#ifdef _WIN32
     XMLError LoadFile( const wchar_t* filename );
+#endif
 
     /**
     	Load an XML file from disk. You are responsible
     	for providing and closing the FILE*.
 
     	Returns XML_NO_ERROR (0) on success, or
-    	an errorID.
+    	an errorID, XML_ERROR_FILE_WRITE_ERROR if a write
+    	failed.
     */
     XMLError LoadFile( FILE* );
 
     /**
     	Save the XML file to disk.
     	Returns XML_NO_ERROR (0) on success, or
-    	an errorID.
+    	an errorID, XML_ERROR_FILE_WRITE_ERROR if a write
+    	or closing the file failed.
     */
     XMLError SaveFile( const char* filename, bool compact = false );
+#ifdef _WIN32
     XMLError SaveFile( const wchar_t* filename, bool compact = false );
+#endif
 
     /**
     	Save the XML file to disk. You are responsible
     	for providing and closing the FILE*.
 
     	Returns XML_NO_ERROR (0) on success, or
-    	an errorID.
+    	an errorID, XML_ERROR_FILE_WRITE_ERROR if a write
+    	failed.
     */
     XMLError SaveFile( FILE* fp, bool compact = false );
 
@@ -1681,7 +1712,10 @@ public:
     /// If there is an error, print it to stdout.
     void PrintError() const;
     
-    /// Clear the document, resetting it to the initial state.
+    /** Clear the document, resetting it to the initial state. The memory
+        pools and the character buffer are kept, so a document that is
+        loaded repeatedly does not allocate again once it is large enough.
+    */
     void Clear();
 
     // internal
@@ -1698,6 +1732,8 @@ private:
     XMLDocument( const XMLDocument& );	// not supported
     void operator=( const XMLDocument& );	// not supported
 
+    char* ReserveCharBuffer( size_t size );
+
     bool        _writeBOM;
     bool        _processEntities;
     XMLError    _errorID;
@@ -1705,6 +1741,7 @@ private:
     const char* _errorStr1;
     const char* _errorStr2;
     char*       _charBuffer;
+    size_t      _charBufferSize;
 
     MemPoolT< sizeof(XMLElement) >	 _elementPool;
     MemPoolT< sizeof(XMLAttribute) > _attributePool;
@@ -1971,7 +2008,14 @@ public:
     	with only required whitespace and newlines.
     */
     XMLPrinter( FILE* file=0, bool compact = false, int depth = 0 );
-    virtual ~XMLPrinter()	{}
+    virtual ~XMLPrinter();
+
+    /** If printing to a FILE, write any buffered output to it. This is done
+        by the destructor, so it is only needed to use the FILE before then,
+        or to check for errors. Returns false if any write to the FILE was
+        short, after which nothing more is written.
+    */
+    bool Flush();
 
     /** If streaming, write the BOM and declaration. */
     void PushHeader( bool writeBOM, bool writeDeclaration );
@@ -2052,12 +2096,19 @@ protected:
 	*/
     virtual void PrintSpace( int depth );
     void Print( const char* format, ... );
+    void Write( const char* data, size_t size );
+    void Write( const char* str )	{
+        Write( str, strlen( str ) );
+    }
 
 	void SealElement();
     bool _elementJustOpened;
     DynArray< const char*, 10 > _stack;
 
 private:
+    XMLPrinter( const XMLPrinter& );	// not supported
+    void operator=( const XMLPrinter& );	// not supported
+
     void PrintString( const char*, bool restrictedEntitySet );	// prints out, after detecting entities.
 
     bool _firstElement;
@@ -2069,12 +2120,16 @@ private:
 
     enum {
         ENTITY_RANGE = 64,
-        BUF_SIZE = 200
+        BUF_SIZE = 200,
+        OUT_SIZE = 64*1024	// file output is written in chunks of this size
     };
     bool _entityFlag[ENTITY_RANGE];
     bool _restrictedEntityFlag[ENTITY_RANGE];
 
     DynArray< char, 20 > _buffer;
+    char*  _out;		// file output not yet written
+    size_t _outLen;
+    bool   _writeError;	// a write to _fp was short
 };
 
 
@@ -0,0 +1,331 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      CatalogTest.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "Test.h"
+#include "../src/core/Catalog.h"
+#include "../src/posix/PosixPlatform.h"
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+using namespace NppPlugin;
+
+TEST_FAILURES;
+
+namespace {
+
+/// Lists a fixed set of sessions.
+class FakePlatform : public CatalogPlatform
+{
+  public:
+    std::vector<std::wstring> names;
+    std::vector<unsigned long long> times;
+    std::vector<std::wstring> favorites;
+    bool readable;
+
+    FakePlatform() : readable(true) {}
+    void addSession(const wchar_t *name, unsigned long long modified)
+    {
+        names.push_back(name);
+        times.push_back(modified);
+    }
+    virtual bool listSessions(SessionCatalog &catalog)
+    {
+        for (size_t i = 0; i < names.size(); ++i) {
+            catalog.add(names[i].c_str(), times[i]);
+        }
+        return readable;
+    }
+    virtual int compareNames(const wchar_t *s1, const wchar_t *s2)
+    {
+        return std::wcscmp(s1, s2);
+    }
+    virtual void toLower(wchar_t *str)
+    {
+        for (; *str; ++str) {
+            *str = (wchar_t)std::towlower(*str);
+        }
+    }
+    virtual bool isFavorite(const wchar_t *name)
+    {
+        for (size_t i = 0; i < favorites.size(); ++i) {
+            if (favorites[i] == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+void writeFile(const std::string &path, time_t mtime)
+{
+    struct utimbuf times;
+    FILE *fp = std::fopen(path.c_str(), "wb");
+    if (fp) {
+        std::fputs("<NotepadPlus />\n", fp);
+        std::fclose(fp);
+    }
+    times.actime = mtime;
+    times.modtime = mtime;
+    ::utime(path.c_str(), &times);
+}
+
+} // end namespace
+
+TEST(readSortsAlphabetically)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"web", 3);
+    platform.addSession(L"Default", 1);
+    platform.addSession(L"docs", 2);
+    CHECK(catalog.read(platform, true));
+    CHECK_EQ(3, catalog.size());
+    CHECK(std::wcscmp(catalog[0].name, L"Default") == 0);
+    CHECK(std::wcscmp(catalog[1].name, L"docs") == 0);
+    CHECK(std::wcscmp(catalog[2].name, L"web") == 0);
+}
+
+TEST(readSortsByDateThenName)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"b", 5);
+    platform.addSession(L"old", 1);
+    platform.addSession(L"a", 5);
+    platform.addSession(L"new", 9);
+    CHECK(catalog.read(platform, false));
+    CHECK(std::wcscmp(catalog[0].name, L"new") == 0);
+    CHECK(std::wcscmp(catalog[1].name, L"a") == 0);
+    CHECK(std::wcscmp(catalog[2].name, L"b") == 0);
+    CHECK(std::wcscmp(catalog[3].name, L"old") == 0);
+}
+
+TEST(readIndexesSessions)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"c", 0);
+    platform.addSession(L"a", 0);
+    platform.addSession(L"b", 0);
+    catalog.read(platform, true);
+    for (int si = 0; si < catalog.size(); ++si) {
+        CHECK_EQ(si, catalog[si].index);
+        CHECK_EQ(si, catalog.find(catalog[si].name));
+    }
+}
+
+TEST(readMarksFavorites)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"a", 0);
+    platform.addSession(L"b", 0);
+    platform.favorites.push_back(L"b");
+    catalog.read(platform, true);
+    CHECK(!catalog[0].isFavorite);
+    CHECK(catalog[1].isFavorite);
+}
+
+TEST(readReplacesPreviousSessions)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"a", 0);
+    catalog.read(platform, true);
+    platform.names[0] = L"z";
+    catalog.read(platform, true);
+    CHECK_EQ(1, catalog.size());
+    CHECK_EQ(-1, catalog.find(L"a"));
+    CHECK_EQ(0, catalog.find(L"z"));
+}
+
+TEST(readReportsUnreadableDirectory)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.readable = false;
+    CHECK(!catalog.read(platform, true));
+    CHECK(catalog.empty());
+    CHECK_EQ(-1, catalog.find(L"a"));
+}
+
+TEST(findIsExact)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"Work", 0);
+    catalog.read(platform, true);
+    CHECK_EQ(0, catalog.find(L"Work"));
+    CHECK_EQ(-1, catalog.find(L"work"));
+    CHECK_EQ(-1, catalog.find(L"Wor"));
+    CHECK_EQ(-1, catalog.find(L""));
+}
+
+TEST(findManySessions)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+    wchar_t name[SES_NAME_BUF_LEN];
+    int i, misses = 0;
+
+    for (i = 0; i < 5000; ++i) {
+        std::swprintf(name, SES_NAME_BUF_LEN, L"session %05d", i);
+        platform.addSession(name, (unsigned long long)(i % 7));
+    }
+    catalog.read(platform, false);
+    CHECK_EQ(5000, catalog.size());
+    for (i = 0; i < 5000; ++i) {
+        std::swprintf(name, SES_NAME_BUF_LEN, L"session %05d", i);
+        int si = catalog.find(name);
+        if (si < 0 || std::wcscmp(catalog[si].name, name) != 0) {
+            ++misses;
+        }
+    }
+    CHECK_EQ(0, misses);
+}
+
+TEST(renameKeepsIndexValid)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"a", 0);
+    platform.addSession(L"b", 0);
+    catalog.read(platform, true);
+    catalog.rename(0, L"renamed");
+    CHECK_EQ(-1, catalog.find(L"a"));
+    CHECK_EQ(0, catalog.find(L"renamed"));
+    CHECK_EQ(1, catalog.find(L"b"));
+    catalog.rename(5, L"ignored");
+    CHECK_EQ(2, catalog.size());
+}
+
+TEST(longNamesAreTruncated)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+    std::wstring name(SES_NAME_BUF_LEN + 20, L'x');
+
+    platform.addSession(name.c_str(), 0);
+    catalog.read(platform, true);
+    CHECK_EQ(SES_NAME_BUF_LEN - 1, (long long)std::wcslen(catalog[0].name));
+}
+
+TEST(filterMatchesIgnoringCase)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"Alpha", 0);
+    platform.addSession(L"alphabet", 0);
+    platform.addSession(L"Beta", 0);
+    platform.addSession(L"gamma", 0);
+    catalog.read(platform, true); // Alpha, Beta, alphabet, gamma
+    CHECK_EQ(2, catalog.filter(platform, L"ALPHA", false, -1, -1));
+    CHECK(catalog[0].isVisible && catalog[2].isVisible);
+    CHECK(!catalog[1].isVisible && !catalog[3].isVisible);
+    CHECK_EQ(3, catalog.filter(platform, L"*A", true, -1, -1));
+    CHECK(catalog[0].isVisible && catalog[1].isVisible && !catalog[2].isVisible && catalog[3].isVisible);
+    CHECK_EQ(1, catalog.filter(platform, L"?eta", true, -1, -1));
+    CHECK(catalog[1].isVisible);
+}
+
+TEST(filterShowsAllAndCurrentSessions)
+{
+    FakePlatform platform;
+    SessionCatalog catalog;
+
+    platform.addSession(L"a", 0);
+    platform.addSession(L"b", 0);
+    platform.addSession(L"c", 0);
+    catalog.read(platform, true);
+    CHECK_EQ(3, catalog.filter(platform, L"", true, -1, -1));
+    CHECK_EQ(3, catalog.filter(platform, L"*", false, -1, -1));
+    CHECK_EQ(3, catalog.filter(platform, NULL, false, -1, -1));
+    CHECK_EQ(2, catalog.filter(platform, L"x", true, 0, 2)); // current and previous
+    CHECK(catalog[0].isVisible && !catalog[1].isVisible && catalog[2].isVisible);
+    CHECK_EQ(0, catalog.filter(platform, L"x", false, -1, -1));
+}
+
+TEST(posixPlatformListsSessionFiles)
+{
+    char dirTemplate[] = "/tmp/smcatalogXXXXXX";
+    std::string dir;
+    SessionCatalog catalog;
+
+    if (!::mkdtemp(dirTemplate)) {
+        CHECK(!"mkdtemp failed");
+        return;
+    }
+    dir = dirTemplate;
+    writeFile(dir + "/alpha.npp-session", 1000000000);
+    writeFile(dir + "/beta.npp-session", 1400000000);
+    writeFile(dir + "/caf\xC3\xA9.npp-session", 1200000000);
+    writeFile(dir + "/notes.txt", 1300000000);
+    ::mkdir((dir + "/folder.npp-session").c_str(), 0700);
+
+    PosixCatalogPlatform platform(dir.c_str(), ".npp-session");
+    platform.addFavorite(L"beta");
+    CHECK(platform.listSessions(catalog));
+    CHECK(catalog.read(platform, false));
+    CHECK_EQ(3, catalog.size());
+    CHECK(std::wcscmp(catalog[0].name, L"beta") == 0);
+    CHECK(std::wcscmp(catalog[1].name, L"caf\u00E9") == 0);
+    CHECK(std::wcscmp(catalog[2].name, L"alpha") == 0);
+    CHECK(catalog[0].isFavorite);
+    CHECK(!catalog[2].isFavorite);
+    CHECK(catalog[0].modified == (1400000000ULL + 11644473600ULL) * 10000000ULL);
+
+    std::remove((dir + "/alpha.npp-session").c_str());
+    std::remove((dir + "/beta.npp-session").c_str());
+    std::remove((dir + "/caf\xC3\xA9.npp-session").c_str());
+    std::remove((dir + "/notes.txt").c_str());
+    ::rmdir((dir + "/folder.npp-session").c_str());
+    ::rmdir(dir.c_str());
+
+    PosixCatalogPlatform missing(dir.c_str(), ".npp-session");
+    CHECK(!catalog.read(missing, true));
+}
+
+int main()
+{
+    RUN(readSortsAlphabetically);
+    RUN(readSortsByDateThenName);
+    RUN(readIndexesSessions);
+    RUN(readMarksFavorites);
+    RUN(readReplacesPreviousSessions);
+    RUN(readReportsUnreadableDirectory);
+    RUN(findIsExact);
+    RUN(findManySessions);
+    RUN(renameKeepsIndexValid);
+    RUN(longNamesAreTruncated);
+    RUN(filterMatchesIgnoringCase);
+    RUN(filterShowsAllAndCurrentSessions);
+    RUN(posixPlatformListsSessionFiles);
+    return TEST_RESULT;
+}
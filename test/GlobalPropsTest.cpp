@@ -0,0 +1,164 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      GlobalPropsTest.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "Test.h"
+#include "../src/core/GlobalProps.h"
+#include "../src/core/Text.h"
+#include <cstring>
+#include <vector>
+
+using namespace NppPlugin;
+using std::vector;
+
+TEST_FAILURES;
+
+namespace {
+
+const char *_global =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+    "<NotepadPlus><FileProperties>"
+    "<File filename=\"C:\\a.txt\" lang=\"C++\" firstVisibleLine=\"5\"><Mark line=\"1\" /><Mark line=\"9\" /></File>"
+    "<File filename=\"C:\\\xC3\x9C.txt\" lang=\"XML\" firstVisibleLine=\"0\"><Fold line=\"3\" /></File>"
+    "</FileProperties></NotepadPlus>";
+
+const char *_session =
+    "<NotepadPlus><Session activeView=\"0\">"
+    "<mainView activeIndex=\"0\">"
+    "<File filename=\"C:\\b.txt\" lang=\"Python\" firstVisibleLine=\"7\"><Mark line=\"4\" /></File>"
+    "<File filename=\"C:\\a.txt\" lang=\"Normal Text\" firstVisibleLine=\"2\"><Mark line=\"2\" /></File>"
+    "</mainView>"
+    "<subView activeIndex=\"0\">"
+    "<File filename=\"C:\\\xC3\x9C.txt\" lang=\"\" firstVisibleLine=\"0\" />"
+    "</subView>"
+    "</Session></NotepadPlus>";
+
+tXmlEleP firstSessionFile(tXmlDoc &doc, const char *view)
+{
+    return tXmlHnd(&doc).FirstChildElement("NotepadPlus").FirstChildElement("Session").FirstChildElement(view).FirstChildElement("File").ToElement();
+}
+
+int countChildren(tXmlEleP ele, const char *name)
+{
+    int n = 0;
+    for (ele = ele->FirstChildElement(name); ele; ele = ele->NextSiblingElement(name)) {
+        ++n;
+    }
+    return n;
+}
+
+} // end namespace
+
+TEST(findGlobalFile)
+{
+    tXmlDoc globalDoc;
+    globalDoc.Parse(_global);
+
+    CHECK(prp::findGlobalFile(globalDoc, "C:\\a.txt") != NULL);
+    CHECK(prp::findGlobalFile(globalDoc, "C:\\\xC3\x9C.txt") != NULL);
+    CHECK(prp::findGlobalFile(globalDoc, "C:\\A.txt") == NULL);
+}
+
+TEST(mergeIntoSessionCopiesGlobalProperties)
+{
+    bool changed;
+    vector<unsigned int> fileHashes;
+    tXmlDoc globalDoc, localDoc;
+    tXmlEleP fileEle;
+    globalDoc.Parse(_global);
+    localDoc.Parse(_session);
+
+    CHECK(prp::mergeIntoSession(globalDoc, localDoc, fileHashes, &changed));
+    CHECK(changed);
+    CHECK_EQ(3, fileHashes.size());
+    CHECK_EQ(str::hash("C:\\b.txt"), fileHashes[0]);
+
+    // Not in global: unchanged
+    fileEle = firstSessionFile(localDoc, "mainView");
+    CHECK(fileEle->Attribute("lang", "Python"));
+    CHECK_EQ(1, countChildren(fileEle, "Mark"));
+    CHECK_EQ(4, fileEle->FirstChildElement("Mark")->IntAttribute("line"));
+
+    // In global: lang, bookmarks and folds replaced, firstVisibleLine kept
+    fileEle = fileEle->NextSiblingElement("File");
+    CHECK(fileEle->Attribute("lang", "C++"));
+    CHECK(fileEle->Attribute("firstVisibleLine", "2"));
+    CHECK_EQ(2, countChildren(fileEle, "Mark"));
+    CHECK_EQ(9, fileEle->LastChildElement("Mark")->IntAttribute("line"));
+
+    // The pathname is entity-encoded for Notepad++
+    fileEle = firstSessionFile(localDoc, "subView");
+    CHECK(fileEle->Attribute("filename", "C:\\&#x00DC;.txt"));
+    CHECK_EQ(1, countChildren(fileEle, "Fold"));
+
+    CHECK(std::strncmp(localDoc.FirstChild()->Value(), "xml", 3) == 0);
+}
+
+TEST(mergeIntoSessionWithoutGlobalProperties)
+{
+    bool changed;
+    vector<unsigned int> fileHashes;
+    tXmlDoc globalDoc, localDoc;
+    globalDoc.Parse("<NotepadPlus />");
+    localDoc.Parse(_session);
+
+    CHECK(prp::mergeIntoSession(globalDoc, localDoc, fileHashes, &changed));
+    CHECK(!changed);
+    CHECK_EQ(3, fileHashes.size());
+}
+
+TEST(mergeIntoGlobalMovesSavedFilesToTop)
+{
+    vector<unsigned int> fileHashes;
+    tXmlDoc globalDoc, localDoc;
+    tXmlEleP fileEle;
+    globalDoc.Parse(_global);
+    localDoc.Parse(_session);
+
+    CHECK(prp::mergeIntoGlobal(globalDoc, localDoc, fileHashes));
+    CHECK_EQ(3, fileHashes.size());
+
+    // The session's files are on top, the last one saved first.
+    fileEle = tXmlHnd(&globalDoc).FirstChildElement("NotepadPlus").FirstChildElement("FileProperties").FirstChildElement("File").ToElement();
+    CHECK(fileEle->Attribute("filename", "C:\\\xC3\x9C.txt"));
+    CHECK_EQ(0, countChildren(fileEle, "Fold"));
+    fileEle = fileEle->NextSiblingElement("File");
+    CHECK(fileEle->Attribute("filename", "C:\\a.txt"));
+    CHECK(fileEle->Attribute("lang", "Normal Text"));
+    CHECK(fileEle->Attribute("firstVisibleLine", "2"));
+    CHECK_EQ(1, countChildren(fileEle, "Mark"));
+    fileEle = fileEle->NextSiblingElement("File");
+    CHECK(fileEle->Attribute("filename", "C:\\b.txt"));
+    CHECK(fileEle->Attribute("lang", "Python"));
+    CHECK(fileEle->NextSiblingElement("File") == NULL);
+}
+
+TEST(mergeIntoGlobalWithoutFileProperties)
+{
+    vector<unsigned int> fileHashes;
+    tXmlDoc globalDoc, localDoc;
+    globalDoc.Parse("<NotepadPlus />");
+    localDoc.Parse(_session);
+
+    CHECK(!prp::mergeIntoGlobal(globalDoc, localDoc, fileHashes));
+}
+
+int main()
+{
+    RUN(findGlobalFile);
+    RUN(mergeIntoSessionCopiesGlobalProperties);
+    RUN(mergeIntoSessionWithoutGlobalProperties);
+    RUN(mergeIntoGlobalMovesSavedFilesToTop);
+    RUN(mergeIntoGlobalWithoutFileProperties);
+    return TEST_RESULT;
+}
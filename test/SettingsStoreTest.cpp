@@ -0,0 +1,243 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      SettingsStoreTest.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "Test.h"
+#include "../src/core/SettingsStore.h"
+#include "../src/posix/PosixPlatform.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+using namespace NppPlugin;
+
+TEST_FAILURES;
+
+namespace {
+
+const char *_settings =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<SessionMgr>"
+    "<Settings><currentSession value=\"Default\" /></Settings>"
+    "<Favorites><item value=\"alpha\" /><item value=\"beta\" /><item value=\"alpha\" /></Favorites>"
+    "</SessionMgr>";
+
+/// Keeps the settings file in a string, counting the writes.
+class MemorySettingsPlatform : public SettingsPlatform
+{
+  public:
+    std::string file;
+    bool exists;
+    int writes;
+    MemorySettingsPlatform(const char *contents)
+        : file(contents ? contents : ""), exists(contents != NULL), writes(0) {}
+    virtual bool readSettings(tXmlDoc &doc, bool *missing)
+    {
+        if (!exists) {
+            *missing = true;
+            return true;
+        }
+        return doc.Parse(file.c_str()) == kXmlSuccess;
+    }
+    virtual bool writeSettings(tXmlDoc &doc)
+    {
+        tinyxml2::XMLPrinter printer;
+        doc.Print(&printer);
+        file = printer.CStr();
+        exists = true;
+        ++writes;
+        return true;
+    }
+};
+
+} // end namespace
+
+TEST(loadCreatesMissingFileAndContainers)
+{
+    SettingsStore store;
+    MemorySettingsPlatform platform(NULL);
+
+    CHECK(store.load(platform, "SessionMgr"));
+    CHECK(store.isDirty());
+    tXmlEleP favEle = store.container("Favorites");
+    CHECK(favEle != NULL);
+    CHECK(store.container("Favorites") == favEle);
+    CHECK(store.save(platform));
+    CHECK(!store.isDirty());
+    CHECK_EQ(1, platform.writes);
+    CHECK(platform.file.find("<?xml") == 0);
+    CHECK(platform.file.find("<SessionMgr>") != std::string::npos);
+    CHECK(platform.file.find("<Favorites/>") != std::string::npos);
+}
+
+TEST(loadKeepsExistingContainers)
+{
+    SettingsStore store;
+    MemorySettingsPlatform platform(_settings);
+
+    CHECK(store.load(platform, "SessionMgr"));
+    CHECK(!store.isDirty());
+    CHECK(store.container("Settings")->FirstChildElement("currentSession") != NULL);
+    CHECK(!store.isDirty());
+    CHECK(store.container("Filters") != NULL);
+    CHECK(store.isDirty());
+}
+
+TEST(loadFailsOnBadFile)
+{
+    SettingsStore store;
+    MemorySettingsPlatform platform("<SessionMgr>");
+
+    CHECK(!store.load(platform, "SessionMgr"));
+    CHECK(!store.isLoaded());
+    CHECK(store.container("Favorites") == NULL);
+    CHECK(!store.save(platform));
+}
+
+TEST(itemListFindsFirstOfDuplicates)
+{
+    SettingsStore store;
+    MemorySettingsPlatform platform(_settings);
+    ItemList favs;
+
+    store.load(platform, "SessionMgr");
+    favs.attach(store.container("Favorites"));
+    CHECK_EQ(3, favs.size());
+    CHECK(std::strcmp(favs.value(0), "alpha") == 0);
+    CHECK(std::strcmp(favs.value(1), "beta") == 0);
+    CHECK(favs.value(3) == NULL);
+    CHECK(favs.value(-1) == NULL);
+    CHECK(favs.find("alpha") == store.container("Favorites")->FirstChildElement());
+    CHECK(favs.find("gamma") == NULL);
+    CHECK(favs.find("") == NULL);
+    CHECK(favs.find(NULL) == NULL);
+    CHECK(!favs.isDirty());
+}
+
+TEST(itemListAddAndMoveToTop)
+{
+    SettingsStore store;
+    MemorySettingsPlatform platform(_settings);
+    ItemList favs;
+
+    store.load(platform, "SessionMgr");
+    favs.attach(store.container("Favorites"));
+    CHECK(!favs.add("beta"));
+    CHECK(!favs.add(""));
+    CHECK(!favs.isDirty());
+    CHECK(favs.add("gamma"));
+    CHECK(favs.isDirty());
+    CHECK(std::strcmp(favs.value(3), "gamma") == 0);
+    CHECK(favs.add("delta", false));
+    CHECK(std::strcmp(favs.value(0), "delta") == 0);
+    CHECK(std::strcmp(favs.value(4), "gamma") == 0);
+
+    favs.clearDirty();
+    CHECK(!favs.moveToTop("delta"));
+    CHECK(!favs.isDirty());
+    CHECK(favs.moveToTop("beta"));
+    CHECK(std::strcmp(favs.value(0), "beta") == 0);
+    CHECK(std::strcmp(favs.value(1), "delta") == 0);
+    CHECK(favs.moveToTop("epsilon"));
+    CHECK(std::strcmp(favs.value(0), "epsilon") == 0);
+    CHECK_EQ(6, favs.size());
+    CHECK(favs.isDirty());
+
+    favs.clear();
+    CHECK_EQ(0, favs.size());
+    CHECK(favs.find("beta") == NULL);
+    CHECK(favs.add("beta"));
+    CHECK_EQ(1, favs.size());
+}
+
+TEST(itemListIndexesManyAppends)
+{
+    int i;
+    char value[16];
+    tXmlDoc doc;
+    ItemList list;
+
+    list.attach(doc.InsertEndChild(doc.NewElement("Filters"))->ToElement());
+    for (i = 0; i < 1000; ++i) {
+        std::sprintf(value, "f%d", i);
+        CHECK(list.add(value));
+        CHECK(list.find(value) != NULL); // each lookup between appends, as in addChild
+    }
+    CHECK_EQ(1000, list.size());
+    for (i = 0; i < 1000; ++i) {
+        std::sprintf(value, "f%d", i);
+        CHECK(list.find(value) != NULL && std::strcmp(list.value(i), value) == 0);
+    }
+    CHECK(list.find("f1000") == NULL);
+}
+
+TEST(detachedItemListIsEmpty)
+{
+    ItemList list;
+
+    CHECK_EQ(0, list.size());
+    CHECK(list.value(0) == NULL);
+    CHECK(list.find("a") == NULL);
+    CHECK(!list.add("a"));
+    CHECK(!list.moveToTop("a"));
+    list.clear();
+    CHECK(!list.isDirty());
+}
+
+TEST(posixPlatformRoundTrip)
+{
+    char dirTemplate[] = "/tmp/smsettingsXXXXXX";
+    std::string file;
+
+    if (!::mkdtemp(dirTemplate)) {
+        CHECK(!"mkdtemp failed");
+        return;
+    }
+    file = std::string(dirTemplate) + "/settings.xml";
+    {
+        SettingsStore store;
+        PosixSettingsPlatform platform(file.c_str());
+        ItemList favs;
+        CHECK(store.load(platform, "SessionMgr"));
+        CHECK(store.isDirty());
+        favs.attach(store.container("Favorites"));
+        favs.add("caf\xC3\xA9");
+        CHECK(store.save(platform));
+    }
+    {
+        SettingsStore store;
+        PosixSettingsPlatform platform(file.c_str());
+        ItemList favs;
+        CHECK(store.load(platform, "SessionMgr"));
+        CHECK(!store.isDirty());
+        favs.attach(store.container("Favorites"));
+        CHECK(favs.find("caf\xC3\xA9") != NULL);
+    }
+    std::remove(file.c_str());
+    ::rmdir(dirTemplate);
+}
+
+int main()
+{
+    RUN(loadCreatesMissingFileAndContainers);
+    RUN(loadKeepsExistingContainers);
+    RUN(loadFailsOnBadFile);
+    RUN(itemListFindsFirstOfDuplicates);
+    RUN(itemListAddAndMoveToTop);
+    RUN(itemListIndexesManyAppends);
+    RUN(detachedItemListIsEmpty);
+    RUN(posixPlatformRoundTrip);
+    return TEST_RESULT;
+}
@@ -0,0 +1,52 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      Test.h
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    A minimal unit test harness for the core. Each test program defines its
+    test functions with TEST, lists them in main with RUN, and returns
+    TEST_RESULT, which ctest reads as pass or fail.
+*/
+
+#ifndef NPP_PLUGIN_TEST_H
+#define NPP_PLUGIN_TEST_H
+
+#include <cstdio>
+
+namespace NppPlugin {
+namespace test {
+
+extern int failures;
+
+} // end namespace NppPlugin::test
+} // end namespace NppPlugin
+
+#define TEST(name) static void name()
+#define RUN(name) (std::printf("%s\n", #name), name())
+#define TEST_RESULT (NppPlugin::test::failures == 0 ? 0 : 1)
+#define TEST_FAILURES int NppPlugin::test::failures = 0
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        std::printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        ++NppPlugin::test::failures; \
+    } \
+} while (0)
+
+#define CHECK_EQ(expected, actual) do { \
+    long long e_ = (long long)(expected), a_ = (long long)(actual); \
+    if (e_ != a_) { \
+        std::printf("  %s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #expected, #actual, e_, a_); \
+        ++NppPlugin::test::failures; \
+    } \
+} while (0)
+
+#endif // NPP_PLUGIN_TEST_H
@@ -0,0 +1,228 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      TextTest.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "Test.h"
+#include "../src/core/Text.h"
+#include "../src/utf8/checked.h"
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace NppPlugin;
+
+TEST_FAILURES;
+
+namespace {
+
+/** @return the UTF-16 units of s, zero-terminated, as converted by the utf8
+    headers. s must be valid UTF-8. */
+std::vector<wchar_t> refUtf16(const std::string &s)
+{
+    std::vector<unsigned short> units;
+    utf8::utf8to16(s.begin(), s.end(), std::back_inserter(units));
+    std::vector<wchar_t> w(units.begin(), units.end());
+    w.push_back(0);
+    return w;
+}
+
+/** @return the UTF-8 form of the zero-terminated UTF-16 units w, as converted
+    by the utf8 headers */
+std::string refUtf8(const wchar_t *w)
+{
+    std::vector<unsigned short> units(w, w + std::wcslen(w));
+    std::string s;
+    utf8::utf16to8(units.begin(), units.end(), std::back_inserter(s));
+    return s;
+}
+
+/** @return true if decodeUtf8 and encodeUtf8 agree with the utf8 headers on s */
+bool roundTripsLikeReference(const std::string &s)
+{
+    std::vector<wchar_t> expected = refUtf16(s), w(UTF16_LEN_FOR_UTF8(s.size()));
+    std::vector<char> c(UTF8_LEN_FOR_UTF16(expected.size() - 1));
+
+    if (!str::decodeUtf8(s.c_str(), &w[0], w.size()) || std::wcscmp(&w[0], &expected[0]) != 0) {
+        return false;
+    }
+    return str::encodeUtf8(&w[0], &c[0], c.size()) && refUtf8(&w[0]) == &c[0] && s == &c[0];
+}
+
+} // end namespace
+
+TEST(wildcardMatchLiteral)
+{
+    CHECK(str::wildcardMatch(L"abc", L"abc"));
+    CHECK(!str::wildcardMatch(L"abc", L"abd"));
+    CHECK(!str::wildcardMatch(L"abc", L"abcd"));
+    CHECK(!str::wildcardMatch(L"abcd", L"abc"));
+    CHECK(str::wildcardMatch(L"", L""));
+    CHECK(!str::wildcardMatch(L"", L"a"));
+}
+
+TEST(wildcardMatchQuestion)
+{
+    CHECK(str::wildcardMatch(L"a?c", L"abc"));
+    CHECK(str::wildcardMatch(L"???", L"xyz"));
+    CHECK(!str::wildcardMatch(L"???", L"xy"));
+}
+
+TEST(wildcardMatchStar)
+{
+    CHECK(str::wildcardMatch(L"*", L""));
+    CHECK(str::wildcardMatch(L"*", L"anything"));
+    CHECK(str::wildcardMatch(L"web*", L"website"));
+    CHECK(str::wildcardMatch(L"*site", L"website"));
+    CHECK(str::wildcardMatch(L"*b*", L"website"));
+    CHECK(str::wildcardMatch(L"w*e*e", L"website"));
+    CHECK(!str::wildcardMatch(L"w*x*e", L"website"));
+    CHECK(str::wildcardMatch(L"a*b?d", L"aXXbcd"));
+    CHECK(str::wildcardMatch(L"a**", L"a"));
+}
+
+TEST(wildcardMatchIsCaseSensitive)
+{
+    CHECK(!str::wildcardMatch(L"Web*", L"website"));
+}
+
+TEST(hashIsFnv1a)
+{
+    CHECK_EQ(2166136261U, str::hash(""));
+    CHECK_EQ(0xE40C292CU, str::hash("a"));
+    CHECK_EQ(0xBF9CF968U, str::hash("foobar"));
+    CHECK_EQ(str::hash("foobar"), str::hash(L"foobar"));
+}
+
+TEST(hashUsesUnsignedBytes)
+{
+    // The plugin hashes UTF-8 pathnames, so bytes above 127 must not be
+    // sign-extended.
+    CHECK_EQ(0x1E9DE8C1U, str::hash("\xC3\xA9"));
+}
+
+TEST(utf8ToAsciiEncodesEntities)
+{
+    char *buf = NULL;
+    size_t bufLen = 0;
+
+    CHECK(std::strcmp(str::utf8ToAscii("C:\\a b.txt", &buf, &bufLen), "C:\\a b.txt") == 0);
+    CHECK(std::strcmp(str::utf8ToAscii("\xC3\x9C\tx", &buf, &bufLen), "&#x00DC;&#x0009;x") == 0);
+    // U+1F600 is written as a surrogate pair.
+    CHECK(std::strcmp(str::utf8ToAscii("\xF0\x9F\x98\x80", &buf, &bufLen), "&#xD83D;&#xDE00;") == 0);
+    CHECK(bufLen >= 33);
+    std::free(buf);
+}
+
+TEST(utfConvertsLikeTheUtf8Headers)
+{
+    CHECK(roundTripsLikeReference(""));
+    CHECK(roundTripsLikeReference("C:\\a b.txt"));
+    // Long enough for the ASCII fast path, with non-ASCII inside and after a block.
+    CHECK(roundTripsLikeReference("C:\\Users\\somebody\\Documents\\project\\src\\main.cpp"));
+    CHECK(roundTripsLikeReference("C:\\Users\\somebody\\\xC3\x9C" "bung\\\xE4\xB8\xAD\xE6\x96\x87\\readme.txt"));
+    CHECK(roundTripsLikeReference("0123456789abcdef\xF0\x9F\x98\x80" "0123456789abcdef"));
+    CHECK(roundTripsLikeReference("\x7F\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF\xF0\x90\x80\x80\xF4\x8F\xBF\xBF"));
+}
+
+TEST(utfConvertsRandomCodePointsLikeTheUtf8Headers)
+{
+    int i, j;
+    unsigned int cp, seed = 12345;
+    std::string s;
+
+    for (i = 0; i < 200; ++i) {
+        s.clear();
+        for (j = 0; j < i % 40; ++j) {
+            seed = seed * 1103515245 + 12345;
+            cp = (seed >> 8) % (j % 3 ? 0x80 : 0x110000);
+            if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                cp = 'x';
+            }
+            utf8::append(cp, std::back_inserter(s));
+        }
+        CHECK(roundTripsLikeReference(s));
+    }
+}
+
+TEST(decodeUtf8RejectsWhatTheUtf8HeadersReject)
+{
+    wchar_t w[16];
+    const char *bad[] = {
+        "\x80",             // lone continuation byte
+        "\xC0\x80",         // overlong
+        "\xE0\x80\x80",     // overlong
+        "\xF0\x80\x80\x80", // overlong
+        "\xED\xA0\x80",     // surrogate
+        "\xF4\x90\x80\x80", // above U+10FFFF
+        "a\xC3",            // truncated
+        "\xE4\xB8",         // truncated
+        "\xFF"
+    };
+
+    for (size_t i = 0; i < sizeof bad / sizeof bad[0]; ++i) {
+        CHECK(!utf8::is_valid(bad[i], bad[i] + std::strlen(bad[i])));
+        CHECK(str::decodeUtf8(bad[i], w, 16) == NULL);
+    }
+}
+
+TEST(encodeUtf8RejectsUnpairedSurrogates)
+{
+    char c[16];
+    const wchar_t lead[] = { 'a', 0xD83D, 0 }, trail[] = { 0xDE00, 'a', 0 }, swapped[] = { 0xDE00, 0xD83D, 0 };
+    const wchar_t pair[] = { 0xD83D, 0xDE00, 0 };
+
+    CHECK(str::encodeUtf8(lead, c, 16) == NULL);
+    CHECK(str::encodeUtf8(trail, c, 16) == NULL);
+    CHECK(str::encodeUtf8(swapped, c, 16) == NULL);
+    CHECK(str::encodeUtf8(pair, c, 16) != NULL);
+    CHECK(std::strcmp(c, "\xF0\x9F\x98\x80") == 0);
+}
+
+TEST(utfConversionChecksTheBufferLength)
+{
+    wchar_t w[40];
+    char c[40];
+    const char *ascii = "0123456789abcdefghij"; // 20 bytes, crosses a fast-path block
+    const wchar_t pair[] = { 'a', 0xD83D, 0xDE00, 0 };
+
+    CHECK(str::decodeUtf8(ascii, w, 21) == w);
+    CHECK(str::decodeUtf8(ascii, w, 20) == NULL);
+    CHECK(str::decodeUtf8("", w, 1) == w);
+    CHECK(str::decodeUtf8("", w, 0) == NULL);
+    CHECK(str::decodeUtf8("a\xF0\x9F\x98\x80", w, 4) == w);
+    CHECK(str::decodeUtf8("a\xF0\x9F\x98\x80", w, 3) == NULL);
+    CHECK(str::encodeUtf8(L"0123456789abcdefghij", c, 21) == c);
+    CHECK(str::encodeUtf8(L"0123456789abcdefghij", c, 20) == NULL);
+    CHECK(str::encodeUtf8(pair, c, 6) == c);
+    CHECK(str::encodeUtf8(pair, c, 5) == NULL);
+}
+
+int main()
+{
+    RUN(wildcardMatchLiteral);
+    RUN(wildcardMatchQuestion);
+    RUN(wildcardMatchStar);
+    RUN(wildcardMatchIsCaseSensitive);
+    RUN(hashIsFnv1a);
+    RUN(hashUsesUnsignedBytes);
+    RUN(utf8ToAsciiEncodesEntities);
+    RUN(utfConvertsLikeTheUtf8Headers);
+    RUN(utfConvertsRandomCodePointsLikeTheUtf8Headers);
+    RUN(decodeUtf8RejectsWhatTheUtf8HeadersReject);
+    RUN(encodeUtf8RejectsUnpairedSurrogates);
+    RUN(utfConversionChecksTheBufferLength);
+    return TEST_RESULT;
+}
@@ -0,0 +1,135 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      TimerQueueTest.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+*/
+
+#include "Test.h"
+#include "../src/core/TimerQueue.h"
+
+using namespace NppPlugin;
+
+TEST_FAILURES;
+
+/// The slack passed to popDue, like USER_TIMER_MINIMUM in the plugin
+const unsigned int kSlack = 10;
+
+TEST(popsInDeadlineOrder)
+{
+    TimerQueue q(4);
+    q.set(0, 1000, 300);
+    q.set(1, 1000, 100);
+    q.set(2, 1000, 200);
+    q.set(3, 1000, 100);
+    unsigned int gen = q.generation();
+    CHECK_EQ(1, q.popDue(1500, kSlack, gen));
+    CHECK_EQ(3, q.popDue(1500, kSlack, gen)); // same deadline as 1, so lower id first
+    CHECK_EQ(2, q.popDue(1500, kSlack, gen));
+    CHECK_EQ(0, q.popDue(1500, kSlack, gen));
+    CHECK_EQ(-1, q.popDue(1500, kSlack, gen));
+    CHECK(!q.isSet(0));
+}
+
+TEST(doesNotFireEarlyBeyondSlack)
+{
+    TimerQueue q(2);
+    q.set(0, 1000, 100);
+    q.set(1, 1000, 100 + kSlack + 1);
+    unsigned int gen = q.generation();
+    CHECK_EQ(-1, q.popDue(1000 + 100 - kSlack - 1, kSlack, gen));
+    CHECK_EQ(0, q.popDue(1000 + 100 - kSlack, kSlack, gen));
+    CHECK_EQ(-1, q.popDue(1000 + 100, kSlack, gen)); // timer 1 is kSlack + 1 away
+    CHECK(q.isSet(1));
+    CHECK_EQ(1, q.popDue(1000 + 101, kSlack, gen));
+}
+
+TEST(rearmedTimerWaitsForNextRun)
+{
+    TimerQueue q(2);
+    q.set(0, 1000, 0);
+    unsigned int gen = q.generation();
+    CHECK_EQ(0, q.popDue(1000, kSlack, gen));
+    q.set(0, 1000, 0); // a callback re-arms its own timer
+    CHECK_EQ(-1, q.popDue(1000, kSlack, gen));
+    CHECK(q.isSet(0));
+    CHECK_EQ(0, q.popDue(1000, kSlack, q.generation()));
+}
+
+TEST(setReplacesDeadline)
+{
+    TimerQueue q(1);
+    q.set(0, 1000, 50);
+    q.set(0, 1000, 500);
+    CHECK_EQ(1500, q.due(0));
+    CHECK_EQ(-1, q.popDue(1100, kSlack, q.generation()));
+    CHECK_EQ(0, q.popDue(1500, kSlack, q.generation()));
+}
+
+TEST(cancelledTimerDoesNotFire)
+{
+    TimerQueue q(3);
+    q.set(0, 1000, 10);
+    q.set(1, 1000, 20);
+    CHECK(q.cancel(0));
+    CHECK(!q.cancel(0));
+    CHECK(!q.cancel(2));
+    CHECK_EQ(1, q.popDue(2000, kSlack, q.generation()));
+    CHECK_EQ(-1, q.popDue(2000, kSlack, q.generation()));
+    q.set(0, 1000, 10);
+    q.set(2, 1000, 10);
+    q.cancelAll();
+    CHECK(!q.isSet(0));
+    CHECK(!q.isSet(2));
+    CHECK_EQ(-1, q.popDue(2000, kSlack, q.generation()));
+}
+
+TEST(nextWaitIsTimeToEarliest)
+{
+    TimerQueue q(3);
+    unsigned int wait = 99;
+    CHECK(!q.nextWait(1000, &wait));
+    q.set(0, 1000, 300);
+    q.set(1, 1000, 200);
+    CHECK(q.nextWait(1050, &wait));
+    CHECK_EQ(150, wait);
+    CHECK(q.nextWait(1300, &wait)); // overdue
+    CHECK_EQ(0, wait);
+    q.cancel(1);
+    CHECK(q.nextWait(1050, &wait));
+    CHECK_EQ(250, wait);
+}
+
+TEST(clockWrapAround)
+{
+    TimerQueue q(2);
+    unsigned int now = 0xFFFFFFF0U;
+    unsigned int wait;
+    q.set(0, now, 0x40); // due after the clock wraps
+    q.set(1, now, 0x08); // due before it wraps
+    CHECK(q.nextWait(now, &wait));
+    CHECK_EQ(0x08, wait);
+    CHECK_EQ(-1, q.popDue(now, kSlack - 9, q.generation()));
+    CHECK_EQ(1, q.popDue(now + 0x08, kSlack, q.generation()));
+    CHECK_EQ(-1, q.popDue(now + 0x08, kSlack, q.generation()));
+    CHECK_EQ(0, q.popDue(0x30, kSlack, q.generation()));
+}
+
+int main()
+{
+    RUN(popsInDeadlineOrder);
+    RUN(doesNotFireEarlyBeyondSlack);
+    RUN(rearmedTimerWaitsForNextRun);
+    RUN(setReplacesDeadline);
+    RUN(cancelledTimerDoesNotFire);
+    RUN(nextWaitIsTimeToEarliest);
+    RUN(clockWrapAround);
+    return TEST_RESULT;
+}
@@ -0,0 +1,406 @@
+/*
+    This file is part of SessionMgr, A Plugin for Notepad++. SessionMgr is free
+    software: you can redistribute it and/or modify it under the terms of the
+    GNU General Public License as published by the Free Software Foundation,
+    either version 3 of the License, or (at your option) any later version.
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License along with this program. If not, see <http://www.gnu.org/licenses/>.
+*//**    @file      XmlTest.cpp
+    @copyright Copyright 2015 Michael Foster <http://mfoster.com/npp/>
+
+    Tests of the changes made to the bundled tinyxml2. The intern table is
+    global, so the tests that intern names run in a fixed order.
+*/
+
+#include "Test.h"
+#include "../src/xml/tinyxml2.h"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace tinyxml2;
+
+TEST_FAILURES;
+
+namespace {
+
+#define BUF_LEN 160
+
+/** @return the first 16-byte aligned address in storage */
+char* aligned(char *storage)
+{
+    return storage + ((16 - (reinterpret_cast<size_t>(storage) & 15)) & 15);
+}
+
+/** @return ScanFor as a plain loop would compute it */
+char* scanForRef(char *p, char a, char b, char c)
+{
+    while (*p && (!a || *p != a) && (!b || *p != b) && (!c || *p != c)) {
+        ++p;
+    }
+    return p;
+}
+
+/// Text with every character the printer escapes. "amp" is not an entity
+/// here, so '&' is kept as is.
+const char *_escaped = "a<b>c\"d'e&amp;f&g";
+
+/** Builds a document with every kind of value the printer formats. */
+void buildDoc(XMLDocument &doc)
+{
+    XMLElement *root = doc.NewElement("Root"), *ele;
+
+    doc.InsertEndChild(doc.NewDeclaration());
+    doc.InsertEndChild(root);
+    root->InsertEndChild(doc.NewComment(" a comment "));
+    ele = doc.NewElement("Values");
+    ele->SetAttribute("intMin", INT_MIN);
+    ele->SetAttribute("intMax", INT_MAX);
+    ele->SetAttribute("zero", 0);
+    ele->SetAttribute("uintMax", UINT_MAX);
+    ele->SetAttribute("flag", true);
+    ele->SetAttribute("real", 0.5);
+    ele->SetAttribute("escaped", _escaped);
+    root->InsertEndChild(ele);
+    ele = doc.NewElement("Text");
+    ele->SetText(_escaped);
+    root->InsertEndChild(ele);
+    ele = doc.NewElement("Number");
+    ele->SetText(INT_MIN);
+    root->InsertEndChild(ele);
+    ele = doc.NewElement("Empty");
+    root->InsertEndChild(ele);
+}
+
+/** @return true if xml parses to the document buildDoc builds */
+bool parsesToBuiltDoc(const char *xml)
+{
+    int i;
+    unsigned u;
+    bool b;
+    double d;
+    XMLDocument doc;
+    const XMLElement *root, *ele;
+
+    if (doc.Parse(xml) != XML_SUCCESS || !(root = doc.FirstChildElement("Root"))) {
+        return false;
+    }
+    if (!(ele = root->FirstChildElement("Values"))
+            || ele->QueryIntAttribute("intMin", &i) != XML_SUCCESS || i != INT_MIN
+            || ele->QueryIntAttribute("intMax", &i) != XML_SUCCESS || i != INT_MAX
+            || !ele->Attribute("intMin", "-2147483648") || !ele->Attribute("zero", "0")
+            || ele->QueryUnsignedAttribute("uintMax", &u) != XML_SUCCESS || u != UINT_MAX
+            || ele->QueryBoolAttribute("flag", &b) != XML_SUCCESS || !b
+            || ele->QueryDoubleAttribute("real", &d) != XML_SUCCESS || d != 0.5
+            || !ele->Attribute("escaped", _escaped)) {
+        return false;
+    }
+    if (!(ele = root->FirstChildElement("Text")) || !ele->GetText() || std::strcmp(ele->GetText(), _escaped) != 0) {
+        return false;
+    }
+    if (!(ele = root->FirstChildElement("Number")) || ele->QueryIntText(&i) != XML_SUCCESS || i != INT_MIN) {
+        return false;
+    }
+    return root->FirstChildElement("Empty") && !root->FirstChildElement("Empty")->FirstChild()
+        && root->FirstChild() && root->FirstChild()->ToComment();
+}
+
+/** @return the contents of fp, from the start */
+std::string readAll(FILE *fp)
+{
+    size_t n;
+    char buf[4096];
+    std::string str;
+
+    std::rewind(fp);
+    while ((n = std::fread(buf, 1, sizeof buf, fp)) > 0) {
+        str.append(buf, n);
+    }
+    return str;
+}
+
+/** @return what doc saves to a file */
+std::string saveToString(XMLDocument &doc, bool compact, XMLError *err)
+{
+    std::string str;
+    FILE *fp = std::tmpfile();
+
+    if (!fp) {
+        *err = XML_ERROR_FILE_COULD_NOT_BE_OPENED;
+        return str;
+    }
+    *err = doc.SaveFile(fp, compact);
+    str = readAll(fp);
+    std::fclose(fp);
+    return str;
+}
+
+} // end namespace
+
+TEST(scanForIgnoresMatchesBeforeP)
+{
+    char storage[BUF_LEN];
+    char *buf = aligned(storage);
+
+    std::memset(buf, '.', 64);
+    buf[64] = 0;
+    buf[2] = '&';  // in p's block, before p
+    buf[20] = '&';
+    CHECK(XMLUtil::ScanFor(buf + 5, '&', 0, 0) == buf + 20);
+    buf[15] = '<'; // the last byte of p's block
+    CHECK(XMLUtil::ScanFor(buf + 15, '<', 0, 0) == buf + 15);
+    CHECK(XMLUtil::ScanFor(buf + 16, '<', 0, 0) == buf + 64);
+}
+
+TEST(scanForFindsTerminatorOnBlockBoundary)
+{
+    char storage[BUF_LEN];
+    char *buf = aligned(storage);
+
+    std::memset(buf, 'x', 64);
+    buf[16] = 0;
+    CHECK(XMLUtil::ScanFor(buf + 3, '<', 0, 0) == buf + 16);
+    CHECK(XMLUtil::ScanFor(buf + 16, '<', 0, 0) == buf + 16);
+    buf[16] = 'x';
+    buf[32] = 0;
+    CHECK(XMLUtil::ScanFor(buf, '&', '\r', '\n') == buf + 32);
+    CHECK(XMLUtil::ScanFor(buf + 31, '&', '\r', '\n') == buf + 32);
+}
+
+TEST(scanForWithUnusedChars)
+{
+    char storage[BUF_LEN];
+    char *buf = aligned(storage);
+
+    std::strcpy(buf, "no matches in this string at all");
+    CHECK(XMLUtil::ScanFor(buf, 0, 0, 0) == buf + std::strlen(buf));
+    CHECK(XMLUtil::ScanFor(buf + 7, 0, 0, 0) == buf + std::strlen(buf));
+    CHECK(XMLUtil::ScanFor(buf, 0, 'i', 0) == buf + 11);
+    CHECK(XMLUtil::ScanFor(buf, 0, 0, 'g') == buf + 24);
+}
+
+TEST(scanForMatchesLoopAtEveryOffset)
+{
+    int offset, len, pos;
+    char storage[BUF_LEN];
+    char *buf = aligned(storage);
+
+    for (len = 0; len < 48; ++len) {
+        for (pos = 0; pos <= len; ++pos) {
+            std::memset(buf, 'x', BUF_LEN - 16);
+            buf[len] = 0;
+            if (pos < len) {
+                buf[pos] = '&';
+            }
+            for (offset = 0; offset <= len && offset < 16; ++offset) {
+                CHECK(XMLUtil::ScanFor(buf + offset, '&', 0, 0) == scanForRef(buf + offset, '&', 0, 0));
+                CHECK(XMLUtil::ScanFor(buf + offset, '\r', '\n', '&') == scanForRef(buf + offset, '\r', '\n', '&'));
+            }
+        }
+    }
+}
+
+TEST(parseTextAndAttributesUseScanFor)
+{
+    XMLDocument doc;
+    const XMLElement *ele;
+
+    // "amp" was removed from the entities table, so &amp; is kept as is.
+    CHECK(doc.Parse("<a b=\"x&lt;y&amp;z\" c=\"one\rtwo\">1\r\n2&lt;3</a>") == XML_SUCCESS);
+    ele = doc.FirstChildElement("a");
+    CHECK(ele != NULL);
+    CHECK(ele && std::strcmp(ele->Attribute("b"), "x<y&amp;z") == 0);
+    CHECK(ele && std::strcmp(ele->Attribute("c"), "one\ntwo") == 0);
+    CHECK(ele && std::strcmp(ele->GetText(), "1\n2<3") == 0);
+    CHECK(doc.Parse("<File filename=\"it&apos;s &amp; co.txt\"/>") == XML_SUCCESS);
+    ele = doc.FirstChildElement("File");
+    CHECK(ele && std::strcmp(ele->Attribute("filename"), "it's &amp; co.txt") == 0);
+    CHECK(doc.Parse("<a>unterminated") != XML_SUCCESS);
+}
+
+TEST(internReturnsOneCopyPerName)
+{
+    char item[] = "item";
+    const char *interned = XMLUtil::Intern("item");
+
+    CHECK(interned != item);
+    CHECK(std::strcmp(interned, "item") == 0);
+    CHECK(XMLUtil::Intern(item) == interned);
+    CHECK(XMLUtil::FindInterned("items", 4) == interned);
+    CHECK(XMLUtil::FindInterned("ite", 3) == NULL);
+    CHECK(XMLUtil::FindInterned("itemx", 5) == NULL);
+}
+
+TEST(nameEqualMixesInternedAndPlainNames)
+{
+    char item[] = "item", ite[] = "ite";
+    const char *interned = XMLUtil::Intern("item"), *value = XMLUtil::Intern("value");
+
+    CHECK(XMLUtil::NameEqual(interned, interned));
+    CHECK(XMLUtil::NameEqual(interned, item));
+    CHECK(XMLUtil::NameEqual(item, interned));
+    CHECK(!XMLUtil::NameEqual(interned, value));
+    CHECK(!XMLUtil::NameEqual(interned, ite));
+    CHECK(!XMLUtil::NameEqual(ite, interned));
+    CHECK(!XMLUtil::NameEqual(interned, "items"));
+}
+
+TEST(setNameAndSetAttributeUseInternedNames)
+{
+    XMLDocument doc;
+    char name[] = "item", attr[] = "value";
+    const char *interned = XMLUtil::Intern("item"), *value = XMLUtil::Intern("value");
+    XMLElement *ele = doc.NewElement("other");
+
+    doc.InsertEndChild(ele);
+    ele->SetName(name);
+    CHECK(ele->Name() == interned);
+    ele->SetAttribute(attr, "1");
+    CHECK(ele->FirstAttribute() && ele->FirstAttribute()->Name() == value);
+    ele->SetAttribute("value", "2");
+    CHECK(ele->FirstAttribute() && !ele->FirstAttribute()->Next());
+    CHECK(std::strcmp(ele->Attribute(attr), "2") == 0);
+    CHECK(doc.FirstChildElement(name) == ele);
+    ele->SetName("notInterned");
+    CHECK(std::strcmp(ele->Name(), "notInterned") == 0);
+    CHECK(doc.FirstChildElement("notInterned") == ele);
+    CHECK(doc.FirstChildElement("item") == NULL);
+}
+
+TEST(parseChecksEndTagsOfInternedNames)
+{
+    XMLDocument doc;
+
+    XMLUtil::Intern("item");
+    XMLUtil::Intern("value");
+    CHECK(doc.Parse("<item><value/></item>") == XML_SUCCESS);
+    CHECK(doc.FirstChildElement()->Name() == XMLUtil::Intern("item"));
+    CHECK(doc.Parse("<item></value>") == XML_ERROR_MISMATCHED_ELEMENT);
+    CHECK(doc.Parse("<item></items>") == XML_ERROR_MISMATCHED_ELEMENT);
+    CHECK(doc.Parse("<items></item>") == XML_ERROR_MISMATCHED_ELEMENT);
+    CHECK(doc.Parse("<item></ite>") == XML_ERROR_MISMATCHED_ELEMENT);
+    CHECK(doc.Parse("<other></other>") == XML_SUCCESS);
+}
+
+TEST(printerRoundTripsInMemory)
+{
+    XMLDocument doc;
+    XMLPrinter normal, compact(0, true);
+
+    buildDoc(doc);
+    doc.Print(&normal);
+    doc.Print(&compact);
+    CHECK(parsesToBuiltDoc(normal.CStr()));
+    CHECK(parsesToBuiltDoc(compact.CStr()));
+    CHECK(std::strstr(normal.CStr(), "intMin=\"-2147483648\" intMax=\"2147483647\" zero=\"0\" uintMax=\"4294967295\"") != NULL);
+    CHECK(std::strstr(normal.CStr(), "<Text>a&lt;b&gt;c\"d'e&amp;f&g</Text>") != NULL);
+    CHECK(std::strstr(normal.CStr(), "escaped=\"a&lt;b&gt;c&quot;d&apos;e&amp;f&g\"") != NULL);
+    CHECK(std::strstr(normal.CStr(), "\n    <Values") != NULL);
+    CHECK(std::strchr(compact.CStr(), '\n') == NULL);
+    CHECK_EQ(std::strlen(normal.CStr()) + 1, normal.CStrSize());
+}
+
+TEST(printerWritesTheSameToFileAsToMemory)
+{
+    XMLError err;
+    XMLDocument doc;
+    XMLPrinter normal, compact(0, true);
+
+    buildDoc(doc);
+    doc.Print(&normal);
+    doc.Print(&compact);
+    CHECK(saveToString(doc, false, &err) == normal.CStr());
+    CHECK_EQ(XML_SUCCESS, err);
+    CHECK(saveToString(doc, true, &err) == compact.CStr());
+    CHECK_EQ(XML_SUCCESS, err);
+}
+
+TEST(printerWritesLargeOutputInChunks)
+{
+    int i;
+    XMLError err;
+    XMLDocument doc;
+    XMLPrinter memory;
+    std::string big(200 * 1024, 'x'), file;
+    XMLElement *root = doc.NewElement("Root");
+
+    doc.InsertEndChild(root);
+    for (i = 0; i < 5000; ++i) {
+        XMLElement *ele = doc.NewElement("File");
+        ele->SetAttribute("line", i - 2500);
+        root->InsertEndChild(ele);
+    }
+    root->SetAttribute("big", big.c_str()); // larger than the output buffer
+    doc.Print(&memory);
+    file = saveToString(doc, false, &err);
+    CHECK_EQ(XML_SUCCESS, err);
+    CHECK(file == memory.CStr());
+    CHECK(doc.Parse(file.c_str()) == XML_SUCCESS);
+    CHECK(doc.FirstChildElement()->Attribute("big", big.c_str()));
+    CHECK(doc.FirstChildElement()->LastChildElement()->IntAttribute("line") == 2499);
+}
+
+TEST(saveFileFailsOnShortWrite)
+{
+    XMLDocument doc;
+    FILE *fp = std::fopen("/dev/null", "r"); // every write fails
+
+    buildDoc(doc);
+    if (fp) {
+        CHECK_EQ(XML_ERROR_FILE_WRITE_ERROR, doc.SaveFile(fp));
+        std::fclose(fp);
+    }
+    fp = std::fopen("/dev/full", "w");
+    if (fp) {
+        std::fclose(fp);
+        doc.Clear();
+        buildDoc(doc);
+        CHECK_EQ(XML_ERROR_FILE_WRITE_ERROR, doc.SaveFile("/dev/full"));
+    }
+}
+
+/** Must run last, since the table stays full. */
+TEST(internWhenTableIsFull)
+{
+    int i;
+    char name[16];
+    const char *interned = XMLUtil::Intern("item"), *last = NULL;
+    XMLDocument doc;
+
+    for (i = 0; i < 200; ++i) {
+        std::sprintf(name, "name%d", i);
+        last = XMLUtil::Intern(name);
+    }
+    CHECK(last == name);
+    CHECK(XMLUtil::FindInterned(name, std::strlen(name)) == NULL);
+    CHECK(XMLUtil::Intern("item") == interned);
+    CHECK(XMLUtil::NameEqual(last, "name199"));
+    CHECK(!XMLUtil::NameEqual(last, interned));
+    CHECK(doc.Parse("<name199 name198=\"1\"><item/></name199>") == XML_SUCCESS);
+    CHECK(doc.FirstChildElement("name199") && doc.FirstChildElement("name199")->Attribute("name198", "1"));
+    CHECK(doc.FirstChildElement()->FirstChildElement()->Name() == interned);
+    CHECK(doc.Parse("<name199></name198>") == XML_ERROR_MISMATCHED_ELEMENT);
+}
+
+int main()
+{
+    RUN(scanForIgnoresMatchesBeforeP);
+    RUN(scanForFindsTerminatorOnBlockBoundary);
+    RUN(scanForWithUnusedChars);
+    RUN(scanForMatchesLoopAtEveryOffset);
+    RUN(parseTextAndAttributesUseScanFor);
+    RUN(printerRoundTripsInMemory);
+    RUN(printerWritesTheSameToFileAsToMemory);
+    RUN(printerWritesLargeOutputInChunks);
+    RUN(saveFileFailsOnShortWrite);
+    RUN(internReturnsOneCopyPerName);
+    RUN(nameEqualMixesInternedAndPlainNames);
+    RUN(setNameAndSetAttributeUseInternedNames);
+    RUN(parseChecksEndTagsOfInternedNames);
+    RUN(internWhenTableIsFull);
+    return TEST_RESULT;
+}